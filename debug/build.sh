@@ -1,3 +1,13 @@
 #!/bin/bash
 
-g++ ../source/main.cpp -o main.exe -std=c++11
+g++ ../source/main.cpp -o main.exe -std=c++11 -pthread
+
+g++ ../source/benchmarks/parse.cpp -o parse_benchmark.exe -std=c++11 -O2
+
+g++ ../source/benchmarks/circuits.cpp -o circuits_benchmark.exe -std=c++11 -O2 -pthread
+
+g++ ../source/benchmarks/accuracy.cpp -o accuracy_benchmark.exe -std=c++11 -O2 -pthread
+
+g++ ../source/benchmarks/allocations.cpp -o allocations_benchmark.exe -std=c++11 -O2 -pthread
+
+g++ ../source/benchmarks/kernels.cpp -o kernels_benchmark.exe -std=c++11 -O2 -march=native
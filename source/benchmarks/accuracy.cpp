@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cmath>
+
+#include "../simulation.hpp"
+
+// A circuit whose response is known in closed form: its netlist (without the
+// transient operation, which is added for each time step), the column of the
+// output to check, and the value that column should take at a given time
+struct Reference {
+    std::string name;
+    std::string netlist;
+    double stop_time;
+    std::string column;
+    std::function<double(const double &)> solution;
+};
+
+// A way of running the simulation, applied to its operation before it's run
+struct Configuration {
+    std::string name;
+    std::function<void(Operation &)> apply;
+};
+
+// The error of one run against its reference, and how long the run took
+struct Result {
+    std::string configuration;
+    double time_step;
+    double run_time;
+    double maximum_error;
+    double rms_error;
+    bool pareto;
+};
+
+const double pi = 3.14159265358979323846;
+
+// The canonical circuits: steps into RC, RL, and series RLC circuits, and
+// sines into a resistive divider and an RC low-pass filter
+std::vector<Reference> create_references() {
+    std::vector<Reference> references;
+
+    // A step of 1V into 1k and 1u (tau = 1ms)
+    references.push_back({"rc_step",
+            "V1 in 0 1\nR1 in out 1k\nC1 out 0 1u\n", 5e-3, "V(out)",
+            [](const double &time) {
+                return 1 - std::exp(-time / 1e-3);
+            }});
+
+    // A step of 1V into 10R and 10mH (tau = 1ms)
+    references.push_back({"rl_step",
+            "V1 in 0 1\nR1 in mid 10\nL1 mid 0 10m\n", 5e-3, "I(L1)",
+            [](const double &time) {
+                return 0.1 * (1 - std::exp(-time / 1e-3));
+            }});
+
+    // A step of 1V into 10R, 10mH, and 100u in series: underdamped, with
+    // alpha = 500/s and a ringing frequency of 866rad/s
+    references.push_back({"rlc_step",
+            "V1 in 0 1\nR1 in a 10\nL1 a b 10m\nC1 b 0 100u\n", 20e-3,
+            "V(b)",
+            [](const double &time) {
+                const double alpha = 500;
+                const double omega = std::sqrt(1e6 - alpha * alpha);
+                return 1 - std::exp(-alpha * time) * (std::cos(omega * time) +
+                        alpha / omega * std::sin(omega * time));
+            }});
+
+    // A 50Hz sine across 1k over 3k (the sines' damping is given as zero,
+    // as it isn't by default)
+    references.push_back({"divider_sine",
+            "V1 in 0 SINE(0 1 50 0 0)\nR1 in out 1k\nR2 out 0 3k\n", 40e-3,
+            "V(out)",
+            [](const double &time) {
+                return 0.75 * std::sin(2 * pi * 50 * time);
+            }});
+
+    // A 200Hz sine into 1k and 1u, from rest: the steady-state response, plus
+    // the transient that starts it from zero
+    references.push_back({"rc_sine",
+            "V1 in 0 SINE(0 1 200 0 0)\nR1 in out 1k\nC1 out 0 1u\n", 10e-3,
+            "V(out)",
+            [](const double &time) {
+                const double product = 2 * pi * 200 * 1e-3;
+                const double phase = 2 * pi * 200 * time;
+                return (std::sin(phase) - product * std::cos(phase) + product *
+                        std::exp(-time / 1e-3)) / (1 + product * product);
+            }});
+
+    return references;
+}
+
+// Runs a circuit with the time step and configuration given, then measures
+// its output against the reference. Returns false if it couldn't be run
+bool measure(const Reference &reference, const double &time_step,
+        const Configuration &configuration, const unsigned int &repetitions,
+        Result &result) {
+
+    std::ostringstream netlist;
+    netlist << reference.netlist << ".tran " << time_step << " " <<
+            reference.stop_time << "\n";
+    const auto simulation = Simulation::parse(netlist.str());
+    if(simulation == nullptr)
+        return false;
+    configuration.apply(*simulation->operation);
+
+    // Keep the output of the last run, at full precision, and the fastest
+    // run's time
+    std::shared_ptr<std::ostringstream> output;
+    result.run_time = INFINITY;
+    for(unsigned int repetition = 0; repetition < repetitions;
+            repetition += 1) {
+
+        output = std::make_shared<std::ostringstream>();
+        output->precision(17);
+        const auto start = std::chrono::steady_clock::now();
+        if(simulation->run(output) == false)
+            return false;
+
+        result.run_time = std::min(result.run_time,
+                std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Find the column to check in the header, then compare each row
+    std::istringstream lines(output->str());
+    std::string line;
+    std::getline(lines, line);
+    unsigned int column = 0;
+    bool found = false;
+    std::istringstream header(line);
+    std::string name;
+    while(std::getline(header, name, ',')) {
+        name.erase(0, name.find_first_not_of(' '));
+        if(name == reference.column) {
+            found = true;
+            break;
+        }
+        column += 1;
+    }
+    if(found == false)
+        return false;
+
+    // Errors are relative to the largest magnitude the reference reaches
+    double scale = 0;
+    double squares = 0;
+    unsigned int count = 0;
+    result.maximum_error = 0;
+    while(std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::vector<double> values;
+        std::string field;
+        while(std::getline(fields, field, ','))
+            values.push_back(std::stod(field));
+        if(values.size() <= column)
+            return false;
+
+        const double expected = reference.solution(values[0]);
+        const double error = std::fabs(values[column] - expected);
+        scale = std::max(scale, std::fabs(expected));
+        result.maximum_error = std::max(result.maximum_error, error);
+        squares += error * error;
+        count += 1;
+    }
+
+    if(count == 0 || scale == 0)
+        return false;
+
+    result.maximum_error /= scale;
+    result.rms_error = std::sqrt(squares / count) / scale;
+    result.configuration = configuration.name;
+    result.time_step = time_step;
+    return true;
+}
+
+// Marks the results no other is both faster and more accurate than (by its
+// maximum error)
+void find_pareto(std::vector<Result> &results) {
+    for(auto &result : results) {
+        result.pareto = true;
+        for(const auto &other : results) {
+            const bool better = other.run_time <= result.run_time &&
+                    other.maximum_error <= result.maximum_error &&
+                    (other.run_time < result.run_time ||
+                    other.maximum_error < result.maximum_error);
+            if(better) {
+                result.pareto = false;
+                break;
+            }
+        }
+    }
+}
+
+int main(int argument_count, char *argument_vector[]) {
+
+    // The largest maximum error (relative to each reference's peak) a
+    // configuration may have to be chosen, and how many times each is run
+    double budget = 1e-2;
+    unsigned int repetitions = 3;
+    if(argument_count > 1)
+        budget = std::stod(argument_vector[1]);
+    if(argument_count > 2)
+        repetitions = std::max(1, std::stoi(argument_vector[2]));
+
+    // Each circuit's run with its stop time divided into this many steps
+    const std::vector<unsigned int> step_counts = {250, 500, 1000, 2000, 4000};
+    const std::vector<Configuration> configurations = {
+        {"default", [](Operation &) {}},
+        {"reduce", [](Operation &operation) { operation.reduce = true; }},
+        {"partitions=2", [](Operation &operation) {
+            operation.partition_count = 2;
+        }}
+    };
+
+    std::cout << "circuit, configuration, steps, time step, run time (ms), "
+            "max error, rms error, pareto" << std::endl;
+
+    bool failed = false;
+    std::vector<std::string> choices;
+    for(const auto &reference : create_references()) {
+        std::vector<Result> results;
+        for(const auto &step_count : step_counts) {
+            for(const auto &configuration : configurations) {
+                Result result;
+                if(measure(reference, reference.stop_time / step_count,
+                        configuration, repetitions, result) == false) {
+                    std::cerr << "Couldn't run " << reference.name << " (" <<
+                            configuration.name << ", " << step_count <<
+                            " steps)" << std::endl;
+                    failed = true;
+                    continue;
+                }
+                results.push_back(result);
+            }
+        }
+
+        // List the results fastest first, and choose the fastest within the
+        // budget
+        find_pareto(results);
+        std::sort(results.begin(), results.end(), [](const Result &one,
+                const Result &two) { return one.run_time < two.run_time; });
+
+        const Result *choice = nullptr;
+        for(const auto &result : results) {
+            std::cout << reference.name << ", " << result.configuration <<
+                    ", " << std::lround(reference.stop_time /
+                    result.time_step) << ", " << result.time_step << ", " <<
+                    result.run_time << ", " << result.maximum_error << ", " <<
+                    result.rms_error << ", " << (result.pareto ? "yes" : "no")
+                    << std::endl;
+
+            if(choice == nullptr && result.maximum_error <= budget)
+                choice = &result;
+        }
+
+        std::ostringstream summary;
+        summary << reference.name << ": ";
+        if(choice) {
+            summary << choice->configuration << " at " << choice->time_step <<
+                    "s steps (" << choice->run_time << "ms, max error " <<
+                    choice->maximum_error << ")";
+        }
+        else
+            summary << "nothing within the budget";
+        choices.push_back(summary.str());
+    }
+
+    std::cout << std::endl << "Fastest within a max error of " << budget <<
+            ":" << std::endl;
+    for(const auto &choice : choices)
+        std::cout << "    " << choice << std::endl;
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+// Counting replaces the global operator new, so has to be asked for before
+// anything's included
+#define COUNT_ALLOCATIONS
+
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "../simulation.hpp"
+#include "../utilities/allocations.hpp"
+
+// A circuit to check, as its netlist
+struct Circuit {
+    std::string name;
+    std::string netlist;
+};
+
+// A way of running the simulation, applied to its operation before it's run
+struct Configuration {
+    std::string name;
+    std::function<void(Operation &)> apply;
+};
+
+// An RC ladder of the given number of sections, driven through a resistor by
+// a grounded source (whose node is eliminated from the system), and loaded by
+// a series inductor and resistor to a second, floating, source
+std::string ladder(const unsigned int &sections) {
+    std::ostringstream netlist;
+    netlist << "V1 in 0 SINE(0 1 50)\nR_in in N0 5\n";
+    for(unsigned int index = 1; index <= sections; index += 1) {
+        netlist << "R" << index << " N" << index - 1 << " N" << index <<
+                " 10\n";
+        netlist << "C" << index << " N" << index << " 0 1m\n";
+    }
+    netlist << "L1 N" << sections << " out 0.05\nR_out out load 10\n";
+    netlist << "V2 load bias 0.5\nR_bias bias 0 100\n";
+    netlist << ".tran 0.1\n";
+    return netlist.str();
+}
+
+// A chain of the given number of capacitors, each node loaded to ground by a
+// resistor. None of the capacitors are grounded, so the whole system's solved
+// (and, partitioned, is large enough to be split)
+std::string chain(const unsigned int &sections) {
+    std::ostringstream netlist;
+    netlist << "V1 N0 0 SINE(0 1 50)\n";
+    for(unsigned int index = 1; index <= sections; index += 1) {
+        netlist << "C" << index << " N" << index - 1 << " N" << index <<
+                " 1m\n";
+        netlist << "R" << index << " N" << index << " 0 100\n";
+    }
+    netlist << ".tran 0.1\n";
+    return netlist.str();
+}
+
+// Runs a circuit in a configuration, printing the allocations its steps made
+// past their first. Returns false if any did (or it couldn't be run)
+bool check(const Circuit &circuit, const Configuration &configuration) {
+    const auto simulation = Simulation::parse(circuit.netlist);
+    if(simulation == nullptr)
+        return false;
+
+    const auto transient = std::dynamic_pointer_cast<Transient>(
+            simulation->operation);
+    if(transient == nullptr) {
+        std::cerr << circuit.name << " has no transient operation" <<
+                std::endl;
+        return false;
+    }
+    configuration.apply(*transient);
+
+    const unsigned long before = Allocations::get_count();
+    if(simulation->run(nullptr) == false)
+        return false;
+    const unsigned long allocations = Allocations::get_count() - before;
+
+    const bool passed = transient->allocating_steps == 0;
+    std::cout << circuit.name << ", " << configuration.name << ", " <<
+            allocations << ", " << transient->allocating_steps << ", " <<
+            (passed ? "pass" : "FAIL") << std::endl;
+    return passed;
+}
+
+int main(int argument_count, char *argument_vector[]) {
+
+    // Check the generated circuits, and any netlists named on the command line
+    std::vector<Circuit> circuits = {
+        {"ladder_8", ladder(8)},
+        {"ladder_64", ladder(64)},
+        {"chain_64", chain(64)}
+    };
+    for(int index = 1; index < argument_count; index += 1) {
+        std::ifstream file(argument_vector[index]);
+        if(file.is_open() == false) {
+            std::cerr << "Couldn't open '" << argument_vector[index] << "'" <<
+                    std::endl;
+            return 1;
+        }
+
+        circuits.push_back({argument_vector[index], std::string(
+                std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>())});
+    }
+
+    const std::vector<Configuration> configurations = {
+        {"default", [](Operation &) {}},
+        {"reduce", [](Operation &operation) { operation.reduce = true; }},
+        {"prima", [](Operation &operation) {
+            operation.reduce = true;
+            operation.macromodel_tolerance = 1e-3;
+        }},
+        {"partitions=2", [](Operation &operation) {
+            operation.partition_count = 2;
+        }},
+        {"iterative", [](Operation &operation) {
+            operation.iterative = true;
+        }}
+    };
+
+    std::cout << "circuit, configuration, allocations per run, allocating " <<
+            "steps, result" << std::endl;
+
+    bool passed = true;
+    for(const auto &circuit : circuits) {
+        for(const auto &configuration : configurations) {
+            if(check(circuit, configuration) == false)
+                passed = false;
+        }
+    }
+
+    return passed ? 0 : 1;
+}
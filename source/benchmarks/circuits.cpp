@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cmath>
+
+#include <sys/resource.h>
+
+#include "../simulation.hpp"
+#include "../utilities/profiler.hpp"
+
+// A circuit to generate at a range of sizes, from the number of nodes wanted
+// (which each generator meets as closely as its shape allows)
+struct Generator {
+    std::string name;
+    std::function<std::string(const unsigned int &)> generate;
+};
+
+// Names a node by its index
+std::string node(const unsigned int &index) {
+    return "N" + std::to_string(index);
+}
+
+// Names a node of a grid by its row and column
+std::string grid_node(const unsigned int &row, const unsigned int &column) {
+    return "N" + std::to_string(row) + "_" + std::to_string(column);
+}
+
+// Finishes a netlist with its transient operation, which takes 250 steps. The
+// circuits' time constants are all well above the step
+std::string finish(std::ostringstream &netlist) {
+    netlist << ".tran 0.1\n";
+    return netlist.str();
+}
+
+// A source driving a chain of resistors, with a capacitor from each node to
+// ground
+std::string rc_ladder(const unsigned int &size) {
+    std::ostringstream netlist;
+    netlist << "V1 " << node(0) << " 0 SINE(0 1 50)\n";
+    for(unsigned int index = 1; index < size; index += 1) {
+        netlist << "R" << index << " " << node(index - 1) << " " <<
+                node(index) << " 10\n";
+        netlist << "C" << index << " " << node(index) << " 0 1m\n";
+    }
+    return finish(netlist);
+}
+
+// A square grid, with resistors along its rows and capacitors (or, for an RLC
+// mesh, alternately inductors and capacitors) down its columns, driven at one
+// corner and loaded at the other
+std::string mesh(const unsigned int &size, const bool &inductors) {
+    const unsigned int width = std::max(2u, (unsigned int)std::sqrt(size));
+    std::ostringstream netlist;
+    netlist << "V1 " << grid_node(0, 0) << " 0 SINE(0 1 50)\n";
+    for(unsigned int row = 0; row < width; row += 1) {
+        for(unsigned int column = 0; column < width; column += 1) {
+            const auto here = grid_node(row, column);
+            if(column + 1 < width) {
+                netlist << "R" << row << "_" << column << " " << here << " " <<
+                        grid_node(row, column + 1) << " 10\n";
+            }
+            if(row + 1 < width) {
+                const bool inductor = inductors && (row + column) % 2;
+                netlist << (inductor ? "L" : "C") << row << "_" << column <<
+                        " " << here << " " << grid_node(row + 1, column) <<
+                        (inductor ? " 0.1\n" : " 1m\n");
+            }
+        }
+    }
+    netlist << "R_load " << grid_node(width - 1, width - 1) << " 0 10\n";
+    return finish(netlist);
+}
+
+// A resistive power-distribution grid fed through pads at its corners, with
+// loads drawing current at every fourth node, and decoupling capacitors at
+// every eighth
+std::string power_grid(const unsigned int &size) {
+    const unsigned int width = std::max(2u, (unsigned int)std::sqrt(size));
+    std::ostringstream netlist;
+    const unsigned int corners[4][2] = {
+        {0, 0}, {0, width - 1}, {width - 1, 0}, {width - 1, width - 1}
+    };
+    for(unsigned int index = 0; index < 4; index += 1) {
+        netlist << "V_pad" << index << " P" << index << " 0 1\n";
+        netlist << "R_pad" << index << " P" << index << " " <<
+                grid_node(corners[index][0], corners[index][1]) << " 0.1\n";
+    }
+
+    unsigned int count = 0;
+    for(unsigned int row = 0; row < width; row += 1) {
+        for(unsigned int column = 0; column < width; column += 1) {
+            const auto here = grid_node(row, column);
+            if(column + 1 < width) {
+                netlist << "R" << row << "_" << column << "h " << here <<
+                        " " << grid_node(row, column + 1) << " 0.05\n";
+            }
+            if(row + 1 < width) {
+                netlist << "R" << row << "_" << column << "v " << here <<
+                        " " << grid_node(row + 1, column) << " 0.05\n";
+            }
+            if(count % 4 == 0) {
+                netlist << "I" << row << "_" << column << " " << here <<
+                        " 0 SINE(1m 1m " << 20 + count % 7 * 10 << ")\n";
+            }
+            if(count % 8 == 4) {
+                netlist << "C" << row << "_" << column << " " << here <<
+                        " 0 1m\n";
+            }
+            count += 1;
+        }
+    }
+    return finish(netlist);
+}
+
+// A connected random graph of resistors (a random spanning tree, with half as
+// many edges again between random pairs), with a capacitor to ground at a
+// tenth of its nodes
+std::string random_sparse(const unsigned int &size) {
+    std::mt19937 generator(size);
+    std::ostringstream netlist;
+    netlist << "V1 " << node(0) << " 0 SINE(0 1 50)\n";
+
+    unsigned int count = 0;
+    for(unsigned int index = 1; index < size; index += 1) {
+        std::uniform_int_distribution<unsigned int> earlier(0, index - 1);
+        netlist << "R" << count << " " << node(earlier(generator)) << " " <<
+                node(index) << " 10\n";
+        count += 1;
+    }
+
+    std::uniform_int_distribution<unsigned int> any(0, size - 1);
+    for(unsigned int index = 0; index < size / 2; index += 1) {
+        const unsigned int one = any(generator);
+        const unsigned int two = any(generator);
+        if(one != two) {
+            netlist << "R" << count << " " << node(one) << " " << node(two) <<
+                    " 20\n";
+            count += 1;
+        }
+    }
+
+    for(unsigned int index = 1; index < size; index += 10)
+        netlist << "C" << index << " " << node(index) << " 0 1m\n";
+    return finish(netlist);
+}
+
+// Many sources, each feeding one of a few bus nodes through a resistor, with
+// the buses chained together and loaded to ground
+std::string many_sources(const unsigned int &size) {
+    const unsigned int bus_count = std::max(1u, size / 100);
+    std::ostringstream netlist;
+    for(unsigned int index = 0; index < size; index += 1) {
+        netlist << "V" << index << " " << node(index) << " 0 SINE(0 1 " <<
+                10 + index % 50 << ")\n";
+        netlist << "R" << index << " " << node(index) << " B" <<
+                index % bus_count << " 100\n";
+    }
+    for(unsigned int index = 0; index < bus_count; index += 1) {
+        netlist << "R_bus" << index << " B" << index << " " <<
+                (index + 1 < bus_count ? "B" + std::to_string(index + 1) :
+                std::string("0")) << " 1\n";
+    }
+    return finish(netlist);
+}
+
+// Reads a field of /proc/self/status given in kilobytes (like "VmHWM:"),
+// returning -1 if it isn't there
+long read_status(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status, line)) {
+        if(line.compare(0, field.length(), field) == 0)
+            return std::stol(line.substr(field.length()));
+    }
+    return -1;
+}
+
+// The peak resident memory (in kilobytes) since it was last reset. On Linux
+// the peak is reset through clear_refs, so each run's own is measured; where
+// that isn't allowed, it's the process's peak so far (so circuits should be
+// run one kind at a time, smallest first, to tell their peaks apart)
+long peak_memory() {
+    const long peak = read_status("VmHWM:");
+    if(peak >= 0)
+        return peak;
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Resets the peak resident memory to the present, where the system allows it.
+// Returns false if it couldn't be, so the peak measured after is the
+// process's, not the run's
+bool reset_peak_memory() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if(clear_refs.is_open() == false)
+        return false;
+
+    clear_refs << "5";
+    clear_refs.close();
+    if(clear_refs.fail())
+        return false;
+
+    // Check the peak did come down to what's resident now
+    const long peak = read_status("VmHWM:");
+    const long resident = read_status("VmRSS:");
+    return peak >= 0 && resident >= 0 && peak <= resident;
+}
+
+// Returns the value a fraction of the way through the sorted values given
+double percentile(std::vector<double> values, const double &fraction) {
+    if(values.empty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    const unsigned int index = std::min<unsigned int>(values.size() - 1,
+            std::ceil(fraction * values.size()) - 1);
+    return values[index];
+}
+
+// Writes the median and 95th percentile of some times (given in nanoseconds)
+// as microseconds
+void write_distribution(std::ostream &stream,
+        const std::vector<double> &times) {
+    stream << "{\"count\": " << times.size() << ", \"median_us\": " <<
+            percentile(times, 0.5) / 1e3 << ", \"p95_us\": " <<
+            percentile(times, 0.95) / 1e3 << "}";
+}
+
+// Generates, parses, and runs a circuit the number of times given, writing
+// its timings as a JSON object. Returns the median time of a run (in seconds),
+// or a negative value if it couldn't be run
+double run_circuit(std::ostream &stream, const Generator &generator,
+        const unsigned int &size, const unsigned int &repetitions,
+        const unsigned int &partitions, const bool &iterative) {
+
+    const bool peak_reset = reset_peak_memory();
+    Profiler::clear();
+
+    const auto netlist = generator.generate(size);
+    const auto simulation = Simulation::parse(netlist);
+    if(simulation == nullptr)
+        return -1;
+
+    simulation->operation->partition_count = partitions;
+    simulation->operation->iterative = iterative;
+
+    std::vector<double> run_times;
+    for(unsigned int repetition = 0; repetition < repetitions;
+            repetition += 1) {
+
+        const auto start = std::chrono::steady_clock::now();
+        if(simulation->run(nullptr) == false)
+            return -1;
+
+        run_times.push_back(std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+
+    stream << "    {\"circuit\": \"" << generator.name << "\", \"size\": " <<
+            size << ", \"nodes\": " << simulation->schematic.get_node_count() -
+            1 << ", \"components\": " <<
+            simulation->schematic.get_component_count() << ",\n";
+    stream << "     \"run\": ";
+    write_distribution(stream, run_times);
+    stream << ",\n     \"phases\": {";
+
+    const auto durations = Profiler::get_durations();
+    bool first = true;
+    for(const auto &phase : durations) {
+        stream << (first ? "" : ",") << "\n      \"" << phase.first << "\": ";
+        write_distribution(stream, phase.second);
+        first = false;
+    }
+    stream << "},\n     \"peak_memory_kb\": " << peak_memory() <<
+            ", \"peak_memory_reset\": " << (peak_reset ? "true" : "false") <<
+            "}";
+
+    return percentile(run_times, 0.5) / 1e9;
+}
+
+// Systems solved directly are held densely, several copies at a time, so
+// circuits with more nodes than this would need gigabytes each
+const unsigned int largest_dense_size = 5000;
+
+int main(int argument_count, char *argument_vector[]) {
+
+    // The largest circuit to generate, how many times each is run, the
+    // longest a run can take before the larger sizes of its kind are skipped,
+    // (optionally) the one kind of circuit to run ('all' for every kind), and
+    // whether to solve the systems iteratively
+    unsigned int maximum_size = 1000;
+    unsigned int repetitions = 5;
+    double budget = 30;
+    std::string only;
+    bool iterative = false;
+    if(argument_count > 1)
+        maximum_size = std::stoi(argument_vector[1]);
+    if(argument_count > 2)
+        repetitions = std::max(1, std::stoi(argument_vector[2]));
+    if(argument_count > 3)
+        budget = std::stod(argument_vector[3]);
+    if(argument_count > 4 && std::string(argument_vector[4]) != "all")
+        only = argument_vector[4];
+    if(argument_count > 5)
+        iterative = std::string(argument_vector[5]) == "iterative";
+
+    // The whole-system solve is far too slow for anything but the smallest
+    // systems, so each is partitioned across the processors (unless they're
+    // solved iteratively, which doesn't partition them)
+    const unsigned int partitions = iterative ? 1 : std::max(2u,
+            std::thread::hardware_concurrency());
+
+    const std::vector<Generator> generators = {
+        {"rc_ladder", rc_ladder},
+        {"rc_mesh", [](const unsigned int &size) {
+            return mesh(size, false);
+        }},
+        {"rlc_mesh", [](const unsigned int &size) {
+            return mesh(size, true);
+        }},
+        {"power_grid", power_grid},
+        {"random_sparse", random_sparse},
+        {"many_sources", many_sources}
+    };
+
+    Profiler::enable(false, true);
+
+    std::cout << "{\n  \"solver\": \"" << (iterative ? "iterative" :
+            "direct") << "\",\n  \"partitions\": " << partitions << ",\n" <<
+            "  \"repetitions\": " << repetitions << ",\n  \"results\": [\n";
+    bool first = true;
+    for(const auto &generator : generators) {
+        if(only.empty() == false && generator.name != only)
+            continue;
+
+        for(unsigned int size = 10; size <= maximum_size; size *= 10) {
+            if(first == false)
+                std::cout << ",\n";
+            first = false;
+
+            if(size > largest_dense_size && iterative == false) {
+                std::cout << "    {\"circuit\": \"" << generator.name <<
+                        "\", \"size\": " << size << ", \"skipped\": " <<
+                        "\"too large to hold densely\"}";
+                break;
+            }
+
+            std::cerr << generator.name << ", " << size << " nodes" <<
+                    std::endl;
+            const double time = run_circuit(std::cout, generator, size,
+                    repetitions, partitions, iterative);
+            if(time < 0) {
+                std::cout << "    {\"circuit\": \"" << generator.name <<
+                        "\", \"size\": " << size << ", \"failed\": true}";
+                break;
+            }
+
+            // The time grows faster than the size (far faster, for dense
+            // systems): don't start one that would take too long
+            if(time * 10 > budget && size * 10 <= maximum_size) {
+                std::cout << ",\n    {\"circuit\": \"" << generator.name <<
+                        "\", \"size\": " << size * 10 << ", \"skipped\": " <<
+                        "\"over the time budget\"}";
+                break;
+            }
+        }
+    }
+    std::cout << "\n  ]\n}\n";
+
+    return 0;
+}
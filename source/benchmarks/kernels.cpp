@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../solvers/factorization.hpp"
+#include "../solvers/fixed.hpp"
+#include "../utilities/matrix.hpp"
+
+// Returns a random square matrix, made diagonally dominant so that it's well
+// conditioned
+Matrix random_matrix(const unsigned int &size, std::mt19937 &generator) {
+    std::uniform_real_distribution<double> distribution(-1, 1);
+    Matrix matrix(size, size);
+    for(unsigned int row = 0; row < size; row += 1) {
+        for(unsigned int column = 0; column < size; column += 1)
+            matrix(row, column) = distribution(generator);
+        matrix(row, row) += size;
+    }
+    return matrix;
+}
+
+// Returns the shortest time (in seconds) a function took over some runs
+double time_runs(const std::function<void()> &function,
+        const unsigned int &repetitions) {
+
+    double shortest = INFINITY;
+    for(unsigned int repetition = 0; repetition < repetitions;
+            repetition += 1) {
+
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        shortest = std::min(shortest, std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+    return shortest;
+}
+
+// The product as a plain triple loop, walking the right-hand matrix down its
+// columns (as Matrix's product used to)
+void reference_product(const Matrix &one, const Matrix &two,
+        Matrix &result) {
+
+    const unsigned int size = one.rows();
+    for(unsigned int row = 0; row < size; row += 1) {
+        for(unsigned int column = 0; column < size; column += 1) {
+            double sum = 0;
+            for(unsigned int index = 0; index < size; index += 1)
+                sum += one(row, index) * two(index, column);
+            result(row, column) = sum;
+        }
+    }
+}
+
+// LU factorization with partial pivoting a column at a time, sweeping the
+// whole of the rest of the matrix for each (as Factorization used to)
+bool reference_factorize(std::vector<double> &factors,
+        const unsigned int &size) {
+
+    for(unsigned int index = 0; index < size; index += 1) {
+        unsigned int pivot = index;
+        for(unsigned int row = index + 1; row < size; row += 1) {
+            if(std::fabs(factors[row * size + index]) >
+                    std::fabs(factors[pivot * size + index])) {
+                pivot = row;
+            }
+        }
+
+        if(factors[pivot * size + index] == 0)
+            return false;
+
+        for(unsigned int column = 0; column < size; column += 1) {
+            std::swap(factors[index * size + column],
+                    factors[pivot * size + column]);
+        }
+
+        const double diagonal = factors[index * size + index];
+        for(unsigned int row = index + 1; row < size; row += 1) {
+            double &multiplier = factors[row * size + index];
+            if(multiplier == 0)
+                continue;
+
+            multiplier /= diagonal;
+            for(unsigned int column = index + 1; column < size; column += 1) {
+                factors[row * size + column] -= multiplier *
+                        factors[index * size + column];
+            }
+        }
+    }
+    return true;
+}
+
+// Prints a kernel's time and rate, against the reference's
+void report(const std::string &kernel, const unsigned int &size,
+        const double &operations, const double &time,
+        const double &reference_time, const double &error) {
+
+    std::cout << kernel << ", " << size << ", " << time * 1e3 << ", " <<
+            operations / time / 1e9 << ", " << reference_time * 1e3 << ", " <<
+            operations / reference_time / 1e9 << ", " << reference_time /
+            time << ", " << error << std::endl;
+}
+
+int main(int argument_count, char *argument_vector[]) {
+
+    // The largest matrix to time, and how many times each kernel's run
+    unsigned int maximum_size = 1000;
+    unsigned int repetitions = 3;
+    if(argument_count > 1)
+        maximum_size = std::stoi(argument_vector[1]);
+    if(argument_count > 2)
+        repetitions = std::max(1, std::stoi(argument_vector[2]));
+
+#if defined(__AVX2__) && defined(__FMA__)
+    std::cout << "Kernels: AVX2 and FMA" << std::endl;
+#else
+    std::cout << "Kernels: scalar (build with -mavx2 -mfma, or " <<
+            "-march=native, for the vector kernels)" << std::endl;
+#endif
+
+    std::cout << "kernel, size, time (ms), GFLOP/s, reference time (ms), " <<
+            "reference GFLOP/s, speedup, error" << std::endl;
+
+    std::mt19937 generator(1);
+    const std::vector<unsigned int> sizes = {100, 200, 500, 1000, 2000};
+    for(const auto &size : sizes) {
+        if(size > maximum_size)
+            break;
+
+        const Matrix one = random_matrix(size, generator);
+        const Matrix two = random_matrix(size, generator);
+
+        // The product, whose error is the largest difference from the
+        // reference's, relative to its largest value
+        Matrix product;
+        Matrix reference(size, size);
+        const double product_time = time_runs([&]() {
+            product = one * two;
+        }, repetitions);
+        const double reference_product_time = time_runs([&]() {
+            reference_product(one, two, reference);
+        }, repetitions);
+
+        double difference = 0;
+        double largest = 0;
+        for(unsigned int row = 0; row < size; row += 1) {
+            for(unsigned int column = 0; column < size; column += 1) {
+                difference = std::max(difference, std::fabs(product(row,
+                        column) - reference(row, column)));
+                largest = std::max(largest, std::fabs(reference(row,
+                        column)));
+            }
+        }
+        report("product", size, 2.0 * size * size * size, product_time,
+                reference_product_time, difference / largest);
+
+        // The factorization, whose error is the solution's relative residual
+        Factorization factorization;
+        bool factorized = true;
+        const double factorize_time = time_runs([&]() {
+            factorized = factorization.factorize(one) && factorized;
+        }, repetitions);
+
+        std::vector<double> values(one.data(), one.data() + size * size);
+        std::vector<double> factors;
+        const double reference_factorize_time = time_runs([&]() {
+            factors = values;
+            reference_factorize(factors, size);
+        }, repetitions);
+
+        std::vector<double> solution(size, 1);
+        std::vector<double> constants(size, 0);
+        for(unsigned int row = 0; row < size; row += 1) {
+            for(unsigned int column = 0; column < size; column += 1)
+                constants[row] += one(row, column);
+        }
+        std::copy(constants.begin(), constants.end(), solution.begin());
+        factorization.solve(solution.data());
+
+        // The solution should be all ones; the residual's relative to the
+        // matrix's norm (and the solution's, which is one)
+        double residual = 0;
+        double norm = 0;
+        for(unsigned int row = 0; row < size; row += 1) {
+            double sum = -constants[row];
+            double row_sum = 0;
+            for(unsigned int column = 0; column < size; column += 1) {
+                sum += one(row, column) * solution[column];
+                row_sum += std::fabs(one(row, column));
+            }
+            residual = std::max(residual, std::fabs(sum));
+            norm = std::max(norm, row_sum);
+        }
+        if(factorized == false)
+            residual = INFINITY;
+
+        report("lu", size, 2.0 / 3 * size * size * size, factorize_time,
+                reference_factorize_time, residual / norm);
+
+        // A compound expression, evaluated in a single loop into a result
+        // already its size, against the same steps through temporaries (as
+        // Matrix's operators used to make). Both are times the whole run
+        Matrix vector(1, size);
+        Matrix offsets(1, size);
+        for(unsigned int row = 0; row < size; row += 1) {
+            vector(row, 0) = 1.0 / (row + 1);
+            offsets(row, 0) = row;
+        }
+
+        const unsigned int evaluation_count = 100;
+        Matrix fused(1, size);
+        const double fused_time = time_runs([&]() {
+            for(unsigned int index = 0; index < evaluation_count;
+                    index += 1) {
+
+                fused = one * vector + offsets * 2.0;
+            }
+        }, repetitions);
+
+        Matrix unfused;
+        const double unfused_time = time_runs([&]() {
+            for(unsigned int index = 0; index < evaluation_count;
+                    index += 1) {
+
+                Matrix product(one);
+                product *= vector;
+                Matrix scaled(offsets);
+                scaled *= 2.0;
+                Matrix sum(product);
+                sum += scaled;
+                unfused = sum;
+            }
+        }, repetitions);
+
+        difference = 0;
+        for(unsigned int row = 0; row < size; row += 1) {
+            difference = std::max(difference, std::fabs(fused(row, 0) -
+                    unfused(row, 0)));
+        }
+        report("expression", size, evaluation_count * (2.0 * size * size +
+                2.0 * size), fused_time, unfused_time, difference);
+    }
+
+    // Small systems, factorized and solved many times over (as a transient
+    // does each step) by the solver of their size, against Factorization.
+    // The error's the largest difference between their solutions
+    const unsigned int solve_count = 100000;
+    for(unsigned int size = 2; size <= FixedSolver::largest_size;
+            size *= 2) {
+
+        const Matrix matrix = random_matrix(size, generator);
+        const auto fixed = FixedSolver::create(size);
+        std::vector<double> solution(size);
+        const double fixed_time = time_runs([&]() {
+            for(unsigned int index = 0; index < solve_count; index += 1) {
+                fixed->factorize(matrix.data());
+                std::fill(solution.begin(), solution.end(), 1);
+                fixed->solve(solution.data());
+            }
+        }, repetitions);
+
+        Factorization factorization;
+        std::vector<double> reference(size);
+        const double reference_time = time_runs([&]() {
+            for(unsigned int index = 0; index < solve_count; index += 1) {
+                factorization.factorize(matrix);
+                std::fill(reference.begin(), reference.end(), 1);
+                factorization.solve(reference.data());
+            }
+        }, repetitions);
+
+        double difference = 0;
+        for(unsigned int index = 0; index < size; index += 1) {
+            difference = std::max(difference, std::fabs(solution[index] -
+                    reference[index]));
+        }
+        report("fixed", size, solve_count * (2.0 / 3 * size * size * size +
+                2.0 * size * size), fixed_time, reference_time, difference);
+    }
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cmath>
+#include <cstdlib>
+
+#include "../utilities/parse.hpp"
+
+// The metric value parser as it was before it was rewritten, kept here so the
+// two can be compared
+double legacy_parse_metric_value(const std::string &value) {
+
+    static std::map<char, int> metric_prefixes = {
+        {'f', -15},
+        {'p', -12},
+        {'n', -9},
+        {'u', -6},
+        {'m', -3},
+        {'k', 3},
+        {'g', 9},
+        {'t', 12}
+    };
+
+    std::string result;
+    int factor = 0;
+    for(unsigned int index = 0; index < value.length(); index += 1) {
+        const auto character = value[index];
+
+        if((character >= '0' && character <= '9') || character == '-' ||
+                character == '.') {
+
+            result += character;
+        }
+
+        else {
+            if(factor)
+                throw -1;
+
+            else if(value.substr(index, 3) == "Meg") {
+                factor = 6;
+                index += 3;
+            }
+            else if(value.substr(index, 2) == std::string({-62, -75})) {
+                factor = -6;
+                index += 2;
+            }
+
+            else if(metric_prefixes.find(std::tolower(character)) !=
+                    metric_prefixes.end()) {
+
+                factor = metric_prefixes[character];
+            }
+
+            else
+                throw -1;
+
+            if(index < value.length())
+                result += '.';
+        }
+    }
+
+    return std::stof(result) * std::pow(10, factor);
+}
+
+// Generates values of the forms "123.45k" and "4k7", using the prefixes both
+// parsers understand
+std::vector<std::string> generate_values(const unsigned int &count) {
+    static const std::vector<std::string> prefixes = {
+        "", "f", "p", "n", "u", "m", "k", "g", "t"
+    };
+
+    std::mt19937 generator(1);
+    std::uniform_int_distribution<unsigned int> integer(0, 99999);
+    std::uniform_int_distribution<unsigned int> fraction(0, 999);
+    std::uniform_int_distribution<unsigned int> prefix(0,
+            prefixes.size() - 1);
+    std::uniform_int_distribution<unsigned int> form(0, 3);
+
+    std::vector<std::string> values;
+    values.reserve(count);
+    for(unsigned int index = 0; index < count; index += 1) {
+        const auto &symbol = prefixes[prefix(generator)];
+        const auto whole = std::to_string(integer(generator));
+        const auto part = std::to_string(fraction(generator));
+
+        if(form(generator) == 0 && symbol.empty() == false)
+            values.push_back(whole + symbol + part);
+        else
+            values.push_back(whole + "." + part + symbol);
+    }
+    return values;
+}
+
+// Reference value for a generated string: the prefix rewritten as an exponent
+// (or a decimal point, if it's part-way through), and converted by strtod
+// (which rounds correctly)
+double reference_value(const std::string &value) {
+    static const std::map<char, int> factors = {
+        {'f', -15}, {'p', -12}, {'n', -9}, {'u', -6}, {'m', -3}, {'k', 3},
+        {'g', 9}, {'t', 12}
+    };
+
+    std::string number;
+    int factor = 0;
+    for(const auto &character : value) {
+        const auto match = factors.find(character);
+        if(match == factors.end())
+            number += character;
+        else {
+            factor = match->second;
+            if(number.find('.') == std::string::npos)
+                number += '.';
+        }
+    }
+    number += "e" + std::to_string(factor);
+    return std::strtod(number.c_str(), nullptr);
+}
+
+// Times a parser over every value, returning the nanoseconds taken per value
+template <typename Parser>
+double time_parser(const std::vector<std::string> &values, Parser parser,
+        std::vector<double> &results) {
+
+    results.resize(values.size());
+    const auto start = std::chrono::steady_clock::now();
+    for(unsigned int index = 0; index < values.size(); index += 1)
+        results[index] = parser(values[index]);
+    const auto stop = std::chrono::steady_clock::now();
+
+    const std::chrono::duration<double, std::nano> duration = stop - start;
+    return duration.count() / values.size();
+}
+
+int main(int argument_count, char *argument_vector[]) {
+
+    unsigned int count = 4000000;
+    if(argument_count > 1)
+        count = std::stoi(argument_vector[1]);
+
+    const auto values = generate_values(count);
+
+    std::vector<double> legacy_results;
+    std::vector<double> results;
+    const double legacy_time = time_parser(values,
+            [](const std::string &value) {
+                return legacy_parse_metric_value(value);
+            }, legacy_results);
+    const double time = time_parser(values,
+            [](const std::string &value) {
+                return parse_metric_value(value);
+            }, results);
+
+    // Compare both against the correctly-rounded reference
+    unsigned int legacy_exact = 0;
+    unsigned int exact = 0;
+    double legacy_error = 0;
+    double error = 0;
+    for(unsigned int index = 0; index < values.size(); index += 1) {
+        const double reference = reference_value(values[index]);
+        const double scale = (reference == 0) ? 1 : std::fabs(reference);
+
+        legacy_exact += legacy_results[index] == reference;
+        exact += results[index] == reference;
+        legacy_error = std::max(legacy_error,
+                std::fabs(legacy_results[index] - reference) / scale);
+        error = std::max(error, std::fabs(results[index] - reference) / scale);
+    }
+
+    std::cout << "parser, ns per value, exact results, max relative error" <<
+            std::endl;
+    std::cout << "legacy, " << legacy_time << ", " << legacy_exact << "/" <<
+            count << ", " << legacy_error << std::endl;
+    std::cout << "current, " << time << ", " << exact << "/" << count <<
+            ", " << error << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,458 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "simulation.hpp"
+#include "utilities/hash.hpp"
+
+/* ******************************************************************** Synopsis
+
+Parsing a netlist means tokenizing it, hashing every name, and building the
+schematic one component at a time. For short runs that dominates, so the
+parsed circuit can be cached on disk, in a compiled form which is keyed by a
+hash of the netlist's text.
+
+A cache file is laid out as follows (every section is 8-byte aligned, and
+native-endian, since the cache is only ever read back on the machine which
+wrote it):
+
+    Header      magic, format version, key, transient parameters, and the
+                size of each section below
+    Nodes       a (offset, length) pair per node, into the string pool; the
+                node's ID in the schematic is its position in this table (so
+                ground, "0", is always first)
+    Functions   a kind, and seven parameters, per source function
+    Components  type, name (offset, length), node IDs, value, function ID
+    Strings     every node and component name, back-to-back
+
+Loading maps the file in with a single mmap, validates the header, and builds
+the schematic directly from the records: the node names are interned into its
+table straight from the string pool, in order, and the components are given
+the node IDs stored in their records, so no node name is copied or looked up
+per component. Only the components' names are copied out, as they're kept.
+
+*/
+
+class CircuitCache {
+
+private:
+
+    static const std::uint32_t version = 2;
+
+    enum FunctionKind : std::uint32_t {
+        CONSTANT,
+        SINUSOID
+    };
+
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+
+        double start_time;
+        double stop_time;
+        double time_step;
+
+        std::uint32_t node_count;
+        std::uint32_t function_count;
+        std::uint32_t component_count;
+        std::uint32_t string_bytes;
+    };
+
+    struct NodeRecord {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct FunctionRecord {
+        std::uint32_t kind;
+        std::uint32_t padding;
+        double parameters[7];
+    };
+
+    struct ComponentRecord {
+        std::uint32_t type;
+        std::uint32_t name_offset;
+        std::uint32_t name_length;
+        std::uint32_t nodes[2];
+        std::uint32_t function;
+        double value;
+    };
+
+    static const std::uint32_t no_function = 0xffffffff;
+
+    static bool fits(const std::uint32_t &offset, const std::uint32_t &length,
+            const std::uint32_t &size);
+
+    static bool write_function(const Function *function,
+            FunctionRecord &record);
+    static Function *read_function(const FunctionRecord &record,
+            Arena &arena);
+
+public:
+
+    static std::uint64_t key(const std::string &specification);
+    static std::string path(const std::string &directory,
+            const std::uint64_t &key);
+
+    static std::shared_ptr<Simulation> load(const std::string &path,
+            const std::uint64_t &key);
+    static bool save(Simulation &simulation, const std::string &path,
+            const std::uint64_t &key);
+
+};
+
+// Keys a netlist by a hash of its content
+std::uint64_t CircuitCache::key(const std::string &specification) {
+    const char *format = "blackfriars-cache";
+    const auto seed = hash_content(format, std::strlen(format));
+    return hash_content(specification.data(), specification.length(),
+            seed ^ version);
+}
+
+// Returns the path of the cache file for a given key
+std::string CircuitCache::path(const std::string &directory,
+        const std::uint64_t &key) {
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bfc",
+            static_cast<unsigned long long>(key));
+
+    if(directory.empty() || directory.back() == '/')
+        return directory + name;
+    return directory + "/" + name;
+}
+
+// True if the span of a given offset and length lies within a given size
+// (without adding them, which could wrap)
+bool CircuitCache::fits(const std::uint32_t &offset,
+        const std::uint32_t &length, const std::uint32_t &size) {
+
+    return offset <= size && length <= size - offset;
+}
+
+// Fills a function record, returning false if the function can't be cached
+bool CircuitCache::write_function(const Function *function,
+        FunctionRecord &record) {
+
+    std::memset(&record, 0, sizeof(record));
+
+    if(const auto constant = dynamic_cast<const Constant *>(function)) {
+        record.kind = CONSTANT;
+        record.parameters[0] = constant->offset;
+        return true;
+    }
+
+    if(const auto sinusoid = dynamic_cast<const Sinusoid *>(function)) {
+        record.kind = SINUSOID;
+        record.parameters[0] = sinusoid->offset;
+        record.parameters[1] = sinusoid->amplitude;
+        record.parameters[2] = sinusoid->frequency;
+        record.parameters[3] = sinusoid->delay;
+        record.parameters[4] = sinusoid->theta;
+        record.parameters[5] = sinusoid->phi;
+        record.parameters[6] = sinusoid->cycles;
+        return true;
+    }
+
+    return false;
+}
+
+// Re-creates a function from its record, in the arena given
+Function *CircuitCache::read_function(const FunctionRecord &record,
+        Arena &arena) {
+
+    if(record.kind == CONSTANT) {
+        auto constant = arena.create<Constant>();
+        constant->offset = record.parameters[0];
+        return constant;
+    }
+
+    if(record.kind == SINUSOID) {
+        auto sinusoid = arena.create<Sinusoid>();
+        sinusoid->offset = record.parameters[0];
+        sinusoid->amplitude = record.parameters[1];
+        sinusoid->frequency = record.parameters[2];
+        sinusoid->delay = record.parameters[3];
+        sinusoid->theta = record.parameters[4];
+        sinusoid->phi = record.parameters[5];
+        sinusoid->cycles = record.parameters[6];
+        return sinusoid;
+    }
+
+    return nullptr;
+}
+
+// Loads a cached simulation, returning nullptr if there's no valid cache file
+// for the key at the path given
+std::shared_ptr<Simulation> CircuitCache::load(const std::string &path,
+        const std::uint64_t &key) {
+
+    const int file = open(path.c_str(), O_RDONLY);
+    if(file == -1)
+        return nullptr;
+
+    struct stat status;
+    if(fstat(file, &status) == -1 || status.st_size < (off_t)sizeof(Header)) {
+        close(file);
+        return nullptr;
+    }
+
+    const std::size_t size = status.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(mapping == MAP_FAILED)
+        return nullptr;
+
+    const char *data = static_cast<const char *>(mapping);
+    const auto release = [&]() {
+        munmap(mapping, size);
+        return std::shared_ptr<Simulation>();
+    };
+
+    // Check the header matches this format and netlist, and that the sections
+    // it describes actually fit in the file
+    const Header &header = *reinterpret_cast<const Header *>(data);
+    if(std::memcmp(header.magic, "BFCC", 4) != 0 ||
+            header.version != version || header.key != key) {
+        return release();
+    }
+
+    const std::size_t nodes_offset = sizeof(Header);
+    const std::size_t functions_offset = nodes_offset +
+            header.node_count * sizeof(NodeRecord);
+    const std::size_t components_offset = functions_offset +
+            header.function_count * sizeof(FunctionRecord);
+    const std::size_t strings_offset = components_offset +
+            header.component_count * sizeof(ComponentRecord);
+    if(strings_offset + header.string_bytes != size)
+        return release();
+
+    const auto nodes = reinterpret_cast<const NodeRecord *>(data +
+            nodes_offset);
+    const auto function_records = reinterpret_cast<const FunctionRecord *>(
+            data + functions_offset);
+    const auto components = reinterpret_cast<const ComponentRecord *>(data +
+            components_offset);
+    const char *strings = data + strings_offset;
+
+    // Fill the schematic's node table from the records; each name has to
+    // take the ID of its position, as the components refer to them by it
+    auto simulation = std::shared_ptr<Simulation>(new Simulation());
+    auto &arena = simulation->arena;
+    auto &schematic = simulation->schematic;
+    for(unsigned int index = 0; index < header.node_count; index += 1) {
+        const auto &node = nodes[index];
+        if(fits(node.offset, node.length, header.string_bytes) == false ||
+                schematic.add_node(strings + node.offset, node.length) !=
+                index) {
+            return release();
+        }
+    }
+
+    // Re-create the functions
+    std::vector<Function *> functions(header.function_count);
+    for(unsigned int index = 0; index < header.function_count; index += 1) {
+        functions[index] = read_function(function_records[index], arena);
+        if(functions[index] == nullptr)
+            return release();
+    }
+
+    auto transient = std::shared_ptr<Transient>(new Transient());
+    transient->start_time = header.start_time;
+    transient->stop_time = header.stop_time;
+    transient->time_step = header.time_step;
+    simulation->operation = transient;
+
+    // Build the components from their records
+    for(unsigned int index = 0; index < header.component_count; index += 1) {
+        const auto &record = components[index];
+        if(fits(record.name_offset, record.name_length,
+                header.string_bytes) == false ||
+                record.nodes[0] >= header.node_count ||
+                record.nodes[1] >= header.node_count) {
+            return release();
+        }
+
+        Component *component = nullptr;
+        Source *source = nullptr;
+        switch(record.type) {
+            case Component::CAPACITOR: {
+                auto capacitor = arena.create<Capacitor>();
+                capacitor->value = record.value;
+                component = capacitor;
+                break;
+            }
+            case Component::INDUCTOR: {
+                auto inductor = arena.create<Inductor>();
+                inductor->value = record.value;
+                component = inductor;
+                break;
+            }
+            case Component::RESISTOR: {
+                auto resistor = arena.create<Resistor>();
+                resistor->value = record.value;
+                component = resistor;
+                break;
+            }
+            case Component::CURRENT_SOURCE: {
+                auto current_source = arena.create<CurrentSource>();
+                source = current_source;
+                component = current_source;
+                break;
+            }
+            case Component::VOLTAGE_SOURCE: {
+                auto voltage_source = arena.create<VoltageSource>();
+                source = voltage_source;
+                component = voltage_source;
+                break;
+            }
+            default:
+                return release();
+        }
+
+        if(source) {
+            if(record.function >= header.function_count)
+                return release();
+            source->function = functions[record.function];
+        }
+
+        component->name.assign(strings + record.name_offset,
+                record.name_length);
+        component->node_ids[0] = record.nodes[0];
+        component->node_ids[1] = record.nodes[1];
+
+        if(schematic.add_connected_component(component) == false)
+            return release();
+    }
+
+    munmap(mapping, size);
+    return simulation;
+}
+
+// Writes a compiled simulation to the path given, returning false if it
+// couldn't be written, or contains something which can't be cached
+bool CircuitCache::save(Simulation &simulation, const std::string &path,
+        const std::uint64_t &key) {
+
+    const auto transient = std::dynamic_pointer_cast<Transient>(
+            simulation.operation);
+    if(transient == nullptr)
+        return false;
+
+    std::vector<NodeRecord> nodes;
+    std::vector<FunctionRecord> functions;
+    std::vector<ComponentRecord> components;
+    std::string strings;
+
+    // The nodes are written in the order of their IDs in the schematic, so
+    // each name appears only once in the string pool, and the components'
+    // node IDs can be written as they are
+    for(const auto &node : simulation.schematic.get_node_names()) {
+        nodes.push_back({(std::uint32_t)strings.size(), node.length});
+        strings.append(node.data, node.length);
+    }
+
+    std::map<const Function *, std::uint32_t> function_ids;
+
+    for(const auto &component : simulation.schematic.get_components()) {
+        ComponentRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.type = component->type;
+        record.name_offset = strings.size();
+        record.name_length = component->name.size();
+        strings += component->name;
+        record.nodes[0] = component->node_ids[0];
+        record.nodes[1] = component->node_ids[1];
+        record.function = no_function;
+
+        switch(component->type) {
+            case Component::CAPACITOR:
+                record.value = static_cast<Capacitor *>(component)->value;
+                break;
+            case Component::INDUCTOR:
+                record.value = static_cast<Inductor *>(component)->value;
+                break;
+            case Component::RESISTOR:
+                record.value = static_cast<Resistor *>(component)->value;
+                break;
+            case Component::CURRENT_SOURCE:
+            case Component::VOLTAGE_SOURCE: {
+                const Function *function = (component->type ==
+                        Component::CURRENT_SOURCE) ?
+                        static_cast<CurrentSource *>(component)->function :
+                        static_cast<VoltageSource *>(component)->function;
+
+                // Functions shared between components (as they are between
+                // subcircuit instances) are only written once
+                const auto match = function_ids.find(function);
+                if(match != function_ids.end()) {
+                    record.function = match->second;
+                    break;
+                }
+
+                FunctionRecord function_record;
+                if(write_function(function, function_record) == false)
+                    return false;
+                record.function = functions.size();
+                function_ids[function] = record.function;
+                functions.push_back(function_record);
+                break;
+            }
+            default:
+                return false;
+        }
+
+        components.push_back(record);
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "BFCC", 4);
+    header.version = version;
+    header.key = key;
+    header.start_time = transient->start_time;
+    header.stop_time = transient->stop_time;
+    header.time_step = transient->time_step;
+    header.node_count = nodes.size();
+    header.function_count = functions.size();
+    header.component_count = components.size();
+    header.string_bytes = strings.size();
+
+    // Write to a temporary file first, and move it into place, so a reader
+    // never sees a partially-written cache
+    const std::string temporary = path + ".tmp." + std::to_string(getpid());
+    std::FILE *file = std::fopen(temporary.c_str(), "wb");
+    if(file == nullptr)
+        return false;
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    written &= std::fwrite(nodes.data(), sizeof(NodeRecord), nodes.size(),
+            file) == nodes.size();
+    written &= std::fwrite(functions.data(), sizeof(FunctionRecord),
+            functions.size(), file) == functions.size();
+    written &= std::fwrite(components.data(), sizeof(ComponentRecord),
+            components.size(), file) == components.size();
+    written &= std::fwrite(strings.data(), 1, strings.size(), file) ==
+            strings.size();
+    written &= std::fclose(file) == 0;
+
+    if(written == false || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
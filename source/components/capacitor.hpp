@@ -7,23 +7,30 @@ class Capacitor : public Passive, public Component {
 
 public:
 
-    double value;
+    Capacitor() {
+        type = CAPACITOR;
+    }
 
-    static std::shared_ptr<Capacitor> parse(TextBuffer &buffer);
+    static Capacitor *parse(TextBuffer &buffer, Arena &arena);
 
-    void simulate(const std::shared_ptr<Transient> &transient,
-            const Schematic &schematic, const double &time) override;
+    Component *clone(Arena &arena) const override;
+
+    void simulate(Transient &transient, const Schematic &schematic,
+            const double &time) override;
 
 };
 
-std::shared_ptr<Capacitor> Capacitor::parse(TextBuffer &buffer) {
-    return Passive::parse<Capacitor>(buffer, 'C');
+Capacitor *Capacitor::parse(TextBuffer &buffer, Arena &arena) {
+    return Passive::parse<Capacitor>(buffer, 'C', arena);
+}
+
+Component *Capacitor::clone(Arena &arena) const {
+    return arena.create<Capacitor>(*this);
 }
 
-void Capacitor::simulate(const std::shared_ptr<Transient> &transient,
-        const Schematic &schematic, const double &time) {
+void Capacitor::simulate(Transient &transient, const Schematic &schematic,
+        const double &time) {
 
-    const double voltage = (1 / value) * transient->get_current_integral(
-            hash);
-    transient->add_voltage(node_hashes[0], node_hashes[1], hash, voltage);
+    const double voltage = (1 / value) * transient.get_current_integral(id);
+    transient.add_voltage(node_ids[0], node_ids[1], id, voltage);
 }
@@ -7,19 +7,29 @@ class CurrentSource : public Source, public Component {
 
 public:
 
-    static std::shared_ptr<CurrentSource> parse(TextBuffer &buffer);
+    CurrentSource() {
+        type = CURRENT_SOURCE;
+    }
 
-    void simulate(const std::shared_ptr<Transient> &transient,
-            const Schematic &schematic, const double &time) override;
+    static CurrentSource *parse(TextBuffer &buffer, Arena &arena);
+
+    Component *clone(Arena &arena) const override;
+
+    void simulate(Transient &transient, const Schematic &schematic,
+            const double &time) override;
 
 };
 
-std::shared_ptr<CurrentSource> CurrentSource::parse(TextBuffer &buffer) {
-    return Source::parse<CurrentSource>(buffer, 'I');
+CurrentSource *CurrentSource::parse(TextBuffer &buffer, Arena &arena) {
+    return Source::parse<CurrentSource>(buffer, 'I', arena);
+}
+
+Component *CurrentSource::clone(Arena &arena) const {
+    return arena.create<CurrentSource>(*this);
 }
 
-void CurrentSource::simulate(const std::shared_ptr<Transient> &transient,
-        const Schematic &schematic, const double &time) {
+void CurrentSource::simulate(Transient &transient, const Schematic &schematic,
+        const double &time) {
 
-    transient->add_current(node_hashes[0], node_hashes[1], hash, value(time));
+    transient.add_current(node_ids[0], node_ids[1], id, value(time));
 }
@@ -7,23 +7,31 @@ class Inductor : public Passive, public Component {
 
 public:
 
-    double value;
+    Inductor() {
+        type = INDUCTOR;
+    }
 
-    static std::shared_ptr<Inductor> parse(TextBuffer &buffer);
+    static Inductor *parse(TextBuffer &buffer, Arena &arena);
 
-    void simulate(const std::shared_ptr<Transient> &transient,
-            const Schematic &schematic, const double &time) override;
+    Component *clone(Arena &arena) const override;
+
+    void simulate(Transient &transient, const Schematic &schematic,
+            const double &time) override;
 
 };
 
-std::shared_ptr<Inductor> Inductor::parse(TextBuffer &buffer) {
-    return Passive::parse<Inductor>(buffer, 'L');
+Inductor *Inductor::parse(TextBuffer &buffer, Arena &arena) {
+    return Passive::parse<Inductor>(buffer, 'L', arena);
+}
+
+Component *Inductor::clone(Arena &arena) const {
+    return arena.create<Inductor>(*this);
 }
 
-void Inductor::simulate(const std::shared_ptr<Transient> &transient,
-        const Schematic &schematic, const double &time) {
+void Inductor::simulate(Transient &transient, const Schematic &schematic,
+        const double &time) {
 
-    const double current = (1 / value) * transient->get_voltage_integral(
-            node_hashes[0], node_hashes[1]);
-    transient->add_current(node_hashes[0], node_hashes[1], hash, current);
+    const double current = (1 / value) * transient.get_voltage_integral(
+            node_ids[0], node_ids[1]);
+    transient.add_current(node_ids[0], node_ids[1], id, current);
 }
@@ -7,21 +7,29 @@ class Resistor : public Passive, public Component {
 
 public:
 
-    double value;
+    Resistor() {
+        type = RESISTOR;
+    }
 
-    static std::shared_ptr<Resistor> parse(TextBuffer &buffer);
+    static Resistor *parse(TextBuffer &buffer, Arena &arena);
 
-    void simulate(const std::shared_ptr<Transient> &transient,
-            const Schematic &schematic, const double &time) override;
+    Component *clone(Arena &arena) const override;
+
+    void simulate(Transient &transient, const Schematic &schematic,
+            const double &time) override;
 
 };
 
-std::shared_ptr<Resistor> Resistor::parse(TextBuffer &buffer) {
-    return Passive::parse<Resistor>(buffer, 'R');
+Resistor *Resistor::parse(TextBuffer &buffer, Arena &arena) {
+    return Passive::parse<Resistor>(buffer, 'R', arena);
+}
+
+Component *Resistor::clone(Arena &arena) const {
+    return arena.create<Resistor>(*this);
 }
 
-void Resistor::simulate(const std::shared_ptr<Transient> &transient,
-        const Schematic &schematic, const double &time) {
+void Resistor::simulate(Transient &transient, const Schematic &schematic,
+        const double &time) {
 
-    transient->add_resistance(node_hashes[0], node_hashes[1], hash, value);
+    transient.add_resistance(node_ids[0], node_ids[1], id, value);
 }
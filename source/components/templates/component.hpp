@@ -1,8 +1,9 @@
 #pragma once
 
-#include <memory>
+#include <array>
+#include <string>
 
-#include "../../utilities/hash.hpp"
+#include "../../utilities/arena.hpp"
 #include "../../utilities/parse.hpp"
 #include "../../utilities/text_buffer.hpp"
 
@@ -28,22 +29,34 @@ public:
 
     std::string name;
 
-    Hash hash;
+    // Dense ID of the component's name, assigned when it's added to a
+    // schematic
+    unsigned int id;
 
-    std::vector<std::string> node_names;
+    // Names of the nodes the component's connected to, as parsed (left empty
+    // for components added with their node IDs already assigned, as
+    // subcircuits' copies are)
+    std::array<std::string, 2> node_names;
 
-    std::vector<Hash> node_hashes;
+    // Dense IDs of the nodes named above, assigned when the component's added
+    // to a schematic (ground is always zero)
+    std::array<unsigned int, 2> node_ids;
 
     Type type;
 
     Component() {
-        node_hashes.resize(2);
-        node_names.resize(2);
-        hash = 0;
+        node_ids = {0, 0};
+        id = 0;
         type = NONE;
     }
 
-    virtual void simulate(const std::shared_ptr<Transient> &operation,
-            const Schematic &schematic, const double &time) = 0;
+    virtual ~Component() {}
+
+    // Returns a copy of the component, created in the arena given (used to
+    // instantiate subcircuits)
+    virtual Component *clone(Arena &arena) const = 0;
+
+    virtual void simulate(Transient &transient, const Schematic &schematic,
+            const double &time) = 0;
 
 };
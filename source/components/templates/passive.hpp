@@ -2,8 +2,6 @@
 
 #include "component.hpp"
 
-#include "../../utilities/hash.hpp"
-
 class Passive {
 
 public:
@@ -11,17 +9,18 @@ public:
     double value;
 
     template <typename PassiveType>
-    static std::shared_ptr<PassiveType> parse(TextBuffer &buffer,
-            const char &symbol);
+    static PassiveType *parse(TextBuffer &buffer, const char &symbol,
+            Arena &arena);
 
 };
 
-// Parse a passive component of indeterminate type
+// Parse a passive component of indeterminate type, creating it in the arena
+// given
 template <typename PassiveType>
-std::shared_ptr<PassiveType> Passive::parse(TextBuffer &buffer,
-        const char &symbol) {
+PassiveType *Passive::parse(TextBuffer &buffer, const char &symbol,
+        Arena &arena) {
 
-    auto passive = std::shared_ptr<PassiveType>(new PassiveType());
+    auto passive = arena.create<PassiveType>();
 
     static std::map<char, std::string> symbol_names = {
         {'C', "capacitor"},
@@ -47,15 +46,12 @@ std::shared_ptr<PassiveType> Passive::parse(TextBuffer &buffer,
 
     // Extract the passive's name
     passive->name = buffer.get_string(true);
-    passive->hash = hash_value(passive->name);
 
     // Extract the passive's nodes
     buffer.skip_whitespace();
     passive->node_names[0] = buffer.get_string(true);
-    passive->node_hashes[0] = hash_node(passive->node_names[0]);
     buffer.skip_whitespace();
     passive->node_names[1] = buffer.get_string(true);
-    passive->node_hashes[1] = hash_node(passive->node_names[1]);
 
     // Parse its value
     buffer.skip_whitespace();
@@ -8,15 +8,15 @@
 
 #include "component.hpp"
 
-#include "../../utilities/hash.hpp"
-
 class Function {
 
 public:
 
+    virtual ~Function() {}
+
     virtual double value(const double &time) const = 0;
 
-    static std::shared_ptr<Function> parse(TextBuffer &buffer);
+    static Function *parse(TextBuffer &buffer, Arena &arena);
 
 };
 
@@ -26,15 +26,15 @@ public:
 
     double offset;
 
-    static std::shared_ptr<Constant> parse(TextBuffer &buffer);
+    static Constant *parse(TextBuffer &buffer, Arena &arena);
 
     double value(const double &time) const override;
 
 };
 
 // Parse a constant value
-std::shared_ptr<Constant> Constant::parse(TextBuffer &buffer) {
-    auto constant = std::shared_ptr<Constant>(new Constant());
+Constant *Constant::parse(TextBuffer &buffer, Arena &arena) {
+    auto constant = arena.create<Constant>();
 
     const auto value = buffer.get_string(true);
     try {
@@ -65,7 +65,7 @@ public:
     double phi; // Phase
     double cycles;
 
-    static std::shared_ptr<Sinusoid> parse(TextBuffer &buffer);
+    static Sinusoid *parse(TextBuffer &buffer, Arena &arena);
 
     Sinusoid() {
         offset = 0;
@@ -82,8 +82,8 @@ public:
 };
 
 // Parse a sinusoid function
-std::shared_ptr<Sinusoid> Sinusoid::parse(TextBuffer &buffer) {
-    auto sinusoid = std::shared_ptr<Sinusoid>(new Sinusoid());
+Sinusoid *Sinusoid::parse(TextBuffer &buffer, Arena &arena) {
+    auto sinusoid = arena.create<Sinusoid>();
 
     buffer.skip_string("SINE(");
 
@@ -143,11 +143,11 @@ double Sinusoid::value(const double &time) const {
 }
 
 // Parse a value of indeterminate type
-std::shared_ptr<Function> Function::parse(TextBuffer &buffer) {
+Function *Function::parse(TextBuffer &buffer, Arena &arena) {
     if(buffer.get_string(false, {'('}) == "SINE")
-        return Sinusoid::parse(buffer);
+        return Sinusoid::parse(buffer, arena);
     else
-        return Constant::parse(buffer);
+        return Constant::parse(buffer, arena);
 }
 
 // *********************************************************** Source base class
@@ -156,11 +156,17 @@ class Source {
 
 public:
 
-    std::shared_ptr<Function> function;
+    // The source's function, which is owned by the arena it was parsed into
+    // (and may be shared with other sources)
+    Function *function;
+
+    Source() {
+        function = nullptr;
+    }
 
     template <typename SourceType>
-    static std::shared_ptr<SourceType> parse(TextBuffer &buffer,
-            const char &symbol);
+    static SourceType *parse(TextBuffer &buffer, const char &symbol,
+            Arena &arena);
 
     double value(const double &time) const;
 
@@ -168,10 +174,10 @@ public:
 
 // Parses a source definition
 template <typename SourceType>
-std::shared_ptr<SourceType> Source::parse(TextBuffer &buffer,
-        const char &symbol) {
+SourceType *Source::parse(TextBuffer &buffer, const char &symbol,
+        Arena &arena) {
 
-    auto source = std::shared_ptr<SourceType>(new SourceType());
+    auto source = arena.create<SourceType>();
 
     static std::map<char, std::string> symbol_names = {
         {'I', "current source"},
@@ -196,18 +202,15 @@ std::shared_ptr<SourceType> Source::parse(TextBuffer &buffer,
 
     // Extract the source's name and nodes
     source->name = buffer.get_string(true);
-    source->hash = hash_value(source->name);
 
     buffer.skip_whitespace();
     source->node_names[0] = buffer.get_string(true);
-    source->node_hashes[0] = hash_node(source->node_names[0]);
     buffer.skip_whitespace();
     source->node_names[1] = buffer.get_string(true);
-    source->node_hashes[1] = hash_node(source->node_names[1]);
 
     // Parse its function
     buffer.skip_whitespace();
-    const auto function = Function::parse(buffer);
+    const auto function = Function::parse(buffer, arena);
     if(function == nullptr) {
        std::cerr << "Couldn't parse " << symbol_names[symbol] <<
                "'s value field" << std::endl;
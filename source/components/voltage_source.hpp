@@ -7,19 +7,29 @@ class VoltageSource : public Source, public Component {
 
 public:
 
-    static std::shared_ptr<VoltageSource> parse(TextBuffer &buffer);
+    VoltageSource() {
+        type = VOLTAGE_SOURCE;
+    }
 
-    void simulate(const std::shared_ptr<Transient> &transient,
-            const Schematic &schematic, const double &time) override;
+    static VoltageSource *parse(TextBuffer &buffer, Arena &arena);
+
+    Component *clone(Arena &arena) const override;
+
+    void simulate(Transient &transient, const Schematic &schematic,
+            const double &time) override;
 
 };
 
-std::shared_ptr<VoltageSource> VoltageSource::parse(TextBuffer &buffer) {
-    return Source::parse<VoltageSource>(buffer, 'V');
+VoltageSource *VoltageSource::parse(TextBuffer &buffer, Arena &arena) {
+    return Source::parse<VoltageSource>(buffer, 'V', arena);
+}
+
+Component *VoltageSource::clone(Arena &arena) const {
+    return arena.create<VoltageSource>(*this);
 }
 
-void VoltageSource::simulate(const std::shared_ptr<Transient> &transient,
-        const Schematic &schematic, const double &time) {
+void VoltageSource::simulate(Transient &transient, const Schematic &schematic,
+        const double &time) {
 
-    transient->add_voltage(node_hashes[0], node_hashes[1], hash, value(time));
+    transient.add_voltage(node_ids[0], node_ids[1], id, value(time));
 }
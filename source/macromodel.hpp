@@ -0,0 +1,552 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "solvers/factorization.hpp"
+#include "solvers/iterative.hpp"
+#include "utilities/sparse.hpp"
+
+/* ******************************************************************** Synopsis
+
+A reduced-order model of a linear network of resistors, capacitors, and
+inductors, as seen from its ports. The network's equations, with currents i
+injected at its ports, take the form
+
+    (G + sC) x = B i,    v = B^T x
+
+where x holds the voltages at its nodes (besides ground) and the currents
+through its inductors, and v the voltages at its ports. The model is found by
+PRIMA: an orthonormal basis V is built, by block Arnoldi iteration, for the
+Krylov subspace spanned by
+
+    K^-1 B, (K^-1 C) K^-1 B, (K^-1 C)^2 K^-1 B, ...    where K = G + s0 C
+
+and the network projected onto it, as G' = V^T G V, C' = V^T C V, and
+B' = V^T B. Since the projection is a congruence, the model is passive
+whenever the network is, and it matches the network's first moments about s0.
+Blocks are added until the model's port impedances, at a handful of points
+spread across the frequencies a simulation can resolve, stop changing by more
+than the tolerance asked for.
+
+The network's G and C are held sparsely, and the basis has a column per state,
+so the memory a model takes to build grows with the network, not its square.
+K is factorized (densely) for networks of up to largest_factorized_size
+unknowns; a larger one's solved for each column of the basis iteratively
+instead (see solvers/iterative.hpp), as its factors would take too much memory.
+
+Over a time step h, by backward Euler, the model's state z evolves as
+
+    (C'/h + G') z_n+1 = (C'/h) z_n + B' i_n+1
+
+so the port voltages are v_n+1 = e_n + Z i_n+1, where e_n depends only on the
+state, and Z = B'^T (C'/h + G')^-1 B'. Inverting Z gives the model's Norton
+equivalent, i = Y (v - e); an admittance Y between its ports, which is
+stamped into the system like the conductances of resistors, and a current of
+Y e into each port, stamped like a current source's.
+
+*/
+
+class Macromodel {
+
+private:
+
+    // The number of points its port impedances are compared at
+    static const unsigned int sample_count = 5;
+
+    // Columns whose norms fall this far on orthogonalization are taken to lie
+    // in the space already spanned
+    static const double deflation;
+
+    // The most unknowns a network can have for K to be factorized densely
+    static const unsigned int largest_factorized_size = 2000;
+
+    unsigned int size;
+    unsigned int order;
+
+    // The ports' node IDs
+    std::vector<unsigned int> ports;
+
+    // The projected network (row-major; G' and C' are order by order, and B'
+    // order by port count)
+    std::vector<double> conductances;
+    std::vector<double> capacitances;
+    std::vector<double> inputs;
+
+    // The discretized model: Y, and the maps from one state to the next
+    // ((C'/h + G')^-1 C'/h), from the port currents to the state
+    // ((C'/h + G')^-1 B'), and from the state to e
+    std::vector<double> admittances;
+    std::vector<double> propagation;
+    std::vector<double> response;
+    std::vector<double> output;
+
+    std::vector<double> state;
+    std::vector<double> previous_state;
+    std::vector<double> offsets;
+    std::vector<double> injections;
+    double time_step;
+
+    // The currents into the ports over the last step (kept, rather than
+    // found afresh, so advancing allocates nothing)
+    std::vector<double> currents;
+
+    void project(const SparseMatrix &values,
+            const std::vector<std::vector<double>> &columns,
+            std::vector<double> &result) const;
+    bool impedances(const double &frequency,
+            std::vector<double> &result) const;
+
+public:
+
+    // The basis V, with a row for each of the network's unknowns (so that
+    // each can be estimated from the model's state)
+    std::vector<double> basis;
+
+    Macromodel();
+
+    double build(const SparseMatrix &conductances,
+            const SparseMatrix &capacitances,
+            const std::vector<unsigned int> &rows,
+            const std::vector<unsigned int> &ports, const double &expansion,
+            const double &lowest, const double &highest,
+            const double &tolerance, const unsigned int &maximum_order);
+    bool discretize(const double &time_step);
+
+    void reset();
+    void advance(const std::vector<std::array<double, 4>> &node_voltages);
+
+    double estimate(const double *weights) const;
+    double estimate_rate(const double *weights) const;
+
+    const std::vector<unsigned int> &get_ports() const;
+    const std::vector<double> &get_admittances() const;
+    const std::vector<double> &get_injections() const;
+    unsigned int get_order() const;
+    unsigned int get_size() const;
+
+};
+
+const unsigned int Macromodel::sample_count;
+const double Macromodel::deflation = 1e-10;
+const unsigned int Macromodel::largest_factorized_size;
+
+Macromodel::Macromodel() {
+    size = 0;
+    order = 0;
+    time_step = 0;
+}
+
+// Projects a square matrix of the network's size onto the basis given, as
+// V^T M V
+void Macromodel::project(const SparseMatrix &values,
+        const std::vector<std::vector<double>> &columns,
+        std::vector<double> &result) const {
+
+    const unsigned int count = columns.size();
+    std::vector<double> product(size);
+    result.assign(count * count, 0);
+    for(unsigned int column = 0; column < count; column += 1) {
+        values.multiply(columns[column].data(), product.data());
+
+        for(unsigned int row = 0; row < count; row += 1) {
+            double sum = 0;
+            for(unsigned int index = 0; index < size; index += 1)
+                sum += columns[row][index] * product[index];
+            result[row * count + column] = sum;
+        }
+    }
+}
+
+// Finds the model's port impedances, B'^T (G' + sC')^-1 B', at a (real)
+// frequency s. Returns false if they're undefined there
+bool Macromodel::impedances(const double &frequency,
+        std::vector<double> &result) const {
+
+    const unsigned int port_count = ports.size();
+    std::vector<double> values(order * order);
+    for(unsigned int index = 0; index < values.size(); index += 1)
+        values[index] = conductances[index] + frequency * capacitances[index];
+
+    Factorization factorization;
+    if(factorization.factorize(values, order) == false)
+        return false;
+
+    result.assign(port_count * port_count, 0);
+    std::vector<double> column(order);
+    for(unsigned int port = 0; port < port_count; port += 1) {
+        for(unsigned int row = 0; row < order; row += 1)
+            column[row] = inputs[row * port_count + port];
+        factorization.solve(column.data());
+
+        for(unsigned int row = 0; row < port_count; row += 1) {
+            for(unsigned int index = 0; index < order; index += 1) {
+                result[row * port_count + port] += inputs[index *
+                        port_count + row] * column[index];
+            }
+        }
+    }
+    return true;
+}
+
+// Builds the model of a network from its G and C matrices, whose ports are
+// the unknowns in the rows given, about the expansion point s0.
+// Blocks are added until the port impedances at frequencies between the
+// lowest and highest change by no more than the tolerance (relative to the
+// largest of them), or the order would exceed the maximum. Returns the last
+// change found, or a negative value if the network can't be modelled
+double Macromodel::build(const SparseMatrix &conductances,
+        const SparseMatrix &capacitances,
+        const std::vector<unsigned int> &rows,
+        const std::vector<unsigned int> &ports, const double &expansion,
+        const double &lowest, const double &highest, const double &tolerance,
+        const unsigned int &maximum_order) {
+
+    size = conductances.rows();
+    this->ports = ports;
+    const unsigned int port_count = ports.size();
+
+    // K = G + s0 C, on the union of their patterns
+    SparseMatrix shifted;
+    {
+        std::vector<std::vector<unsigned int>> pattern(size);
+        for(const auto matrix : {&conductances, &capacitances}) {
+            const auto &starts = matrix->get_starts();
+            const auto &columns = matrix->get_columns();
+            for(unsigned int row = 0; row < size; row += 1) {
+                pattern[row].insert(pattern[row].end(),
+                        columns.begin() + starts[row],
+                        columns.begin() + starts[row + 1]);
+            }
+        }
+        shifted.set_pattern(pattern);
+    }
+    for(const auto matrix : {&conductances, &capacitances}) {
+        const double scale = (matrix == &conductances) ? 1 : expansion;
+        const auto &starts = matrix->get_starts();
+        const auto &columns = matrix->get_columns();
+        const auto &values = matrix->get_values();
+        for(unsigned int row = 0; row < size; row += 1) {
+            for(unsigned int index = starts[row]; index < starts[row + 1];
+                    index += 1) {
+
+                shifted(row, columns[index]) += scale * values[index];
+            }
+        }
+    }
+
+    // Solves K x = b in place, by factorizing K if it's small enough, and
+    // iteratively otherwise
+    const bool factorized = size <= largest_factorized_size;
+    Factorization factorization;
+    IterativeSolver solver;
+    std::vector<double> constants;
+    if(factorized) {
+        std::vector<double> dense(size * size, 0);
+        const auto &starts = shifted.get_starts();
+        const auto &columns = shifted.get_columns();
+        const auto &values = shifted.get_values();
+        for(unsigned int row = 0; row < size; row += 1) {
+            for(unsigned int index = starts[row]; index < starts[row + 1];
+                    index += 1) {
+
+                dense[row * size + columns[index]] = values[index];
+            }
+        }
+        if(factorization.factorize(dense, size) == false)
+            return -1;
+    }
+    else if(solver.prepare(shifted) == false)
+        return -1;
+
+    const auto solve = [&](std::vector<double> &column) {
+        if(factorized) {
+            factorization.solve(column.data());
+            return true;
+        }
+        constants = column;
+        std::fill(column.begin(), column.end(), 0);
+        return solver.solve(constants.data(), column.data());
+    };
+
+    // Orthogonalizes a column against the basis so far (twice over, to keep
+    // it orthogonal to working precision), and adds it unless it's deflated
+    std::vector<std::vector<double>> columns;
+    const auto add = [&](std::vector<double> &column) {
+        double original = 0;
+        for(const auto &value : column)
+            original += value * value;
+        original = std::sqrt(original);
+
+        for(unsigned int pass = 0; pass < 2; pass += 1) {
+            for(const auto &existing : columns) {
+                double dot = 0;
+                for(unsigned int index = 0; index < size; index += 1)
+                    dot += existing[index] * column[index];
+                for(unsigned int index = 0; index < size; index += 1)
+                    column[index] -= dot * existing[index];
+            }
+        }
+
+        double norm = 0;
+        for(const auto &value : column)
+            norm += value * value;
+        norm = std::sqrt(norm);
+        if(norm <= deflation * original || norm == 0)
+            return false;
+
+        for(auto &value : column)
+            value /= norm;
+        columns.push_back(column);
+        return true;
+    };
+
+    // Sample the frequencies geometrically, from lowest to highest
+    std::vector<double> samples(sample_count);
+    for(unsigned int index = 0; index < sample_count; index += 1) {
+        samples[index] = lowest * std::pow(highest / lowest, index /
+                double(sample_count - 1));
+    }
+
+    // The first block is K^-1 B
+    unsigned int block_start = 0;
+    for(const auto &row : rows) {
+        std::vector<double> column(size, 0);
+        column[row] = 1;
+        if(solve(column) == false)
+            return -1;
+        add(column);
+    }
+
+    std::vector<std::vector<double>> previous;
+    double change = -1;
+    while(true) {
+
+        // Project the network onto the basis so far, and compare its port
+        // impedances with those of the last projection
+        order = columns.size();
+        project(conductances, columns, this->conductances);
+        project(capacitances, columns, this->capacitances);
+        inputs.assign(order * port_count, 0);
+        for(unsigned int index = 0; index < order; index += 1) {
+            for(unsigned int port = 0; port < port_count; port += 1)
+                inputs[index * port_count + port] = columns[index][rows[port]];
+        }
+
+        std::vector<std::vector<double>> sampled(sample_count);
+        bool defined = true;
+        for(unsigned int index = 0; index < sample_count; index += 1)
+            defined = defined && impedances(samples[index], sampled[index]);
+        if(defined == false)
+            return -1;
+
+        if(previous.empty() == false) {
+            double difference = 0;
+            double largest = 0;
+            for(unsigned int index = 0; index < sample_count; index += 1) {
+                for(unsigned int entry = 0; entry < sampled[index].size();
+                        entry += 1) {
+
+                    difference = std::max(difference, std::fabs(
+                            sampled[index][entry] - previous[index][entry]));
+                    largest = std::max(largest, std::fabs(
+                            sampled[index][entry]));
+                }
+            }
+            change = (largest > 0) ? difference / largest : 0;
+            if(change <= tolerance)
+                break;
+        }
+        previous = sampled;
+
+        // Extend the basis by the next block, (K^-1 C) times the last
+        const unsigned int block_end = columns.size();
+        if(block_end + (block_end - block_start) > maximum_order)
+            return -1;
+
+        for(unsigned int index = block_start; index < block_end; index += 1) {
+            std::vector<double> column(size);
+            capacitances.multiply(columns[index].data(), column.data());
+            if(solve(column) == false)
+                return -1;
+            add(column);
+        }
+
+        // Once the subspace stops growing, the model's exact
+        if(columns.size() == block_end) {
+            change = 0;
+            break;
+        }
+        block_start = block_end;
+    }
+
+    basis.assign(size * order, 0);
+    for(unsigned int row = 0; row < size; row += 1) {
+        for(unsigned int index = 0; index < order; index += 1)
+            basis[row * order + index] = columns[index][row];
+    }
+    return change;
+}
+
+// Discretizes the model for a time step, finding its Norton equivalent.
+// Returns false if it has none
+bool Macromodel::discretize(const double &time_step) {
+    this->time_step = time_step;
+    const unsigned int port_count = ports.size();
+
+    std::vector<double> values(order * order);
+    for(unsigned int index = 0; index < values.size(); index += 1) {
+        values[index] = capacitances[index] / time_step +
+                conductances[index];
+    }
+
+    Factorization factorization;
+    if(factorization.factorize(values, order) == false)
+        return false;
+
+    // (C'/h + G')^-1 C'/h, and (C'/h + G')^-1 B', a column at a time
+    propagation.assign(order * order, 0);
+    response.assign(order * port_count, 0);
+    std::vector<double> column(order);
+    for(unsigned int index = 0; index < order; index += 1) {
+        for(unsigned int row = 0; row < order; row += 1)
+            column[row] = capacitances[row * order + index] / time_step;
+        factorization.solve(column.data());
+        for(unsigned int row = 0; row < order; row += 1)
+            propagation[row * order + index] = column[row];
+    }
+    for(unsigned int port = 0; port < port_count; port += 1) {
+        for(unsigned int row = 0; row < order; row += 1)
+            column[row] = inputs[row * port_count + port];
+        factorization.solve(column.data());
+        for(unsigned int row = 0; row < order; row += 1)
+            response[row * port_count + port] = column[row];
+    }
+
+    // Z = B'^T (C'/h + G')^-1 B', and e = B'^T (C'/h + G')^-1 C'/h z
+    std::vector<double> impedances(port_count * port_count, 0);
+    output.assign(port_count * order, 0);
+    for(unsigned int port = 0; port < port_count; port += 1) {
+        for(unsigned int index = 0; index < order; index += 1) {
+            const double input = inputs[index * port_count + port];
+            for(unsigned int other = 0; other < port_count; other += 1) {
+                impedances[port * port_count + other] += input *
+                        response[index * port_count + other];
+            }
+            for(unsigned int other = 0; other < order; other += 1) {
+                output[port * order + other] += input *
+                        propagation[index * order + other];
+            }
+        }
+    }
+
+    if(factorization.factorize(impedances, port_count) == false)
+        return false;
+
+    admittances.assign(port_count * port_count, 0);
+    column.resize(port_count);
+    for(unsigned int port = 0; port < port_count; port += 1) {
+        std::fill(column.begin(), column.end(), 0);
+        column[port] = 1;
+        factorization.solve(column.data());
+        for(unsigned int row = 0; row < port_count; row += 1)
+            admittances[row * port_count + port] = column[row];
+    }
+
+    reset();
+    return true;
+}
+
+// Returns the model to rest, with no current having flowed into it
+void Macromodel::reset() {
+    state.assign(order, 0);
+    previous_state.assign(order, 0);
+    offsets.assign(ports.size(), 0);
+    injections.assign(ports.size(), 0);
+    currents.assign(ports.size(), 0);
+}
+
+// Advances the model's state to the time its ports' present voltages were
+// found at, and finds the currents to be injected over the next step
+void Macromodel::advance(
+        const std::vector<std::array<double, 4>> &node_voltages) {
+
+    const unsigned int port_count = ports.size();
+
+    // The currents into the ports, i = Y (v - e)
+    std::fill(currents.begin(), currents.end(), 0);
+    for(unsigned int row = 0; row < port_count; row += 1) {
+        for(unsigned int port = 0; port < port_count; port += 1) {
+            currents[row] += admittances[row * port_count + port] *
+                    (node_voltages[ports[port]][2] - offsets[port]);
+        }
+    }
+
+    previous_state.swap(state);
+    for(unsigned int row = 0; row < order; row += 1) {
+        double sum = 0;
+        for(unsigned int index = 0; index < order; index += 1)
+            sum += propagation[row * order + index] * previous_state[index];
+        for(unsigned int port = 0; port < port_count; port += 1)
+            sum += response[row * port_count + port] * currents[port];
+        state[row] = sum;
+    }
+
+    for(unsigned int port = 0; port < port_count; port += 1) {
+        double sum = 0;
+        for(unsigned int index = 0; index < order; index += 1)
+            sum += output[port * order + index] * state[index];
+        offsets[port] = sum;
+    }
+
+    for(unsigned int row = 0; row < port_count; row += 1) {
+        double sum = 0;
+        for(unsigned int port = 0; port < port_count; port += 1)
+            sum += admittances[row * port_count + port] * offsets[port];
+        injections[row] = sum;
+    }
+}
+
+// Estimates a value of the network from the model's present state, as the
+// weighted sum of its entries (given by a combination of the basis' rows)
+double Macromodel::estimate(const double *weights) const {
+    double sum = 0;
+    for(unsigned int index = 0; index < order; index += 1)
+        sum += weights[index] * state[index];
+    return sum;
+}
+
+// Estimates the rate of change of a value of the network, over the last step
+double Macromodel::estimate_rate(const double *weights) const {
+    double sum = 0;
+    for(unsigned int index = 0; index < order; index += 1)
+        sum += weights[index] * (state[index] - previous_state[index]);
+    return sum / time_step;
+}
+
+// Returns the node IDs of the model's ports
+const std::vector<unsigned int> &Macromodel::get_ports() const {
+    return ports;
+}
+
+// Returns the admittances between the ports (row-major)
+const std::vector<double> &Macromodel::get_admittances() const {
+    return admittances;
+}
+
+// Returns the currents to be injected into the ports over the next step
+const std::vector<double> &Macromodel::get_injections() const {
+    return injections;
+}
+
+// Returns the number of states in the model
+unsigned int Macromodel::get_order() const {
+    return order;
+}
+
+// Returns the number of unknowns in the network modelled
+unsigned int Macromodel::get_size() const {
+    return size;
+}
@@ -1,36 +1,40 @@
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <streambuf>
 #include <string>
 #include <vector>
 
-#include <ctime>
-
+#include "cache.hpp"
 #include "simulation.hpp"
+#include "utilities/profiler.hpp"
 
 int main(int argument_count, char *argument_vector[]) {
 
-    // Start timer
-    std::clock_t start;
-    double duration;
-    start = std::clock();
-
-    std::vector<std::string> arguments;
-    for(unsigned int index = 1; index < argument_count; index += 1)
-        arguments.push_back(argument_vector[index]);
-    argument_count -= 1;
+    std::vector<std::string> arguments(argument_vector + 1,
+            argument_vector + argument_count);
+    const unsigned int count = arguments.size();
 
     // Parse the command line arguments
     std::string input_file_name;
     std::string output_file_name;
+    std::string cache_directory;
     unsigned int iterations = 1;
+    unsigned int partitions = 1;
+    bool relaxation = false;
+    bool iterative = false;
+    bool reduce = false;
+    double macromodel_tolerance = 0;
     bool silent = false;
     bool profile = false;
-    for(unsigned int index = 0; index < argument_count; index += 1) {
+    bool counters = false;
+    std::string trace_file_name;
+    std::string statistics_file_name;
+    for(unsigned int index = 0; index < count; index += 1) {
 
         // Parse output file flag
         if(arguments[index] == "-output") {
-            if(index + 1 >= argument_count) {
+            if(index + 1 >= count) {
                 std::cerr << "'-output' flag present in arguments, but wasn't "
                         "followed by a filename" << std::endl;
                 return -1;
@@ -40,9 +44,21 @@ int main(int argument_count, char *argument_vector[]) {
             index += 1;
         }
 
+        // Parse cache directory flag
+        else if(arguments[index] == "-cache") {
+            if(index + 1 >= count) {
+                std::cerr << "'-cache' flag present in arguments, but wasn't "
+                        "followed by a directory" << std::endl;
+                return -1;
+            }
+
+            cache_directory = arguments[index + 1];
+            index += 1;
+        }
+
         // Handle iteration specifier
     	else if(arguments[index] == "-iterations") {
-    	    if(index + 1 >= argument_count) {
+    	    if(index + 1 >= count) {
         		std::cerr << "-iterations flag present in arguments, but wasn't "
         			"followed by an integer" << std::endl;
         		return -1;
@@ -59,6 +75,72 @@ int main(int argument_count, char *argument_vector[]) {
     	    index += 1;
     	}
 
+        // Handle partition count specifier
+        else if(arguments[index] == "-partitions") {
+            if(index + 1 >= count) {
+                std::cerr << "-partitions flag present in arguments, but "
+                        "wasn't followed by an integer" << std::endl;
+                return -1;
+            }
+
+            int value;
+            try {
+                value = std::stoi(arguments[index + 1]);
+            }
+            catch(...) {
+                std::cerr << "Field provided for no. partitions wasn't a "
+                        "valid integer" << std::endl;
+                return -1;
+            }
+
+            if(value < 1) {
+                std::cerr << "No. partitions must be at least one" <<
+                        std::endl;
+                return -1;
+            }
+            partitions = value;
+            index += 1;
+        }
+
+        // Handle waveform relaxation flag
+        else if(arguments[index] == "-relaxation")
+            relaxation = true;
+
+        // Handle iterative solver flag
+        else if(arguments[index] == "-iterative")
+            iterative = true;
+
+        // Handle network reduction flag
+        else if(arguments[index] == "-reduce")
+            reduce = true;
+
+        // Handle macromodel tolerance specifier, which implies reduction
+        else if(arguments[index] == "-prima") {
+            if(index + 1 >= count) {
+                std::cerr << "-prima flag present in arguments, but wasn't "
+                        "followed by a tolerance" << std::endl;
+                return -1;
+            }
+
+            try {
+                macromodel_tolerance = std::stod(arguments[index + 1]);
+            }
+            catch(...) {
+                std::cerr << "Field provided for macromodel tolerance wasn't "
+                        "a valid number" << std::endl;
+                return -1;
+            }
+
+            if(macromodel_tolerance <= 0) {
+                std::cerr << "Macromodel tolerance must be positive" <<
+                        std::endl;
+                return -1;
+            }
+
+            reduce = true;
+            index += 1;
+        }
+
         // Handle silent input flag
     	else if(arguments[index] == "-silent")
     	    silent = true;
@@ -66,6 +148,37 @@ int main(int argument_count, char *argument_vector[]) {
         else if(arguments[index] == "-profile")
             profile = true;
 
+        // Handle hardware counter flag, which implies profiling
+        else if(arguments[index] == "-counters") {
+            counters = true;
+            profile = true;
+        }
+
+        // Parse solver statistics file flag
+        else if(arguments[index] == "-statistics") {
+            if(index + 1 >= count) {
+                std::cerr << "'-statistics' flag present in arguments, but "
+                        "wasn't followed by a filename" << std::endl;
+                return -1;
+            }
+
+            statistics_file_name = arguments[index + 1];
+            index += 1;
+        }
+
+        // Parse trace file flag, which implies profiling
+        else if(arguments[index] == "-trace") {
+            if(index + 1 >= count) {
+                std::cerr << "'-trace' flag present in arguments, but wasn't "
+                        "followed by a filename" << std::endl;
+                return -1;
+            }
+
+            trace_file_name = arguments[index + 1];
+            profile = true;
+            index += 1;
+        }
+
         // Parse input file name
         else if(input_file_name.empty())
             input_file_name = arguments[index];
@@ -78,6 +191,10 @@ int main(int argument_count, char *argument_vector[]) {
         }
     }
 
+    // Time each phase of the run from here on, if asked to
+    if(profile)
+        Profiler::enable(counters, trace_file_name.empty() == false);
+
     // Check an input file's been specified
     if(input_file_name.empty()) {
         std::cerr << "No input file specified" << std::endl;
@@ -96,10 +213,30 @@ int main(int argument_count, char *argument_vector[]) {
     // class
     std::string specification((std::istreambuf_iterator<char>(input_file)),
                      std::istreambuf_iterator<char>());
-    auto simulation = Simulation::parse(specification);
+
+    // If a cache directory's been given, try loading a compiled copy of the
+    // netlist before parsing it
+    std::shared_ptr<Simulation> simulation;
+    std::uint64_t cache_key = 0;
+    std::string cache_path;
+    if(cache_directory.empty() == false) {
+        cache_key = CircuitCache::key(specification);
+        cache_path = CircuitCache::path(cache_directory, cache_key);
+        simulation = CircuitCache::load(cache_path, cache_key);
+    }
+
     if(simulation == nullptr) {
-        std::cerr << "Failed to create simulation" << std::endl;
-        return -1;
+        simulation = Simulation::parse(specification);
+        if(simulation == nullptr) {
+            std::cerr << "Failed to create simulation" << std::endl;
+            return -1;
+        }
+
+        if(cache_path.empty() == false && CircuitCache::save(*simulation,
+                cache_path, cache_key) == false) {
+            std::cerr << "Couldn't write cache file '" << cache_path << "'" <<
+                    std::endl;
+        }
     }
 
 
@@ -130,22 +267,73 @@ int main(int argument_count, char *argument_vector[]) {
     else if(silent == false)
         stream = std::shared_ptr<std::ostream>(&std::cout, [](void*) {});
 
+    simulation->operation->partition_count = partitions;
+    simulation->operation->iterative = iterative;
+    simulation->operation->reduce = reduce;
+    simulation->operation->macromodel_tolerance = macromodel_tolerance;
+    simulation->operation->collect_statistics =
+            statistics_file_name.empty() == false;
+
+    // Wrap the operation to be run by waveform relaxation, if requested
+    if(relaxation && statistics_file_name.empty() == false) {
+        std::cerr << "Solver statistics can't be collected under waveform "
+                "relaxation" << std::endl;
+        return -1;
+    }
+
+    if(relaxation) {
+        const auto transient = std::dynamic_pointer_cast<Transient>(
+                simulation->operation);
+        if(transient == nullptr) {
+            std::cerr << "Waveform relaxation can only be used with a "
+                    "transient operation" << std::endl;
+            return -1;
+        }
+
+        simulation->operation = std::shared_ptr<Operation>(
+                new Relaxation(transient));
+    }
+
+    // Time the simulation itself (without the parsing before it)
+    const auto start = std::chrono::steady_clock::now();
     for(unsigned int iteration = 0; iteration < iterations; iteration += 1) {
 
     	// Run the simulation
+        Profiler::Scope scope("run");
         if(simulation->run(stream) == false) {
             std::cerr << "Failed to run simulation" << std::endl;
             return -1;
         }
     }
 
-    // Stop timer
-    duration = (std::clock() - start) / (double)(CLOCKS_PER_SEC / 1000);
+    const double duration = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
 
     if(profile) {
-        std::cout << "Process took: " << duration  << " microseconds (" <<
-        	    (duration / iterations) << " microseconds per iteration)" <<
+        std::cout << "Simulation took: " << duration  << " milliseconds (" <<
+        	    (duration / iterations) << " milliseconds per iteration)" <<
         	    std::endl;
+        Profiler::report(std::cout);
+    }
+
+    // Write the statistics of the last run's systems
+    if(statistics_file_name.empty() == false) {
+        const auto transient = std::dynamic_pointer_cast<Transient>(
+                simulation->operation);
+        std::ofstream statistics_file(statistics_file_name);
+        if(transient == nullptr || statistics_file.is_open() == false) {
+            std::cerr << "Couldn't write statistics file '" <<
+                    statistics_file_name << "'" << std::endl;
+            return -1;
+        }
+        transient->statistics.write(statistics_file);
+    }
+
+    if(trace_file_name.empty() == false &&
+            Profiler::write_trace(trace_file_name) == false) {
+        std::cerr << "Couldn't write trace file '" << trace_file_name << "'" <<
+                std::endl;
+        return -1;
     }
 
     return 0;
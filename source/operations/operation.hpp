@@ -6,7 +6,37 @@ class Operation {
 
 public:
 
+    // The number of partitions a large system's solve may be split into, to
+    // be worked on in parallel (one meaning it's solved whole)
+    unsigned int partition_count;
+
+    // Whether systems too large for a solver of their size are solved
+    // iteratively, and kept sparse, rather than factorized
+    bool iterative;
+
+    // Whether series and parallel passives are merged before the system is
+    // built, to make it smaller
+    bool reduce;
+
+    // How closely the reduction's macromodels of linear networks have to
+    // match them (zero meaning the networks aren't modelled)
+    double macromodel_tolerance;
+
+    // Whether statistics of the systems solved are kept, to be written out
+    // after the run
+    bool collect_statistics;
+
+    Operation();
+
     virtual bool run(Schematic &schematic,
             std::shared_ptr<std::ostream> stream) = 0;
 
 };
+
+Operation::Operation() {
+    partition_count = 1;
+    iterative = false;
+    reduce = false;
+    macromodel_tolerance = 0;
+    collect_statistics = false;
+}
@@ -0,0 +1,827 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "../components/capacitor.hpp"
+#include "../components/current_source.hpp"
+#include "../components/inductor.hpp"
+#include "../components/resistor.hpp"
+#include "../components/voltage_source.hpp"
+#include "../schematic.hpp"
+#include "../utilities/arena.hpp"
+#include "../utilities/barrier.hpp"
+#include "../utilities/disjoint_set.hpp"
+#include "../utilities/graph.hpp"
+
+#include "operation.hpp"
+#include "transient.hpp"
+
+/* ******************************************************************** Synopsis
+
+Runs a transient operation by waveform relaxation: the circuit is torn into
+partitions, joined only by resistors, and each is simulated on its own (on a
+thread of its own), at a time step suited to how quickly it changes, a window
+of time at a time.
+
+Tearing a resistor leaves a copy of it in both partitions. In each, the node at
+the far end is driven by a voltage source, following the waveform found for
+that node by the partition that owns it. Since those waveforms aren't known
+until the partitions that own them have been simulated, each window is
+simulated repeatedly: first with the waveforms from the end of the previous
+window held constant, then with the waveforms found in the previous attempt,
+until they stop changing (as they do, provided the partitions are loosely
+coupled). If they don't within the iterations allowed, the waveforms can't be
+trusted, so the rest of the operation (from the start of that window) is
+simulated whole instead, with a warning. The partitions' threads are started
+once, and wait at a barrier for each attempt.
+
+Nodes tied together by anything other than resistors are never separated.
+These groups are ordered breadth-first, across the circuit, and the order cut
+into bands holding similar numbers of nodes; each band is a partition.
+
+A partition's step is a power-of-two multiple of the operation's step, chosen
+from the fastest time constant in it: that of each capacitor with the smallest
+resistance at its nodes, each inductor with the largest, and the period of
+each sinusoidal source. So a slow partition torn from a fast one keeps its
+long step, seeing the fast one's waveforms averaged over each of its steps.
+A partition with none of these takes the smallest step of the partitions
+driving it, as does one holding no capacitor or voltage source (what's stamped
+to hold voltages from one step to the next): its voltages are set by its
+inputs at every step, and averaging them would only be amplified around the
+loop of partitions driving each other. Each window is as long as the largest
+step, and results are interpolated back onto the operation's step for output.
+The steps chosen are reported when the operation starts.
+
+*/
+
+class Relaxation : public Operation {
+
+private:
+
+    // A piecewise-linear waveform, sampled by the partition that owns a node,
+    // which drives another partition's copy of it. A partition taking longer
+    // steps than the owner sees the waveform's mean over each of its steps
+    // (its span), rather than its value at their ends, so that changes faster
+    // than it can follow are averaged out instead of aliased
+    class Waveform : public Function {
+
+    private:
+
+        double sample(const double &time) const;
+        double integrate(const double &from, const double &to) const;
+
+    public:
+
+        std::vector<double> times;
+        std::vector<double> values;
+
+        double span;
+
+        Waveform();
+
+        double value(const double &time) const override;
+
+    };
+
+    // A node owned by another partition, driven by a waveform
+    struct Input {
+        unsigned int node;
+        unsigned int owner;
+        Waveform *waveform;
+    };
+
+    struct Partition {
+
+        // The partition's components; those it owns, the copies of any
+        // resistors torn from it, and the sources driving its inputs
+        std::vector<Component *> components;
+
+        // The nodes and components whose values the partition reports
+        std::vector<unsigned int> nodes;
+        std::vector<unsigned int> owned_components;
+
+        std::vector<Input> inputs;
+
+        Transient transient;
+        unsigned int multiple;
+
+        // The partition's state at the start of the window
+        std::vector<std::array<double, 4>> node_state;
+        std::vector<std::array<double, 4>> component_state;
+
+        // The values the partition reports, sampled at each of its steps
+        // through the window. Each sample holds the voltages of its nodes,
+        // followed by the currents of its components
+        std::vector<double> times;
+        std::vector<std::vector<double>> samples;
+
+        bool solved;
+    };
+
+    static const unsigned int maximum_multiple = 128;
+    static const unsigned int maximum_iterations = 100;
+    static const unsigned int steps_per_time_constant = 20;
+
+    static const double absolute_tolerance;
+    static const double relative_tolerance;
+
+    std::shared_ptr<Transient> transient;
+
+    // The driving sources, and their waveforms
+    Arena arena;
+
+    std::vector<std::unique_ptr<Partition>> partitions;
+
+    // The length of each window, in operation steps (the largest of the
+    // partitions' multiples)
+    unsigned int window;
+
+    // The window being simulated, which the partitions' threads wait at the
+    // barrier to be given (or to be told the operation's finished)
+    double window_start;
+    double window_step;
+    bool window_initial;
+    bool finished;
+    std::unique_ptr<Barrier> barrier;
+
+    // The partition reporting each node and component, and the position of
+    // its values in that partition's samples
+    std::vector<unsigned int> node_owners;
+    std::vector<unsigned int> node_positions;
+    std::vector<unsigned int> component_owners;
+    std::vector<unsigned int> component_positions;
+
+    bool split(const Schematic &schematic);
+    void choose_multiples(const Schematic &schematic, const double &step);
+
+    bool simulate_window(const Schematic &schematic, const double &start,
+            const double &step, const bool &initial, bool &converged);
+    bool simulate_partition(Partition &partition, const Schematic &schematic,
+            const double &start, const double &step, const bool &initial);
+    bool simulate_windows(Schematic &schematic,
+            std::shared_ptr<std::ostream> stream, const double &step);
+    bool simulate_whole(const Schematic &schematic,
+            std::shared_ptr<std::ostream> stream, double time,
+            const double &step);
+
+    double interpolate(const unsigned int &owner, const unsigned int &position,
+            const double &time) const;
+    void print_values(std::shared_ptr<std::ostream> stream,
+            const Schematic &schematic, const double &time) const;
+
+public:
+
+    Relaxation(const std::shared_ptr<Transient> &transient);
+
+    bool run(Schematic &schematic, std::shared_ptr<std::ostream> stream)
+            override;
+
+};
+
+const unsigned int Relaxation::maximum_multiple;
+const unsigned int Relaxation::maximum_iterations;
+const unsigned int Relaxation::steps_per_time_constant;
+
+const double Relaxation::absolute_tolerance = 1e-9;
+const double Relaxation::relative_tolerance = 1e-6;
+
+Relaxation::Waveform::Waveform() {
+    span = 0;
+}
+
+// Returns the waveform's value at a given time, or its mean over the span
+// leading up to it
+double Relaxation::Waveform::value(const double &time) const {
+    if(span == 0 || times.size() < 2)
+        return sample(time);
+
+    return integrate(time - span, time) / span;
+}
+
+// Returns the integral of the waveform between two times, summing the
+// trapezoids between its samples (and beneath its held values beyond them)
+double Relaxation::Waveform::integrate(const double &from,
+        const double &to) const {
+
+    double result = 0;
+    double time = from;
+    double value = sample(from);
+    for(unsigned int index = 0; index <= times.size(); index += 1) {
+        const double next_time = (index < times.size()) ?
+                std::min(times[index], to) : to;
+        if(next_time <= time)
+            continue;
+
+        const double next_value = sample(next_time);
+        result += (value + next_value) / 2 * (next_time - time);
+        time = next_time;
+        value = next_value;
+    }
+    return result;
+}
+
+// Returns the waveform's value at a given time, interpolating linearly between
+// samples, and holding the first and last values beyond them
+double Relaxation::Waveform::sample(const double &time) const {
+    if(times.empty())
+        return 0;
+
+    if(time <= times.front())
+        return values.front();
+    if(time >= times.back())
+        return values.back();
+
+    const unsigned int after = std::upper_bound(times.begin(), times.end(),
+            time) - times.begin();
+    const unsigned int before = after - 1;
+
+    const double fraction = (time - times[before]) / (times[after] -
+            times[before]);
+    return values[before] + (values[after] - values[before]) * fraction;
+}
+
+Relaxation::Relaxation(const std::shared_ptr<Transient> &transient) {
+    this->transient = transient;
+    partition_count = transient->partition_count;
+    window = 1;
+    window_start = 0;
+    window_step = 0;
+    window_initial = false;
+    finished = false;
+}
+
+// Tears the circuit into partitions, joined only by resistors. Returns false if
+// it can't be torn into more than one
+bool Relaxation::split(const Schematic &schematic) {
+    const auto components = schematic.get_components();
+    const unsigned int node_count = schematic.get_node_count();
+    if(node_count < 3)
+        return false;
+
+    // Group the nodes joined by anything besides resistors
+    DisjointSet nodes(node_count);
+    for(const auto &component : components) {
+        const auto &ids = component->node_ids;
+        if(component->type != Component::RESISTOR && ids[0] && ids[1])
+            nodes.merge(ids[0], ids[1]);
+    }
+
+    std::vector<unsigned int> group_indices(node_count,
+            std::numeric_limits<unsigned int>::max());
+    std::vector<unsigned int> group_sizes;
+    for(unsigned int node = 1; node < node_count; node += 1) {
+        auto &index = group_indices[nodes.find(node)];
+        if(index == std::numeric_limits<unsigned int>::max()) {
+            index = group_sizes.size();
+            group_sizes.push_back(0);
+        }
+        group_sizes[index] += 1;
+    }
+
+    std::vector<std::vector<unsigned int>> neighbours(group_sizes.size());
+    for(const auto &component : schematic.get_components(
+            Component::RESISTOR)) {
+
+        const auto &ids = component->node_ids;
+        if(ids[0] == 0 || ids[1] == 0)
+            continue;
+
+        const auto one = group_indices[nodes.find(ids[0])];
+        const auto two = group_indices[nodes.find(ids[1])];
+        if(one != two) {
+            neighbours[one].push_back(two);
+            neighbours[two].push_back(one);
+        }
+    }
+
+    // Cut the groups, in order across the circuit, into bands of similar
+    // numbers of nodes (numbering only the bands that end up with any)
+    const auto order = order_across(neighbours);
+    std::vector<unsigned int> group_bands(group_sizes.size());
+    unsigned int band_count = 0;
+    unsigned int previous = std::numeric_limits<unsigned int>::max();
+    unsigned int nodes_before = 0;
+    for(const auto &group : order) {
+        const unsigned int band = (unsigned long long)nodes_before *
+                partition_count / (node_count - 1);
+        if(band != previous) {
+            band_count += 1;
+            previous = band;
+        }
+
+        group_bands[group] = band_count - 1;
+        nodes_before += group_sizes[group];
+    }
+
+    if(band_count < 2)
+        return false;
+
+    partitions.clear();
+    for(unsigned int band = 0; band < band_count; band += 1)
+        partitions.emplace_back(new Partition());
+
+    node_owners.assign(node_count, 0);
+    node_positions.assign(node_count, 0);
+    for(unsigned int node = 1; node < node_count; node += 1) {
+        auto &partition = *partitions[group_bands[group_indices[
+                nodes.find(node)]]];
+
+        node_owners[node] = group_bands[group_indices[nodes.find(node)]];
+        node_positions[node] = partition.nodes.size();
+        partition.nodes.push_back(node);
+    }
+
+    // Give each component to the partition owning its nodes. A resistor
+    // joining two partitions is copied into both, and the node at the far end
+    // of each copy becomes an input to that partition
+    std::vector<std::vector<unsigned int>> input_indices(band_count,
+            std::vector<unsigned int>(node_count,
+            std::numeric_limits<unsigned int>::max()));
+
+    const auto add_input = [&](const unsigned int &band,
+            const unsigned int &node) {
+
+        auto &index = input_indices[band][node];
+        if(index != std::numeric_limits<unsigned int>::max())
+            return;
+
+        auto &inputs = partitions[band]->inputs;
+        index = inputs.size();
+        inputs.push_back({node, node_owners[node], arena.create<Waveform>()});
+    };
+
+    component_owners.assign(components.size(), 0);
+    component_positions.assign(components.size(), 0);
+    for(const auto &component : components) {
+        const auto &ids = component->node_ids;
+        const unsigned int one = ids[0] ? node_owners[ids[0]] :
+                node_owners[ids[1]];
+        const unsigned int two = ids[1] ? node_owners[ids[1]] : one;
+
+        partitions[one]->components.push_back(component);
+        if(two != one) {
+            partitions[two]->components.push_back(component);
+            add_input(one, ids[1]);
+            add_input(two, ids[0]);
+        }
+
+        component_owners[component->id] = one;
+        component_positions[component->id] = partitions[one]->nodes.size() +
+                partitions[one]->owned_components.size();
+        partitions[one]->owned_components.push_back(component->id);
+    }
+
+    // Create the sources driving each partition's inputs, with IDs following
+    // on from the schematic's components
+    unsigned int next_id = components.size();
+    for(auto &partition : partitions) {
+        for(const auto &input : partition->inputs) {
+            auto source = arena.create<VoltageSource>();
+            source->name = "relaxation input";
+            source->id = next_id;
+            source->node_ids = {input.node, 0};
+            source->function = input.waveform;
+            partition->components.push_back(source);
+            next_id += 1;
+        }
+    }
+
+    for(auto &partition : partitions) {
+        auto &part = partition->transient;
+        part.start_time = transient->start_time;
+        part.stop_time = transient->stop_time;
+        part.prepare(schematic, Range<Component *>(partition->components),
+                next_id);
+    }
+
+    return true;
+}
+
+// Chooses each partition's step, as a multiple of the operation's step given
+void Relaxation::choose_multiples(const Schematic &schematic,
+        const double &step) {
+
+    const unsigned int node_count = schematic.get_node_count();
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    // The smallest and largest resistances at each node
+    std::vector<double> smallest(node_count, infinity);
+    std::vector<double> largest(node_count, 0);
+    for(const auto &component : schematic.get_components(
+            Component::RESISTOR)) {
+
+        const double &value = static_cast<Resistor *>(component)->value;
+        for(const auto &node : component->node_ids) {
+            smallest[node] = std::min(smallest[node], value);
+            largest[node] = std::max(largest[node], value);
+        }
+    }
+
+    std::vector<double> time_constants(partitions.size(), infinity);
+    for(const auto &component : schematic.get_components()) {
+        const auto &ids = component->node_ids;
+        double time_constant = infinity;
+
+        switch(component->type) {
+            case Component::CAPACITOR: {
+                const double resistance = std::min(ids[0] ? smallest[ids[0]] :
+                        infinity, ids[1] ? smallest[ids[1]] : infinity);
+                time_constant = static_cast<Capacitor *>(component)->value *
+                        resistance;
+                break;
+            }
+            case Component::INDUCTOR: {
+                const double resistance = std::max(ids[0] ? largest[ids[0]] :
+                        0, ids[1] ? largest[ids[1]] : 0);
+                if(resistance > 0) {
+                    time_constant = static_cast<Inductor *>(component)->value /
+                            resistance;
+                }
+                break;
+            }
+            case Component::CURRENT_SOURCE:
+            case Component::VOLTAGE_SOURCE: {
+                const Function *function = (component->type ==
+                        Component::CURRENT_SOURCE) ?
+                        static_cast<CurrentSource *>(component)->function :
+                        static_cast<VoltageSource *>(component)->function;
+
+                const auto sinusoid = dynamic_cast<const Sinusoid *>(function);
+                if(sinusoid && sinusoid->frequency > 0) {
+                    time_constant = 1 / (2 * 3.14159265359 *
+                            sinusoid->frequency);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        auto &owner = time_constants[component_owners[component->id]];
+        owner = std::min(owner, time_constant);
+    }
+
+    // Capacitors and voltage sources (being stamped as voltage sources) are
+    // what hold a partition's voltages from one step to the next; without
+    // any, they're set by its inputs at each step
+    std::vector<bool> holding(partitions.size(), false);
+    for(const auto &component : schematic.get_components(
+            Component::CAPACITOR | Component::VOLTAGE_SOURCE)) {
+
+        holding[component_owners[component->id]] = true;
+    }
+
+    for(unsigned int index = 0; index < partitions.size(); index += 1) {
+        auto &multiple = partitions[index]->multiple;
+        multiple = maximum_multiple;
+        if(time_constants[index] == infinity)
+            continue;
+
+        const double ideal = time_constants[index] / steps_per_time_constant;
+        while(multiple > 1 && multiple * step > ideal)
+            multiple /= 2;
+    }
+
+    // Partitions which don't change on their own, or don't hold their
+    // voltages (which follow their inputs directly), follow the fastest of
+    // the partitions driving them. The rest keep their own steps, however
+    // fast their inputs are, seeing them averaged over each step
+    for(unsigned int index = 0; index < partitions.size(); index += 1) {
+        if(holding[index] && time_constants[index] != infinity)
+            continue;
+
+        auto &partition = *partitions[index];
+        for(const auto &input : partition.inputs) {
+            if(time_constants[input.owner] != infinity) {
+                partition.multiple = std::min(partition.multiple,
+                        partitions[input.owner]->multiple);
+            }
+        }
+    }
+
+    // Inputs from partitions taking shorter steps are averaged over each step
+    for(auto &partition : partitions) {
+        for(auto &input : partition->inputs) {
+            const auto &owner = *partitions[input.owner];
+            input.waveform->span = (partition->multiple > owner.multiple) ?
+                    partition->multiple * step : 0;
+        }
+    }
+}
+
+// Simulates a partition through a window, from the state at its start, driven
+// by the input waveforms from the previous attempt. The initial window is the
+// single instant at the start of the operation
+bool Relaxation::simulate_partition(Partition &partition,
+        const Schematic &schematic, const double &start, const double &step,
+        const bool &initial) {
+
+    auto &part = partition.transient;
+    part.node_voltages = partition.node_state;
+    part.component_currents = partition.component_state;
+    part.time_step = step * partition.multiple;
+
+    const auto record = [&](const double &time) {
+        std::vector<double> sample;
+        sample.reserve(partition.nodes.size() +
+                partition.owned_components.size());
+
+        for(const auto &node : partition.nodes)
+            sample.push_back(part.node_voltages[node][2]);
+        for(const auto &component : partition.owned_components)
+            sample.push_back(part.component_currents[component][2]);
+
+        partition.times.push_back(time);
+        partition.samples.push_back(sample);
+    };
+
+    partition.times.clear();
+    partition.samples.clear();
+
+    unsigned int step_count = 1;
+    if(initial == false) {
+        record(start);
+        step_count = window / partition.multiple;
+    }
+
+    for(unsigned int index = 1; index <= step_count; index += 1) {
+        const double time = initial ? start : start + index * part.time_step;
+        for(auto &block : part.blocks) {
+            if(part.step(block, schematic, time) == false)
+                return false;
+        }
+        record(time);
+    }
+
+    return true;
+}
+
+// Simulates every partition through a window, repeating until their inputs
+// converge (the first partition on this thread, and the others on theirs,
+// released from the barrier for each attempt). Returns false if any partition
+// has no solution, and whether the inputs converged through 'converged'
+bool Relaxation::simulate_window(const Schematic &schematic,
+        const double &start, const double &step, const bool &initial,
+        bool &converged) {
+
+    converged = false;
+    for(auto &partition : partitions) {
+        partition->node_state = partition->transient.node_voltages;
+        partition->component_state = partition->transient.component_currents;
+    }
+
+    window_start = start;
+    window_step = step;
+    window_initial = initial;
+    for(unsigned int iteration = 0; iteration < maximum_iterations;
+            iteration += 1) {
+
+        barrier->wait();
+        partitions[0]->solved = simulate_partition(*partitions[0], schematic,
+                start, step, initial);
+        barrier->wait();
+
+        for(const auto &partition : partitions) {
+            if(partition->solved == false)
+                return false;
+        }
+
+        // Replace each input's waveform with the one just found for its node,
+        // measuring how far it's moved
+        double change = 0;
+        for(auto &partition : partitions) {
+            for(auto &input : partition->inputs) {
+                const auto &owner = *partitions[input.owner];
+                const auto &position = node_positions[input.node];
+                auto &waveform = *input.waveform;
+
+                const bool comparable = waveform.times == owner.times;
+                waveform.values.resize(owner.samples.size());
+                for(unsigned int index = 0; index < owner.samples.size();
+                        index += 1) {
+
+                    const double value = owner.samples[index][position];
+                    const double difference = comparable ? std::fabs(value -
+                            waveform.values[index]) : 1;
+
+                    change = std::max(change, difference /
+                            (absolute_tolerance + relative_tolerance *
+                            std::fabs(value)));
+                    waveform.values[index] = value;
+                }
+                waveform.times = owner.times;
+            }
+        }
+
+        if(change <= 1) {
+            converged = true;
+            return true;
+        }
+    }
+
+    return true;
+}
+
+// Returns the value at a given position in a partition's samples, at a time
+// within the current window
+double Relaxation::interpolate(const unsigned int &owner,
+        const unsigned int &position, const double &time) const {
+
+    const auto &partition = *partitions[owner];
+    const auto &times = partition.times;
+    const auto &samples = partition.samples;
+
+    unsigned int after = std::upper_bound(times.begin(), times.end(), time) -
+            times.begin();
+    if(after == 0)
+        return samples.front()[position];
+    if(after == times.size())
+        return samples.back()[position];
+
+    const unsigned int before = after - 1;
+    const double fraction = (time - times[before]) / (times[after] -
+            times[before]);
+    return samples[before][position] + (samples[after][position] -
+            samples[before][position]) * fraction;
+}
+
+// Prints the time, the voltage at each node, and the current through each
+// component, in the same form as a transient operation
+void Relaxation::print_values(std::shared_ptr<std::ostream> stream,
+        const Schematic &schematic, const double &time) const {
+
+    (*stream) << time << ", ";
+
+    const unsigned int node_count = schematic.get_node_count();
+    const auto components = schematic.get_components();
+    for(unsigned int node = 1; node < node_count; node += 1) {
+        (*stream) << interpolate(node_owners[node], node_positions[node],
+                time);
+        if(components.empty() == false || node + 1 < node_count)
+            (*stream) << ", ";
+    }
+
+    for(unsigned int index = 0; index < components.size(); index += 1) {
+        const auto &id = components[index]->id;
+        (*stream) << interpolate(component_owners[id],
+                component_positions[id], time);
+        if((index + 1) < components.size())
+            (*stream) << ", ";
+    }
+
+    (*stream) << '\n';
+}
+
+// Runs the transient operation by waveform relaxation, or as it would
+// otherwise be run if the circuit can't be torn into partitions
+bool Relaxation::run(Schematic &schematic,
+        std::shared_ptr<std::ostream> stream) {
+
+    const double &start_time = transient->start_time;
+    const double &stop_time = transient->stop_time;
+    if(transient->time_step == 0 || stop_time == 0 || schematic.empty() ||
+            partition_count < 2 || split(schematic) == false) {
+
+        return transient->run(schematic, stream);
+    }
+
+    const double step = std::min((stop_time - start_time) / 250,
+            transient->time_step);
+    choose_multiples(schematic, step);
+
+    window = 1;
+    std::cerr << "Waveform relaxation of " << partitions.size() <<
+            " partitions, stepping at";
+    for(const auto &partition : partitions) {
+        window = std::max(window, partition->multiple);
+        std::cerr << " " << partition->multiple;
+    }
+    std::cerr << " times " << step << "s" << std::endl;
+
+    // Start a thread for each partition besides the first, which simulates
+    // its partition through the window it's given each time it's released
+    // from the barrier, until the operation's finished
+    finished = false;
+    barrier.reset(new Barrier(partitions.size()));
+    const auto work = [&](Partition *partition) {
+        while(true) {
+            barrier->wait();
+            if(finished)
+                return;
+
+            partition->solved = simulate_partition(*partition, schematic,
+                    window_start, window_step, window_initial);
+            barrier->wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(unsigned int index = 1; index < partitions.size(); index += 1)
+        threads.emplace_back(work, partitions[index].get());
+
+    const bool solved = simulate_windows(schematic, stream, step);
+
+    finished = true;
+    barrier->wait();
+    for(auto &thread : threads)
+        thread.join();
+    return solved;
+}
+
+// Simulates each window in turn, printing the values at each of the
+// operation's steps through it. Returns false if there's no solution
+bool Relaxation::simulate_windows(Schematic &schematic,
+        std::shared_ptr<std::ostream> stream, const double &step) {
+
+    const double &start_time = transient->start_time;
+    const double &stop_time = transient->stop_time;
+    if(stream) {
+        partitions[0]->transient.print_headers(stream, schematic,
+                schematic.get_components());
+    }
+
+    // Solve the initial instant, then each window in turn, printing the
+    // values at each of the operation's steps through it
+    bool converged;
+    if(simulate_window(schematic, start_time, step, true, converged) ==
+            false) {
+
+        return false;
+    }
+    if(converged == false) {
+        std::cerr << "Waveform relaxation didn't converge at the start; " <<
+                "simulating the circuit whole" << std::endl;
+        return simulate_whole(schematic, stream, start_time, step);
+    }
+    if(stream)
+        print_values(stream, schematic, start_time);
+
+    // The times printed are accumulated just as a transient operation's are,
+    // so that the two print the same rows
+    double start = start_time;
+    double time = start_time + step;
+    while(time < stop_time) {
+        if(simulate_window(schematic, start, step, false, converged) == false)
+            return false;
+
+        if(converged == false) {
+            std::cerr << "Waveform relaxation didn't converge in the window " <<
+                    "from " << start << "s; simulating the rest of the " <<
+                    "circuit's run whole" << std::endl;
+            return simulate_whole(schematic, stream, time, step);
+        }
+
+        for(unsigned int index = 0; index < window && time < stop_time;
+                index += 1) {
+
+            if(stream)
+                print_values(stream, schematic, time);
+            time += step;
+        }
+        start += window * step;
+    }
+
+    return true;
+}
+
+// Simulates the rest of the operation whole, at the operation's step, from
+// the partitions' state at the start of the last window (the values the
+// window found being unreliable), printing its values from the time given.
+// Returns false if there's no solution
+bool Relaxation::simulate_whole(const Schematic &schematic,
+        std::shared_ptr<std::ostream> stream, double time,
+        const double &step) {
+
+    const auto components = schematic.get_components();
+    transient->time_step = step;
+    transient->prepare(schematic, components,
+            schematic.get_component_count());
+
+    for(unsigned int node = 1; node < schematic.get_node_count(); node += 1) {
+        transient->node_voltages[node] =
+                partitions[node_owners[node]]->node_state[node];
+    }
+    for(const auto &component : components) {
+        const auto &id = component->id;
+        transient->component_currents[id] =
+                partitions[component_owners[id]]->component_state[id];
+    }
+
+    for(; time < transient->stop_time; time += step) {
+        for(auto &block : transient->blocks) {
+            if(transient->step(block, schematic, time) == false)
+                return false;
+        }
+        if(stream)
+            transient->print_values(stream, components, time);
+    }
+    return true;
+}
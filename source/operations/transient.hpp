@@ -1,64 +1,180 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <vector>
 
-#include "../utilities/hash.hpp"
+#include "../reduction.hpp"
+#include "../solvers/factorization.hpp"
+#include "../solvers/fixed.hpp"
+#include "../solvers/iterative.hpp"
+#include "../solvers/partitioned.hpp"
+#include "../solvers/statistics.hpp"
+#include "../utilities/allocations.hpp"
+#include "../utilities/barrier.hpp"
+#include "../utilities/disjoint_set.hpp"
+
 #include "../utilities/matrix.hpp"
 #include "../utilities/parse.hpp"
+#include "../utilities/profiler.hpp"
+#include "../utilities/range.hpp"
+#include "../utilities/sparse.hpp"
 #include "../utilities/text_buffer.hpp"
 
 #include "operation.hpp"
 
-class Transient : public std::enable_shared_from_this<Transient>,
-        public Operation {
+class Transient : public Operation {
+
+    // Waveform relaxation steps the blocks of its own transients directly
+    friend class Relaxation;
 
 private:
 
-    enum ValueIndex {
-        CURRENT,
-        RESISTANCE,
-        VOLTAGE
+    // An element stamped into the system by a component: a resistance, an
+    // (ideal) voltage source, or a current source, between two nodes
+    struct Element {
+        unsigned int nodes[2];
+        unsigned int component;
+        double value;
+    };
+
+    // A node whose voltage a source to ground fixes, so it (and the source's
+    // row) can be left out of its block's system. Both are given as positions
+    // in the system
+    struct Fixed {
+        unsigned int node;
+        unsigned int source;
+    };
+
+    // A part of the circuit connected to the rest only through ground, which
+    // is solved as a system of its own. Its elements are held as indices into
+    // the vectors for their kinds, and its nodes by their schematic IDs
+    struct Block {
+        std::vector<unsigned int> nodes;
+        std::vector<Component *> components;
+
+        std::vector<unsigned int> voltages;
+        std::vector<unsigned int> resistances;
+        std::vector<unsigned int> currents;
+
+        // Reduced models of linear networks, stamped across their ports
+        std::vector<Macromodel *> macromodels;
+
+        // The nodes fixed by grounded sources, and the positions in the
+        // system of the unknowns left to solve for once they're removed
+        std::vector<Fixed> fixed;
+        std::vector<unsigned int> kept;
+
+        double cost;
+
+        // Used instead of factorizing the block's system whole, when the
+        // operation's set to be partitioned
+        std::shared_ptr<PartitionedSolver> solver;
+
+        // Used instead of either, when the system solved is small enough to
+        // have a solver of its size (see fixed.hpp)
+        std::shared_ptr<FixedSolver> fixed_solver;
+
+        // Used for systems too large for a solver of their size, when the
+        // operation's set to solve iteratively. The system's then kept
+        // sparse, whole and with the fixed nodes removed, with the position
+        // of each unknown in the reduced system ('none' for those removed),
+        // and the position among the whole system's entries of each of the
+        // reduced system's
+        std::shared_ptr<IterativeSolver> iterative_solver;
+        SparseMatrix sparse_conductances;
+        SparseMatrix reduced_sparse_conductances;
+        std::vector<unsigned int> positions;
+        std::vector<unsigned int> reduced_entries;
+
+        // The block's system and its solution, both whole and with the fixed
+        // nodes removed, sized when the block's made so that stepping it
+        // allocates nothing
+        Matrix conductances;
+        Matrix constants;
+        Matrix result;
+        Matrix reduced_conductances;
+        Matrix reduced_constants;
+        Matrix reduced_result;
+
+        // The factorization of the system solved, kept (with the matrix it
+        // was found from) until the system changes
+        Factorization factorization;
+        Matrix factorized;
+        bool factorized_valid;
     };
 
-    std::map<Hash, unsigned int> node_indices;
-    std::map<Hash, unsigned int> component_indices;
-    std::map<std::pair<ValueIndex, Hash>, unsigned int> component_instances;
-    std::map<ValueIndex, unsigned int> instance_counts;
+    static const unsigned int none = std::numeric_limits<unsigned int>::max();
+
+    // Nodes and components are identified by their dense schematic IDs, so
+    // each of the tables below is a plain vector, sized once per run. Ground
+    // (node ID zero) is never part of the system
+    unsigned int node_count;
+
+    std::vector<Element> voltages;
+    std::vector<Element> resistances;
+    std::vector<Element> currents;
+
+    // Position of each component's element within the vector for its kind,
+    // by component ID ('none' until it's first added)
+    std::vector<unsigned int> element_indices;
+
+    std::vector<Block> blocks;
+
+    // Models of the linear networks the reduction replaced, if any
+    std::vector<Macromodel *> macromodels;
+
+    // Position of each node in its block's system, by node ID (plus one, so
+    // that ground's is zero, as in the schematic)
+    std::vector<unsigned int> local_nodes;
 
-    std::map<std::array<Hash, 4>, double> voltages;
-    std::map<std::array<Hash, 4>, double> resistances;
-    std::map<std::array<Hash, 4>, double> currents;
+    std::vector<std::array<double, 4>> node_voltages;
+    std::vector<std::array<double, 4>> component_currents;
 
-    std::map<unsigned int, std::array<double, 4>> node_voltages;
-    std::map<unsigned int, std::array<double, 4>> component_currents;
+    void add_element(std::vector<Element> &elements,
+            const unsigned int &node_one, const unsigned int &node_two,
+            const unsigned int &component, const double &value);
 
-    void add_node(const Hash &hash);
-    void add_component(const ValueIndex &index, const Hash &hash);
+    void prepare(const Schematic &schematic,
+            const Range<Component *> &components,
+            const unsigned int &component_count);
+    void partition(const Range<Component *> &components);
+    std::vector<std::vector<Block *>> assign_blocks(
+            const unsigned int &worker_count);
 
-    unsigned int get_node_index(const Hash &hash);
-    unsigned int get_component_index(const Hash &hash);
-    unsigned int get_component_instance(const Hash &hash,
-            const ValueIndex &index);
+    template <typename Conductances>
+    void fill_conductance_matrix(const Block &block,
+            Conductances &conductances);
+    inline void fill_constants_matrix(const Block &block, Matrix &constants);
 
-    inline Matrix create_conductance_matrix();
-    inline Matrix create_constants_matrix();
+    void find_fixed(Block &block);
+    void size_workspaces(Block &block);
+    void size_sparse_workspaces(Block &block);
+    inline void eliminate_fixed(Block &block);
+    inline void restore_fixed(Block &block);
+    inline void eliminate_fixed_sparse(Block &block);
+    inline void restore_fixed_sparse(Block &block);
 
     inline void print_headers(std::shared_ptr<std::ostream> stream,
-            const std::vector<std::pair<std::string, Hash>> &nodes,
-            const std::vector<std::shared_ptr<Component>> &components);
+            const Schematic &schematic,
+            const Range<Component *> &components);
     inline void print_values(std::shared_ptr<std::ostream> stream,
-            const Matrix &result,
-            const std::vector<std::pair<std::string, Hash>> &nodes,
-            const std::vector<std::shared_ptr<Component>> &components,
+            const Range<Component *> &components,
             const double &time);
 
-    inline void update_values(const Matrix &result);
+    inline void update_values(const Block &block, const Matrix &result);
+
+    bool step(Block &block, const Schematic &schematic, const double &time);
+    bool solve_directly(Block &block, const double &time);
+    bool solve_iteratively(Block &block, const double &time);
 
 
 public:
@@ -67,131 +183,553 @@ public:
     double stop_time;
     double time_step;
 
+    // Statistics of the last run's systems (if they were collected)
+    SolverStatistics statistics;
+
+    // The number of time steps, after each worker's first, that allocated
+    // memory in the last run (only counted in builds that count allocations)
+    unsigned int allocating_steps;
+
     static std::shared_ptr<Transient> parse(TextBuffer &buffer);
 
     Transient();
 
-    void add_resistance(const Hash &node_one, const Hash &node_two,
-            const Hash &hash, const double &value);
-    void add_voltage(const Hash &node_one, const Hash &node_two,
-            const Hash &hash, const double &value);
-    void add_current(const Hash &node_one, const Hash &node_two,
-            const Hash &hash, const double &value);
+    void add_resistance(const unsigned int &node_one,
+            const unsigned int &node_two, const unsigned int &component,
+            const double &value);
+    void add_voltage(const unsigned int &node_one,
+            const unsigned int &node_two, const unsigned int &component,
+            const double &value);
+    void add_current(const unsigned int &node_one,
+            const unsigned int &node_two, const unsigned int &component,
+            const double &value);
 
-    double get_current_integral(const Hash &hash);
-    double get_voltage_integral(const Hash &node_one,
-            const Hash &node_two);
+    double get_current_integral(const unsigned int &component);
+    double get_voltage_integral(const unsigned int &node_one,
+            const unsigned int &node_two);
 
-    double get_voltage(const Hash &node_one, const Hash &node_two);
+    double get_voltage(const unsigned int &node_one,
+            const unsigned int &node_two);
 
     bool run(Schematic &schematic, std::shared_ptr<std::ostream> stream);
 };
 
-// Adds a node's hash to the component indices hash table
-// NOTE: For ground (hash = 0), the index will always be zero
-void Transient::add_node(const Hash &hash) {
-    if(hash == 0)
+const unsigned int Transient::none;
+
+// Adds (or, if the component's already been added, updates) an element
+void Transient::add_element(std::vector<Element> &elements,
+        const unsigned int &node_one, const unsigned int &node_two,
+        const unsigned int &component, const double &value) {
+
+    auto &index = element_indices[component];
+    if(index == none) {
+        index = elements.size();
+        elements.push_back(Element());
+    }
+
+    auto &element = elements[index];
+    element.nodes[0] = node_one;
+    element.nodes[1] = node_two;
+    element.component = component;
+    element.value = value;
+}
+
+// Splits the circuit into blocks, each of which is connected to the others only
+// through ground (so each can be solved on its own). Every component must have
+// added its element already
+void Transient::partition(const Range<Component *> &components) {
+
+    // Merge the nodes either side of each element, besides ground, which
+    // would otherwise connect everything; and the ports of each macromodel
+    DisjointSet nodes(node_count + 1);
+    std::vector<bool> used(node_count + 1, false);
+    for(const auto &component : components) {
+        const auto &ids = component->node_ids;
+        if(ids[0] && ids[1])
+            nodes.merge(ids[0], ids[1]);
+
+        used[ids[0]] = true;
+        used[ids[1]] = true;
+    }
+
+    for(const auto &macromodel : macromodels) {
+        const auto &ports = macromodel->get_ports();
+        for(const auto &port : ports) {
+            nodes.merge(ports[0], port);
+            used[port] = true;
+        }
+    }
+
+    // Give each set of nodes a block, numbering its nodes in the order they're
+    // found (nodes none of the components are connected to are left out)
+    blocks.clear();
+    local_nodes.assign(node_count + 1, 0);
+    std::vector<unsigned int> block_indices(node_count + 1, none);
+    for(unsigned int node = 1; node <= node_count; node += 1) {
+        if(used[node] == false)
+            continue;
+
+        auto &index = block_indices[nodes.find(node)];
+        if(index == none) {
+            index = blocks.size();
+            blocks.emplace_back();
+        }
+
+        local_nodes[node] = blocks[index].nodes.size() + 1;
+        blocks[index].nodes.push_back(node);
+    }
+
+    // Place each component (and its element) in the block of its nodes. One
+    // connected only to ground affects nothing, so goes in the first block
+    // (which is left empty if no other node's used)
+    if(blocks.empty())
+        blocks.emplace_back();
+
+    for(const auto &component : components) {
+        const auto &ids = component->node_ids;
+        const unsigned int node = ids[0] ? ids[0] : ids[1];
+        auto &block = blocks[node ? block_indices[nodes.find(node)] : 0];
+        block.components.push_back(component);
+
+        const auto &index = element_indices[component->id];
+        switch(component->type) {
+            case Component::CAPACITOR:
+            case Component::VOLTAGE_SOURCE:
+                block.voltages.push_back(index);
+                break;
+            case Component::RESISTOR:
+                block.resistances.push_back(index);
+                break;
+            default:
+                block.currents.push_back(index);
+                break;
+        }
+    }
+
+    for(const auto &macromodel : macromodels) {
+        const auto &port = macromodel->get_ports()[0];
+        blocks[block_indices[nodes.find(port)]].macromodels.push_back(
+                macromodel);
+    }
+
+    // Choose each block's solver, and estimate the work of solving it, which
+    // grows with the cube of the size of its system (less the unknowns
+    // grounded sources fix), or, solved iteratively, with its non-zeros
+    for(auto &block : blocks) {
+        find_fixed(block);
+
+        // Small systems are always solved with a solver of their size, as
+        // they're too small to be worth partitioning (or iterating over)
+        block.fixed_solver = FixedSolver::create(block.kept.size());
+        if(block.fixed_solver == nullptr && iterative) {
+            block.iterative_solver = std::shared_ptr<IterativeSolver>(
+                    new IterativeSolver());
+        }
+        else if(partition_count > 1 && block.fixed_solver == nullptr) {
+            block.solver = std::shared_ptr<PartitionedSolver>(
+                    new PartitionedSolver(partition_count));
+        }
+
+        size_workspaces(block);
+
+        const double size = block.kept.size();
+        block.cost = block.iterative_solver ?
+                block.sparse_conductances.nonzero_count() :
+                size * size * size;
+    }
+
+    if(collect_statistics) {
+        statistics.reset(blocks.size());
+        for(unsigned int index = 0; index < blocks.size(); index += 1) {
+            auto &block = statistics.blocks[index];
+            block.nodes = blocks[index].nodes.size();
+            block.unknowns = block.nodes + blocks[index].voltages.size();
+            block.solver = blocks[index].fixed_solver ? "fixed" :
+                    blocks[index].iterative_solver ? "iterative" :
+                    blocks[index].solver ? "partitioned" : "lu";
+        }
+    }
+}
+
+// Finds the nodes of a block whose voltages are fixed by sources with their
+// other terminal at ground (capacitors included, as they're stamped as
+// sources). Only the first source at a node fixes it
+void Transient::find_fixed(Block &block) {
+    const unsigned int block_nodes = block.nodes.size();
+    const unsigned int size = block_nodes + block.voltages.size();
+    std::vector<bool> removed(size, false);
+
+    block.fixed.clear();
+    for(unsigned int index = 0; index < block.voltages.size(); index += 1) {
+        const auto &voltage = voltages[block.voltages[index]];
+        const auto &node_one = local_nodes[voltage.nodes[0]];
+        const auto &node_two = local_nodes[voltage.nodes[1]];
+        if((node_one == 0) == (node_two == 0))
+            continue;
+
+        const unsigned int node = (node_one ? node_one : node_two) - 1;
+        if(removed[node])
+            continue;
+
+        removed[node] = true;
+        removed[block_nodes + index] = true;
+        block.fixed.push_back({node, block_nodes + index});
+    }
+
+    block.kept.clear();
+    for(unsigned int index = 0; index < size; index += 1) {
+        if(removed[index] == false)
+            block.kept.push_back(index);
+    }
+}
+
+// Sizes the matrices a block's system is built and solved in, once its
+// elements and fixed nodes are known
+void Transient::size_workspaces(Block &block) {
+    const unsigned int size = block.nodes.size() + block.voltages.size();
+    const unsigned int reduced_size = block.kept.size();
+
+    block.constants = Matrix(1, size);
+    block.result = Matrix(1, size);
+
+    // A system solved iteratively is only ever held sparsely
+    if(block.iterative_solver) {
+        if(block.fixed.empty() == false) {
+            block.reduced_constants = Matrix(1, reduced_size);
+            block.reduced_result = Matrix(1, reduced_size);
+        }
+        size_sparse_workspaces(block);
+        return;
+    }
+
+    block.conductances = Matrix(size, size);
+
+    // Without fixed nodes, the whole system's solved
+    if(block.fixed.empty() == false) {
+        block.reduced_conductances = Matrix(reduced_size, reduced_size);
+        block.reduced_constants = Matrix(1, reduced_size);
+        block.reduced_result = Matrix(1, reduced_size);
+    }
+
+    // The factorization's own storage is taken on its first use, and kept
+    block.factorized = Matrix(reduced_size, reduced_size);
+    block.factorized_valid = false;
+}
+
+// Sets the patterns of a block's sparse systems, whole and reduced, from its
+// elements (whose values may change, but whose nodes don't)
+void Transient::size_sparse_workspaces(Block &block) {
+    const unsigned int block_nodes = block.nodes.size();
+    const unsigned int size = block_nodes + block.voltages.size();
+
+    // Each resistance couples its nodes, each macromodel its ports, and each
+    // voltage source its nodes and its branch current
+    std::vector<std::vector<unsigned int>> rows(size);
+    for(const auto &index : block.resistances) {
+        const auto &resistance = resistances[index];
+        const auto &node_one = local_nodes[resistance.nodes[0]];
+        const auto &node_two = local_nodes[resistance.nodes[1]];
+        if(node_one && node_two) {
+            rows[node_one - 1].push_back(node_two - 1);
+            rows[node_two - 1].push_back(node_one - 1);
+        }
+    }
+
+    for(const auto &macromodel : block.macromodels) {
+        const auto &ports = macromodel->get_ports();
+        for(const auto &row : ports) {
+            for(const auto &column : ports) {
+                rows[local_nodes[row] - 1].push_back(
+                        local_nodes[column] - 1);
+            }
+        }
+    }
+
+    for(unsigned int index = 0; index < block.voltages.size(); index += 1) {
+        const auto &voltage = voltages[block.voltages[index]];
+        const unsigned int offset = block_nodes + index;
+        for(const auto &node : voltage.nodes) {
+            if(local_nodes[node]) {
+                rows[local_nodes[node] - 1].push_back(offset);
+                rows[offset].push_back(local_nodes[node] - 1);
+            }
+        }
+    }
+
+    block.sparse_conductances.set_pattern(rows);
+    if(block.fixed.empty())
         return;
 
-    // If the hash is not of the ground node, then its index value shouldn't be
-    // zero in the hash table. If the entry hasn't already been made, its value
-    // will be zero by default -- so use the hash table's size to set its index
-    auto &value = node_indices[hash];
-    if(value == 0)
-        value = node_indices.size();
+    // The reduced system has the whole system's entries between the unknowns
+    // kept, in the same order (as the kept unknowns are in order)
+    block.positions.assign(size, none);
+    for(unsigned int index = 0; index < block.kept.size(); index += 1)
+        block.positions[block.kept[index]] = index;
+
+    const auto &starts = block.sparse_conductances.get_starts();
+    const auto &columns = block.sparse_conductances.get_columns();
+    std::vector<std::vector<unsigned int>> reduced_rows(block.kept.size());
+    block.reduced_entries.clear();
+    for(unsigned int row = 0; row < block.kept.size(); row += 1) {
+        const unsigned int whole_row = block.kept[row];
+        for(unsigned int index = starts[whole_row];
+                index < starts[whole_row + 1]; index += 1) {
+
+            const unsigned int position = block.positions[columns[index]];
+            if(position != none) {
+                reduced_rows[row].push_back(position);
+                block.reduced_entries.push_back(index);
+            }
+        }
+    }
+
+    block.reduced_sparse_conductances.set_pattern(reduced_rows);
 }
 
-// Creates entries in the component index and identifier hash tables
-// NOTE: Indices are distinct from instances. There's a unique index for every
-// resistor, voltage, and current source in the circuit -- whereas each *type*
-// of component (resistor, voltage, etc.) has its own instances
-void Transient::add_component(const ValueIndex &index, const Hash &hash) {
-    auto &index_value = component_indices[hash];
-    const auto &indices_size = component_indices.size();
-    if(index_value == 0)
-        index_value = indices_size;
-
-    auto &instance_value = component_instances[std::pair<ValueIndex, Hash>(
-            {index, hash})];
-    auto &instance_count = instance_counts[index];
-    if(instance_value == 0) {
-        instance_count += 1;
-        instance_value = instance_count;
+// Shares the blocks between workers, handing out the most costly first, each
+// to whichever worker has the least work so far
+std::vector<std::vector<Transient::Block *>> Transient::assign_blocks(
+        const unsigned int &worker_count) {
+
+    std::vector<Block *> order;
+    for(auto &block : blocks)
+        order.push_back(&block);
+
+    std::sort(order.begin(), order.end(), [](const Block *one,
+            const Block *two) { return one->cost > two->cost; });
+
+    std::vector<std::vector<Block *>> assignments(worker_count);
+    std::vector<double> loads(worker_count, 0);
+    for(const auto &block : order) {
+        const unsigned int worker = std::min_element(loads.begin(),
+                loads.end()) - loads.begin();
+
+        assignments[worker].push_back(block);
+        loads[worker] += block->cost;
     }
+    return assignments;
 }
 
-// Gets the index of a node which has already been added to the node index
-// table using 'add_node'
-unsigned int Transient::get_node_index(const Hash &hash) {
-    if(hash == 0)
-        return 0;
+// Simulates one block for a single time step: its components are stamped, its
+// system solved, and its values updated. Returns false if there's no solution.
+// The system's built and solved in the block's own matrices, so once they've
+// been sized (and the solver's taken its storage, on the first step), a step
+// allocates nothing
+bool Transient::step(Block &block, const Schematic &schematic,
+        const double &time) {
+
+    // Simulate components
+    {
+        Profiler::Scope scope("evaluate");
+        for(const auto &component : block.components)
+            component->simulate(*this, schematic, time);
+    }
 
-    const auto &value = node_indices[hash];
-    if(value == 0)
-        add_node(hash);
+    // Build and solve the block's system: sparsely, by its iterative solver,
+    // if it has one, or else densely
+    const bool solved = block.iterative_solver ?
+            solve_iteratively(block, time) : solve_directly(block, time);
+    if(solved == false)
+        return false;
 
-    return value;
+    // Restore the nodes grounded sources fix into the block's result (if they
+    // were left out of its system), update the stored voltage/current values,
+    // and step the block's macromodels on to them
+    Profiler::Scope scope("update");
+    if(block.fixed.empty() == false) {
+        if(block.iterative_solver)
+            restore_fixed_sparse(block);
+        else
+            restore_fixed(block);
+    }
+    update_values(block, block.result);
+    for(const auto &macromodel : block.macromodels)
+        macromodel->advance(node_voltages);
+    return true;
 }
 
-// Gets the index of a component
-unsigned int Transient::get_component_index(const Hash &hash) {
-    return component_indices[hash];
+// Builds a block's system densely, and solves it by factorization, into the
+// block's result (or reduced result, if grounded sources fix any of its
+// nodes). Returns false if there's no solution
+bool Transient::solve_directly(Block &block, const double &time) {
+    // The system solved: the whole system, or with the nodes grounded sources
+    // fix left out
+    const bool reduced = block.fixed.empty() == false;
+    Matrix &conductances = reduced ? block.reduced_conductances :
+            block.conductances;
+    Matrix &constants = reduced ? block.reduced_constants : block.constants;
+    Matrix &result = reduced ? block.reduced_result : block.result;
+    {
+        Profiler::Scope scope("assemble");
+        fill_conductance_matrix(block, block.conductances);
+        fill_constants_matrix(block, block.constants);
+        if(reduced)
+            eliminate_fixed(block);
+    }
+
+    // Keep the block's statistics (only analyzing its system if it's changed)
+    SolverStatistics::Block *block_statistics = nullptr;
+    if(collect_statistics) {
+        block_statistics = &statistics.blocks[&block - blocks.data()];
+        statistics.record(*block_statistics, conductances);
+    }
+
+    // Calculate result, with the partitioned solver if the block has one (and
+    // it's able to solve it)
+    bool solved = block.kept.empty();
+    if(solved == false && block.solver) {
+        Profiler::Scope scope("solve");
+        solved = block.solver->solve(conductances, constants, result);
+    }
+
+    // Otherwise, factorize the system whole (unless it's unchanged since it
+    // last was), and substitute the constants through the factors
+    if(solved == false) {
+        if(block.factorized_valid == false ||
+                conductances != block.factorized) {
+
+            Profiler::Scope scope("factorize");
+            block.factorized = conductances;
+            block.factorized_valid = block.fixed_solver ?
+                    block.fixed_solver->factorize(conductances.data()) :
+                    block.factorization.factorize(conductances);
+        }
+
+        if(block.factorized_valid == false) {
+            std::cerr << "Circuit has no solution (in a block of " <<
+                    block.nodes.size() << " nodes, at " << time << "s)" <<
+                    std::endl;
+            if(block_statistics)
+                block_statistics->failures += 1;
+            return false;
+        }
+
+        Profiler::Scope scope("solve");
+        std::copy(constants.data(), constants.data() + constants.rows(),
+                result.data());
+        if(block.fixed_solver)
+            block.fixed_solver->solve(result.data());
+        else
+            block.factorization.solve(result.data());
+    }
+
+    return true;
 }
 
-// Gets the instance of a component
-unsigned int Transient::get_component_instance(const Hash &hash,
-        const ValueIndex &index) {
+// Builds a block's system sparsely, and solves it iteratively, into the
+// block's result (or reduced result, if grounded sources fix any of its
+// nodes). The solve starts from the block's last solution, which is still in
+// its result. Returns false if there's no solution, or the iterations didn't
+// converge to one
+bool Transient::solve_iteratively(Block &block, const double &time) {
+    // The system solved: the whole system, or with the nodes grounded sources
+    // fix left out
+    const bool reduced = block.fixed.empty() == false;
+    SparseMatrix &conductances = reduced ?
+            block.reduced_sparse_conductances : block.sparse_conductances;
+    Matrix &constants = reduced ? block.reduced_constants : block.constants;
+    Matrix &result = reduced ? block.reduced_result : block.result;
+    {
+        Profiler::Scope scope("assemble");
+        fill_conductance_matrix(block, block.sparse_conductances);
+        fill_constants_matrix(block, block.constants);
+        if(reduced)
+            eliminate_fixed_sparse(block);
+    }
+
+    // Equilibrate and precondition the system (unless it's unchanged since
+    // it last was), then iterate from the last solution
+    auto &solver = *block.iterative_solver;
+    bool prepared;
+    {
+        Profiler::Scope scope("factorize");
+        prepared = solver.prepare(conductances);
+    }
+
+    bool converged = false;
+    if(prepared) {
+        Profiler::Scope scope("solve");
+        converged = solver.solve(constants.data(), result.data());
+    }
+
+    SolverStatistics::Block *block_statistics = nullptr;
+    if(collect_statistics) {
+        block_statistics = &statistics.blocks[&block - blocks.data()];
+        statistics.record(*block_statistics, conductances, solver);
+    }
 
-    return component_instances[std::pair<ValueIndex, Hash>({index, hash})];
+    if(converged == false) {
+        if(prepared == false) {
+            std::cerr << "Circuit has no solution (in a block of " <<
+                    block.nodes.size() << " nodes, at " << time << "s)" <<
+                    std::endl;
+        }
+        else {
+            std::cerr << "Iterative solve didn't converge in " <<
+                    solver.get_iterations() << " iterations (in a block of " <<
+                    block.nodes.size() << " nodes, at " << time << "s)" <<
+                    std::endl;
+        }
+        if(block_statistics)
+            block_statistics->failures += 1;
+        return false;
+    }
+
+    return true;
 }
 
-// Creates the conductance matrix
-Matrix Transient::create_conductance_matrix() {
-    const unsigned int node_count = node_indices.size();
-    const unsigned int size = node_count + voltages.size();
-    Matrix conductances(size, size);
+// Fills in the conductance matrix of a block (sized for it already), which
+// may be dense or sparse
+template <typename Conductances>
+void Transient::fill_conductance_matrix(const Block &block,
+        Conductances &conductances) {
+
+    const unsigned int block_nodes = block.nodes.size();
+    conductances.clear();
 
     // Resistances are placed into the first 1-N rows/columns of the conductance
     // matrix, where the row is the index of the node to which it's connected.
-    // Values which aren't along the diagonal are inverted
-    for(const auto &resistance : resistances) {
-        const auto &node_one = resistance.first[0];
-        const auto &node_two = resistance.first[1];
-        const auto value = resistance.second;
+    // Each adds its conductance to the diagonal entries of both its nodes, and
+    // subtracts it from the entries coupling them
+    for(const auto &index : block.resistances) {
+        const auto &resistance = resistances[index];
+        const auto &node_one = local_nodes[resistance.nodes[0]];
+        const auto &node_two = local_nodes[resistance.nodes[1]];
+        const double conductance = 1 / resistance.value;
 
         if(node_one)
-            conductances(node_one - 1, node_one - 1) += 1 / value;
+            conductances(node_one - 1, node_one - 1) += conductance;
         if(node_two)
-            conductances(node_two - 1, node_two - 1) += 1 / value;
+            conductances(node_two - 1, node_two - 1) += conductance;
         if(node_one && node_two) {
-            conductances(node_one - 1, node_two - 1) += value;
-            conductances(node_two - 1, node_one - 1) += value;
+            conductances(node_one - 1, node_two - 1) -= conductance;
+            conductances(node_two - 1, node_one - 1) -= conductance;
         }
     }
 
-    // This step takes each non-diagonal value, and takes its negative
-    // reciprocal. This convers the entries from a resistance sum to a
-    // conductance sum
-    for(unsigned int row = 0; row < node_count; row += 1) {
-        for(unsigned int column = 0; column < node_count; column += 1) {
-            if(row == column)
-                continue;
-            else if(conductances(row, column))
-                conductances(row, column) = -1 / conductances(row, column);
+    // A macromodel's admittances couple each of its ports to the others (none
+    // of which are ground)
+    for(const auto &macromodel : block.macromodels) {
+        const auto &ports = macromodel->get_ports();
+        const auto &admittances = macromodel->get_admittances();
+        for(unsigned int row = 0; row < ports.size(); row += 1) {
+            for(unsigned int column = 0; column < ports.size(); column += 1) {
+                conductances(local_nodes[ports[row]] - 1,
+                        local_nodes[ports[column]] - 1) +=
+                        admittances[row * ports.size() + column];
+            }
         }
     }
 
     // Each voltage source in the circuit needs a signed unity factor which is
     // used to apply it to the various nodal equations. The positive terminal
     // adds a factor of +value to the equation, and vice versa
-    for(const auto &voltage : voltages) {
-        const unsigned int node_one = voltage.first[0];
-        const unsigned int node_two = voltage.first[1];
-        const auto instance = get_component_instance(voltage.first[2],
-                ValueIndex(voltage.first[3]));
-        const auto value = voltage.second;
-
-        const unsigned int offset = node_count + instance - 1;
+    for(unsigned int index = 0; index < block.voltages.size(); index += 1) {
+        const auto &voltage = voltages[block.voltages[index]];
+        const auto &node_one = local_nodes[voltage.nodes[0]];
+        const auto &node_two = local_nodes[voltage.nodes[1]];
+
+        const unsigned int offset = block_nodes + index;
         if(node_one) {
             conductances(node_one - 1, offset) = 1;
             conductances(offset, node_one - 1) = 1;
@@ -201,68 +739,190 @@ Matrix Transient::create_conductance_matrix() {
             conductances(offset, node_two - 1) = -1;
         }
     }
+}
+
+// Removes the nodes fixed by grounded sources from a block's system, along
+// with the sources' rows, moving the currents their voltages drive through the
+// rest of the system into its constants. The reduced system's written to the
+// block's reduced matrices
+void Transient::eliminate_fixed(Block &block) {
+    const auto &conductances = block.conductances;
+    const auto &constants = block.constants;
+    auto &reduced_conductances = block.reduced_conductances;
+    auto &reduced_constants = block.reduced_constants;
+
+    const auto &kept = block.kept;
+    const unsigned int size = kept.size();
+
+    for(unsigned int row = 0; row < size; row += 1) {
+        double constant = constants(kept[row], 0);
+        for(const auto &fixed : block.fixed) {
+            const double voltage = constants(fixed.source, 0) /
+                    conductances(fixed.source, fixed.node);
+            constant -= conductances(kept[row], fixed.node) * voltage;
+        }
+        reduced_constants(row, 0) = constant;
+
+        for(unsigned int column = 0; column < size; column += 1) {
+            reduced_conductances(row, column) = conductances(kept[row],
+                    kept[column]);
+        }
+    }
+}
+
+// Fills in the full solution of a block's system from that of its reduced
+// one: the fixed nodes' voltages are the sources', and each source's current
+// is whatever the rest of its node's equation leaves over
+void Transient::restore_fixed(Block &block) {
+    const auto &conductances = block.conductances;
+    const auto &constants = block.constants;
+    const auto &reduced = block.reduced_result;
+    auto &result = block.result;
+
+    const unsigned int size = conductances.rows();
+    for(unsigned int index = 0; index < block.kept.size(); index += 1)
+        result(block.kept[index], 0) = reduced(index, 0);
+
+    for(const auto &fixed : block.fixed) {
+        result(fixed.node, 0) = constants(fixed.source, 0) /
+                conductances(fixed.source, fixed.node);
+    }
 
-    return conductances;
+    for(const auto &fixed : block.fixed) {
+        double current = constants(fixed.node, 0);
+        for(unsigned int index = 0; index < size; index += 1) {
+            if(index != fixed.source)
+                current -= conductances(fixed.node, index) * result(index, 0);
+        }
+        result(fixed.source, 0) = current / conductances(fixed.node,
+                fixed.source);
+    }
 }
 
-// Creates the constants matrix
-Matrix Transient::create_constants_matrix() {
-    const unsigned int node_count = node_indices.size();
-    const unsigned int size = node_count + voltages.size();
-    Matrix constants(1, size);
+// Removes the fixed nodes from a block's sparse system, as eliminate_fixed
+// does from its dense one. The fixed nodes' voltages are written into the
+// block's whole result, for restore_fixed_sparse
+void Transient::eliminate_fixed_sparse(Block &block) {
+    const auto &conductances = block.sparse_conductances;
+    const auto &constants = block.constants;
+    auto &result = block.result;
+
+    for(const auto &fixed : block.fixed) {
+        result(fixed.node, 0) = constants(fixed.source, 0) /
+                conductances.value(fixed.source, fixed.node);
+    }
+
+    const auto &values = conductances.get_values();
+    auto &reduced_values = block.reduced_sparse_conductances.get_values();
+    for(unsigned int index = 0; index < reduced_values.size(); index += 1)
+        reduced_values[index] = values[block.reduced_entries[index]];
+
+    // Only the fixed nodes' columns (not their sources') have entries in the
+    // rows kept
+    const unsigned int block_nodes = block.nodes.size();
+    const auto &starts = conductances.get_starts();
+    const auto &columns = conductances.get_columns();
+    for(unsigned int row = 0; row < block.kept.size(); row += 1) {
+        const unsigned int whole_row = block.kept[row];
+        double constant = constants(whole_row, 0);
+        for(unsigned int index = starts[whole_row];
+                index < starts[whole_row + 1]; index += 1) {
+
+            const unsigned int column = columns[index];
+            if(block.positions[column] == none && column < block_nodes)
+                constant -= values[index] * result(column, 0);
+        }
+        block.reduced_constants(row, 0) = constant;
+    }
+}
+
+// Fills in the full solution of a block's sparse system from that of its
+// reduced one, as restore_fixed does for its dense one (the fixed nodes'
+// voltages having been found already)
+void Transient::restore_fixed_sparse(Block &block) {
+    const auto &conductances = block.sparse_conductances;
+    const auto &constants = block.constants;
+    const auto &reduced = block.reduced_result;
+    auto &result = block.result;
+
+    for(unsigned int index = 0; index < block.kept.size(); index += 1)
+        result(block.kept[index], 0) = reduced(index, 0);
+
+    const auto &values = conductances.get_values();
+    const auto &starts = conductances.get_starts();
+    const auto &columns = conductances.get_columns();
+    for(const auto &fixed : block.fixed) {
+        double current = constants(fixed.node, 0);
+        for(unsigned int index = starts[fixed.node];
+                index < starts[fixed.node + 1]; index += 1) {
+
+            if(columns[index] != fixed.source)
+                current -= values[index] * result(columns[index], 0);
+        }
+        result(fixed.source, 0) = current / conductances.value(fixed.node,
+                fixed.source);
+    }
+}
+
+// Fills in the constants matrix of a block (sized for it already)
+void Transient::fill_constants_matrix(const Block &block, Matrix &constants) {
+    const unsigned int block_nodes = block.nodes.size();
+    constants.clear();
 
     // The first N entries of the constants matrix (where N is the number of
-    // nodes) is for the known currents in the circuit. I'll be honest, I don't
-    // really know whether this approach treats conventional current as
-    // positive, but this sign notation seems to work and I'm not touching it
-    for(const auto &current : currents) {
-        const auto node_one = current.first[0];
-        const auto node_two = current.first[1];
-        const double value = current.second;
+    // nodes) is for the known currents in the circuit. As in SPICE, a current
+    // source's current flows out of its first node, through the source, and
+    // into its second
+    for(const auto &index : block.currents) {
+        const auto &current = currents[index];
+        const auto &node_one = local_nodes[current.nodes[0]];
+        const auto &node_two = local_nodes[current.nodes[1]];
+        const double &value = current.value;
 
         if(node_one)
-            constants(node_one - 1, 0) += value;
+            constants(node_one - 1, 0) -= value;
         if(node_two)
-            constants(node_two - 1, 0) -= value;
+            constants(node_two - 1, 0) += value;
+    }
+
+    // A macromodel's state drives a current into each of its ports
+    for(const auto &macromodel : block.macromodels) {
+        const auto &ports = macromodel->get_ports();
+        const auto &injections = macromodel->get_injections();
+        for(unsigned int index = 0; index < ports.size(); index += 1)
+            constants(local_nodes[ports[index]] - 1, 0) += injections[index];
     }
 
     // After the currents, the N-M entries of the constants matrix (where M is
     // the number of voltage sources) is given over to the voltage sources'
     // values
-    for(const auto &voltage : voltages) {
-        const auto instance = get_component_instance(voltage.first[2],
-                ValueIndex(voltage.first[3]));
-        const auto value = voltage.second;
-
-        constants(node_count + instance - 1, 0) -= value;
+    for(unsigned int index = 0; index < block.voltages.size(); index += 1) {
+        const auto &voltage = voltages[block.voltages[index]];
+        constants(block_nodes + index, 0) += voltage.value;
     }
-
-    return constants;
 }
 
 // Prints the time, the names of the nodes whose voltages are to be displayed,
 // and the components whose currents will be printed
 void Transient::print_headers(std::shared_ptr<std::ostream> stream,
-        const std::vector<std::pair<std::string, Hash>> &nodes,
-        const std::vector<std::shared_ptr<Component>> &components) {
+        const Schematic &schematic,
+        const Range<Component *> &components) {
 
     // Print the time stamp
     (*stream) << "time, ";
 
-    // Print the voltage headers
-    for(unsigned int index = 0; index < nodes.size(); index += 1) {
-        const auto name = nodes[index].first;
-        if(name == "0")
-            continue;
-
-        (*stream) << "V(" << name << ")";
-        if(components.empty() == false || (index + 1) < nodes.size())
+    // Print the voltage headers (skipping ground, which is always the first
+    // node)
+    const auto node_names = schematic.get_node_names();
+    for(unsigned int index = 1; index <= node_count; index += 1) {
+        (*stream) << "V(" << node_names[index] << ")";
+        if(components.empty() == false || index < node_count)
             (*stream) << ", ";
     }
 
     // Print the current headers
     for(unsigned int index = 0; index < components.size(); index += 1) {
-        const auto name = components[index]->name;
+        const auto &name = components[index]->name;
         (*stream) << "I(" << name << ")";
         if((index + 1) < components.size())
             (*stream) << ", ";
@@ -273,29 +933,21 @@ void Transient::print_headers(std::shared_ptr<std::ostream> stream,
 // Prints the values of the voltages at each node, and the current through
 // each component
 void Transient::print_values(std::shared_ptr<std::ostream> stream,
-        const Matrix &result,
-        const std::vector<std::pair<std::string, Hash>> &nodes,
-        const std::vector<std::shared_ptr<Component>> &components,
+        const Range<Component *> &components,
         const double &time) {
 
     // Print the time stamp
     (*stream) << time << ", ";
 
     // Print the node voltages
-    for(unsigned int index = 0; index < nodes.size(); index += 1) {
-        const Hash hash = nodes[index].second;
-        if(hash == 0)
-            continue;
-
-        (*stream) << node_voltages[get_node_index(hash)][2];
-        if(components.empty() == false || (index + 1) < nodes.size())
+    for(unsigned int index = 1; index <= node_count; index += 1) {
+        (*stream) << node_voltages[index][2];
+        if(components.empty() == false || index < node_count)
             (*stream) << ", ";
     }
 
     for(unsigned int index = 0; index < components.size(); index += 1) {
-        const Hash hash = components[index]->hash;
-
-        (*stream) << component_currents[get_component_index(hash)][2];
+        (*stream) << component_currents[components[index]->id][2];
         if((index + 1) < components.size())
             (*stream) << ", ";
     }
@@ -303,14 +955,15 @@ void Transient::print_values(std::shared_ptr<std::ostream> stream,
     (*stream) << '\n';
 }
 
-// Updates the vectors containing node voltages and component currents, using
-// the most recent result matrix from a simulation
-void Transient::update_values(const Matrix &result) {
+// Updates the node voltages and component currents of a block, using the most
+// recent result matrix from solving it
+void Transient::update_values(const Block &block, const Matrix &result) {
+    const unsigned int block_nodes = block.nodes.size();
 
     // Each node has fields for the integral of its voltage, as well as the
     // gradient, and the previous and present values
-    for(const auto &node : node_indices) {
-        auto &voltages = node_voltages[node.second];
+    for(unsigned int index = 0; index < block_nodes; index += 1) {
+        auto &voltages = node_voltages[block.nodes[index]];
         auto &integral = voltages[0];
         auto &previous = voltages[1];
         auto &present = voltages[2];
@@ -318,7 +971,7 @@ void Transient::update_values(const Matrix &result) {
 
         integral += ((previous + present) / 2) * time_step;
         previous = present;
-        present = result(node.second - 1, 0);
+        present = result(index, 0);
         gradient = (present - previous) / time_step;
     }
 
@@ -326,19 +979,14 @@ void Transient::update_values(const Matrix &result) {
     // gradient, and previous and present field
     // NOTE: To get the currents from the result matrix, a constant offset
     // is used so as not to accidentally read the node voltages
-    const unsigned int node_count = node_indices.size();
-    for(const auto &voltage : voltages) {
+    for(unsigned int index = 0; index < block.voltages.size(); index += 1) {
 
         // In this case, we only want to read the currents corresponding to the
         // voltage sources in the circuit. The current through current sources
         // is obviously known, and the current through resistors can be
         // calculated using the potential across it
-        const auto hash = voltage.first[2];
-        const auto index = get_component_index(hash);
-        const auto instance = get_component_instance(hash,
-                ValueIndex::VOLTAGE);
-
-        auto &currents = component_currents[index];
+        const auto &voltage = voltages[block.voltages[index]];
+        auto &currents = component_currents[voltage.component];
         auto &integral = currents[0];
         auto &previous = currents[1];
         auto &present = currents[2];
@@ -346,28 +994,21 @@ void Transient::update_values(const Matrix &result) {
 
         integral += ((previous + present) / 2) * time_step;
         previous = present;
-        present = result(node_count + instance - 1, 0);
+        present = result(block_nodes + index, 0);
         gradient = (present - previous) / time_step;
     }
 
-    for(const auto &resistance : resistances) {
-        const auto &node_one = resistance.first[0];
-        const auto &node_two = resistance.first[1];
-        const auto &hash = resistance.first[2];
-
-        double voltage = 0;
-        if(node_one)
-            voltage += node_voltages[node_one][2];
-        if(node_two)
-            voltage -= node_voltages[node_two][2];
-
-        const double current = voltage / resistance.second;
-        component_currents[get_component_index(hash)][2] = current;
+    for(const auto &index : block.resistances) {
+        const auto &resistance = resistances[index];
+        const double voltage = get_voltage(resistance.nodes[0],
+                resistance.nodes[1]);
+        component_currents[resistance.component][2] = voltage /
+                resistance.value;
     }
 
-    for(const auto &current : currents) {
-        const auto &hash = current.first[2];
-        component_currents[get_component_index(hash)][2] = current.second;
+    for(const auto &index : block.currents) {
+        const auto &current = currents[index];
+        component_currents[current.component][2] = current.value;
     }
 }
 
@@ -436,95 +1077,89 @@ std::shared_ptr<Transient> Transient::parse(TextBuffer &buffer) {
 }
 
 Transient::Transient() {
+    node_count = 0;
     start_time = 0;
     stop_time = 0;
     time_step = 1;
+    allocating_steps = 0;
 }
 
 // Adds a resistive element to the circuit simulation
-void Transient::add_resistance(const Hash &node_one, const Hash &node_two,
-        const Hash &hash, const double &value) {
-
-    add_node(node_one);
-    add_node(node_two);
+void Transient::add_resistance(const unsigned int &node_one,
+        const unsigned int &node_two, const unsigned int &component,
+        const double &value) {
 
-    std::array<unsigned int, 4> index = {
-        get_node_index(node_one),
-        get_node_index(node_two),
-        hash,
-        ValueIndex::RESISTANCE
-    };
-    resistances[index] = value;
-    add_component(RESISTANCE, hash);
+    add_element(resistances, node_one, node_two, component, value);
 }
 
 // Adds a voltage source to the simulation
-void Transient::add_voltage(const Hash &node_one, const Hash &node_two,
-        const Hash &hash, const double &value) {
+void Transient::add_voltage(const unsigned int &node_one,
+        const unsigned int &node_two, const unsigned int &component,
+        const double &value) {
 
-    add_node(node_one);
-    add_node(node_two);
-
-    std::array<unsigned int, 4> index = {
-        get_node_index(node_one),
-        get_node_index(node_two),
-        hash,
-        ValueIndex::VOLTAGE
-    };
-    voltages[index] = value;
-    add_component(VOLTAGE, hash);
+    add_element(voltages, node_one, node_two, component, value);
 }
 
 // Adds a current source to the simulation
-void Transient::add_current(const Hash &node_one, const Hash &node_two,
-        const Hash &hash, const double &value) {
-
-    add_node(node_one);
-    add_node(node_two);
+void Transient::add_current(const unsigned int &node_one,
+        const unsigned int &node_two, const unsigned int &component,
+        const double &value) {
 
-    std::array<unsigned int, 4> index = {
-        get_node_index(node_one),
-        get_node_index(node_two),
-        hash,
-        ValueIndex::CURRENT
-    };
-    currents[index] = value;
-    add_component(CURRENT, hash);
+    add_element(currents, node_one, node_two, component, value);
 }
 
 // Gets the integral of the current which has flowed through a given component
 // since the start of the simulation
-double Transient::get_current_integral(const Hash &hash) {
-    return component_currents[get_component_index(hash)][0];
+double Transient::get_current_integral(const unsigned int &component) {
+    return component_currents[component][0];
 }
 
 // Gets the integral of the voltage between two nodes since the start of the
 // simulation
-double Transient::get_voltage_integral(const Hash &node_one,
-        const Hash &node_two) {
-
-    double value;
-    unsigned int index_one = get_node_index(node_one);
-    unsigned int index_two = get_node_index(node_two);
-
-    // If one of the node indices was ground, the addition/subtraction stage
-    // would yeild undefined results given that there's no entry for the
-    // ground node in the node indices map
-    if(index_one)
-        value += node_voltages[index_one][0];
-    if(index_two)
-        value -= node_voltages[index_two][0];
-    return value;
+double Transient::get_voltage_integral(const unsigned int &node_one,
+        const unsigned int &node_two) {
+
+    // Ground's entry is never written to, so it's always zero
+    return node_voltages[node_one][0] - node_voltages[node_two][0];
 }
 
 // Gets the current voltage between two nodes at the present time step
-double Transient::get_voltage(const Hash &node_one, const Hash &node_two) {
-    double value;
-    if(node_one)
-        value += node_voltages[get_node_index(node_one)][2];
-    if(node_two)
-        value -= node_voltages[get_node_index(node_two)][2];
-    return value;
+double Transient::get_voltage(const unsigned int &node_one,
+        const unsigned int &node_two) {
+
+    return node_voltages[node_one][2] - node_voltages[node_two][2];
+}
+
+// Resets the simulation's state, then stamps and partitions the components
+// given. Components are identified by ID, so the tables are sized for the
+// number given (which may be more than the schematic has, for components
+// outside it)
+void Transient::prepare(const Schematic &schematic,
+        const Range<Component *> &components,
+        const unsigned int &component_count) {
+
+    // Size the tables, with an entry for each node (including ground, whose
+    // values stay at zero), and each component
+    node_count = schematic.get_node_count() - 1;
+    node_voltages.assign(node_count + 1, {0, 0, 0, 0});
+
+    component_currents.assign(component_count, {0, 0, 0, 0});
+    element_indices.assign(component_count, none);
+    voltages.clear();
+    resistances.clear();
+    currents.clear();
+
+    // Stamp every component once, so each has its element before the circuit
+    // is partitioned. From then on a component only overwrites its own
+    // element, and only reads the values of its own block, so blocks can be
+    // stepped concurrently
+    for(const auto &component : components)
+        component->simulate(*this, schematic, start_time);
+
+    for(const auto &macromodel : macromodels)
+        macromodel->reset();
+
+    partition(components);
 }
 
 // Runs a transient circuit simulation operation
@@ -552,48 +1187,96 @@ bool Transient::run(Schematic &schematic,
     if(failed)
         return false;
 
-    // Get the nodes and components from the schematic class
-    const auto nodes = schematic.get_nodes();
+    // View the components in the schematic (the view stays valid for the run,
+    // as nothing is added to the schematic during it)
     const auto components = schematic.get_components();
 
-    // The stream is only valid if the application hasn't had the 'silent' flag
-    // set; in which case, print the .csv headers
-    if(stream)
-        print_headers(stream, nodes, components);
-
     // Calculte the time step
     // TODO: Make the time step adaptive, to prevent over/under sampling
     time_step = std::min((stop_time - start_time) / 250, time_step);
-    for(double time = start_time; time < stop_time; time += time_step) {
 
-        // Simulate components
-        for(const auto &component : components)
-            component->simulate(shared_from_this(), schematic, time);
-
-        // Make conductance matrix
-        auto conductances = create_conductance_matrix();
+    // Simulate the reduced circuit in the schematic's place, if asked to (with
+    // its linear networks modelled for this time step, if a tolerance's been
+    // given). The values it eliminates are restored before each set is printed
+    Reduction reduction;
+    Profiler::Scope setup_scope("setup");
+    if(reduce) {
+        reduction.reduce(schematic, macromodel_tolerance, time_step,
+                stop_time - start_time);
+        macromodels = reduction.get_macromodels();
+        prepare(schematic, reduction.get_components(),
+                reduction.get_component_count());
+    }
+    else {
+        macromodels.clear();
+        prepare(schematic, components, schematic.get_component_count());
+    }
 
-        // Make constants matrix
-        auto constants = create_constants_matrix();
+    // The stream is only valid if the application hasn't had the 'silent' flag
+    // set; in which case, print the .csv headers
+    if(stream)
+        print_headers(stream, schematic, components);
+    setup_scope.end();
+
+    // Share the blocks between as many workers as there are processors (the
+    // first worker being this thread)
+    const unsigned int worker_count = std::max(1u, std::min(
+            (unsigned int)blocks.size(), std::thread::hardware_concurrency()));
+    const auto assignments = assign_blocks(worker_count);
+
+    std::atomic<bool> unsolved(false);
+    std::atomic<unsigned int> allocating(0);
+    Barrier barrier(worker_count);
+
+    // With nothing to print, each worker runs its blocks from start to finish
+    // independently. Otherwise, the workers keep in step, so that the values
+    // of every block can be printed together after each time step. Past each
+    // worker's first step, stepping its blocks shouldn't allocate
+    const auto work = [&](const unsigned int worker) {
+        for(double time = start_time; time < stop_time; time += time_step) {
+            const unsigned long allocations = Allocations::get_count();
+            Profiler::Scope scope("step");
+            for(const auto &block : assignments[worker]) {
+                if(step(*block, schematic, time) == false)
+                    unsolved = true;
+            }
+            scope.end();
+
+            if(time > start_time && Allocations::get_count() != allocations)
+                allocating += 1;
+
+            if(worker == 0)
+                statistics.time_steps += 1;
+
+            if(stream) {
+                barrier.wait();
+                if(worker == 0 && unsolved == false) {
+                    Profiler::Scope scope("output");
+                    reduction.restore(node_voltages, component_currents);
+                    print_values(stream, components, time);
+                }
+                barrier.wait();
+            }
 
-        // Calculate result
-        Matrix result;
-        try {
-            result = conductances.inverse() * constants;
-        }
-        catch(...) {
-            std::cerr << "Circuit has no solution" << std::endl;
-            return false;
+            if(unsolved)
+                break;
         }
+    };
+
+    std::vector<std::thread> threads;
+    for(unsigned int worker = 1; worker < worker_count; worker += 1)
+        threads.emplace_back(work, worker);
 
-        // Update the stored voltage/current values
-        update_values(result);
+    work(0);
+    for(auto &thread : threads)
+        thread.join();
 
-        // If a stream's been provided, print to it
-        if(stream)
-            print_values(stream, result, nodes, components, time);
+    allocating_steps = allocating;
+    if(allocating_steps > 0) {
+        std::cerr << allocating_steps << " time steps allocated memory " <<
+                "after their first" << std::endl;
     }
 
     // Failing all else, the simulation's succeeded
-    return true;
+    return unsolved == false;
 }
@@ -0,0 +1,930 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "components/templates/component.hpp"
+#include "components/templates/passive.hpp"
+#include "macromodel.hpp"
+#include "schematic.hpp"
+#include "solvers/factorization.hpp"
+#include "utilities/arena.hpp"
+#include "utilities/range.hpp"
+#include "utilities/sparse.hpp"
+
+/* ******************************************************************** Synopsis
+
+Simplifies a schematic's network of passives before its system is built, so
+the system has fewer unknowns to solve for. Two reductions are made, in turn,
+until neither finds anything more to do, then a third, and (if asked for) a
+fourth:
+
+Resistors or inductors of the same type connected in parallel (between the
+same two nodes) are merged into one, whose conductance (or inverse inductance)
+is the sum of theirs. Each carries a fixed share of the merged current.
+
+A node connected to nothing but two resistors (besides ground, or any node a
+source or capacitor is connected to) is eliminated, and the resistors merged
+into one, whose resistance is the sum of theirs. Both carry the merged current,
+and the node's voltage lies between those at either end, in proportion to the
+resistances.
+
+A region of nodes connected to nothing but resistors is condensed into the
+resistors it amounts to between its ports (the other nodes its resistors are
+connected to, ground included). With its interior nodes I ordered before its
+ports P, the region's conductances are
+
+    [G_II  G_IP]
+    [G_PI  G_PP]
+
+and, since no current enters the interior except through the region, its
+voltages are V_I = -G_II^-1 G_IP V_P. Eliminating them leaves the Schur
+complement G_PP - G_PI G_II^-1 G_IP, which couples every pair of ports through
+a conductance of its own. This is done only where it takes fewer resistors
+than the region had, as it does for a large mesh between a handful of ports.
+
+A region of nodes connected to nothing but resistors, capacitors, and
+inductors is replaced by a macromodel: a reduced-order model of the network,
+as seen from its ports (the nodes in it that anything else is connected to),
+built to the tolerance given. Its ports' voltages are still solved for, but
+its interior's are only estimated from the model's state.
+
+Capacitors aren't merged: since they're stamped as voltage sources, parallel
+capacitors form a loop, which the topology check rejects.
+
+The schematic itself is left as it is; the reduction holds the components to
+be simulated in its place (the originals that were left alone, and a new one
+for each merged branch, with IDs following the schematic's). Every eliminated
+node's voltage and absorbed component's current is kept track of, so they can
+be restored from the simulated values before each set is printed (so the
+voltages of a condensed region's interior are only ever found when they're
+printed).
+
+*/
+
+class Reduction {
+
+private:
+
+    // A resistor or inductor, possibly merged from several of the originals
+    struct Branch {
+        Component::Type type;
+        unsigned int nodes[2];
+        double value;
+
+        // The IDs of the original components in the branch, and the share of
+        // its current through each (negative if it's connected the other way
+        // round)
+        std::vector<std::pair<unsigned int, double>> members;
+
+        // The original component, while the branch is just that
+        Component *component;
+
+        // An original component of the branch's type, from which the one
+        // simulated in its place is copied
+        Component *prototype;
+
+        bool removed;
+    };
+
+    // A node eliminated from between two resistors, whose voltage is a
+    // fraction of the way from that of one node to another
+    struct Tap {
+        unsigned int node;
+        unsigned int from;
+        unsigned int to;
+        double fraction;
+    };
+
+    // An absorbed component, which carries a share of a branch's current
+    struct Share {
+        unsigned int component;
+        unsigned int branch;
+        double share;
+    };
+
+    // A condensed region, whose interior voltages are found from its ports'
+    struct Region {
+        std::vector<unsigned int> interior;
+        std::vector<unsigned int> ports;
+
+        // G_II^-1 G_IP, with a row for each interior node and a column for
+        // each port
+        std::vector<double> coupling;
+    };
+
+    // A component absorbed into a condensed region, whose current is found
+    // from the voltage across the branch it was part of
+    struct Drop {
+        unsigned int component;
+        unsigned int nodes[2];
+        double conductance;
+    };
+
+    // A network replaced by a macromodel, along with the rows of its basis for
+    // the voltage at each interior node
+    struct Model {
+        std::unique_ptr<Macromodel> macromodel;
+        std::vector<unsigned int> interior;
+        std::vector<double> voltages;
+    };
+
+    // A component absorbed into a macromodel, whose current is estimated
+    // from the model's state (or its rate of change, for a capacitor)
+    struct Estimate {
+        unsigned int component;
+        unsigned int model;
+        std::vector<double> weights;
+        bool rate;
+    };
+
+    // A resistor, capacitor, or inductor to be modelled, and the original
+    // components it stands for
+    struct Link {
+        Component::Type type;
+        unsigned int nodes[2];
+        double value;
+        std::vector<std::pair<unsigned int, double>> members;
+        unsigned int branch;
+    };
+
+    static const unsigned int none = std::numeric_limits<unsigned int>::max();
+
+    // The merged branches' components
+    Arena arena;
+
+    std::vector<Component *> components;
+    unsigned int component_count;
+
+    std::vector<Tap> taps;
+    std::vector<Share> shares;
+    std::vector<Region> regions;
+    std::vector<Drop> drops;
+    std::vector<Model> models;
+    std::vector<Estimate> estimates;
+
+    static bool merge_parallel(std::vector<Branch> &branches);
+    bool merge_series(std::vector<Branch> &branches,
+            const std::vector<bool> &pinned);
+    bool condense(std::vector<Branch> &branches,
+            const std::vector<bool> &pinned);
+    void model(std::vector<Branch> &branches, std::vector<Link> &links,
+            const std::vector<bool> &anchored, const double &tolerance,
+            const double &time_step, const double &duration);
+
+    Component *create(const Branch &branch, const Schematic &schematic);
+
+public:
+
+    Reduction();
+
+    unsigned int reduce(const Schematic &schematic, const double &tolerance,
+            const double &time_step, const double &duration);
+
+    Range<Component *> get_components() const;
+    std::vector<Macromodel *> get_macromodels() const;
+    unsigned int get_component_count() const;
+
+    void restore(std::vector<std::array<double, 4>> &node_voltages,
+            std::vector<std::array<double, 4>> &component_currents) const;
+
+};
+
+const unsigned int Reduction::none;
+
+Reduction::Reduction() {
+    component_count = 0;
+}
+
+// Merges branches of the same type between the same nodes. Returns true if any
+// were merged
+bool Reduction::merge_parallel(std::vector<Branch> &branches) {
+    std::map<std::tuple<int, unsigned int, unsigned int>, unsigned int>
+            firsts;
+
+    bool merged = false;
+    for(unsigned int index = 0; index < branches.size(); index += 1) {
+        auto &branch = branches[index];
+        if(branch.removed)
+            continue;
+
+        const auto key = std::make_tuple((int)branch.type,
+                std::min(branch.nodes[0], branch.nodes[1]),
+                std::max(branch.nodes[0], branch.nodes[1]));
+        const auto found = firsts.find(key);
+        if(found == firsts.end()) {
+            firsts[key] = index;
+            continue;
+        }
+
+        // Share the current in proportion to conductance (or, for inductors,
+        // inverse inductance)
+        auto &first = branches[found->second];
+        const double total = 1 / first.value + 1 / branch.value;
+        const double sign = (branch.nodes[0] == first.nodes[0]) ? 1 : -1;
+
+        for(auto &member : first.members)
+            member.second *= (1 / first.value) / total;
+        for(auto &member : branch.members) {
+            member.second *= sign * (1 / branch.value) / total;
+            first.members.push_back(member);
+        }
+
+        first.value = 1 / total;
+        first.component = nullptr;
+        branch.removed = true;
+        merged = true;
+    }
+    return merged;
+}
+
+// Eliminates the nodes connected to nothing but two resistors, merging the
+// resistors. Returns true if any were eliminated
+bool Reduction::merge_series(std::vector<Branch> &branches,
+        const std::vector<bool> &pinned) {
+
+    std::vector<std::vector<unsigned int>> incident(pinned.size());
+    for(unsigned int index = 0; index < branches.size(); index += 1) {
+        if(branches[index].removed)
+            continue;
+
+        incident[branches[index].nodes[0]].push_back(index);
+        incident[branches[index].nodes[1]].push_back(index);
+    }
+
+    bool merged = false;
+    for(unsigned int node = 1; node < pinned.size(); node += 1) {
+        if(pinned[node] || incident[node].size() != 2)
+            continue;
+
+        auto &one = branches[incident[node][0]];
+        auto &two = branches[incident[node][1]];
+        if(one.type != Component::RESISTOR || two.type != Component::RESISTOR)
+            continue;
+
+        // Resistors in parallel are left to be merged as such first
+        const unsigned int from = one.nodes[one.nodes[0] == node ? 1 : 0];
+        const unsigned int to = two.nodes[two.nodes[0] == node ? 1 : 0];
+        if(from == to)
+            continue;
+
+        taps.push_back({node, from, to, one.value / (one.value + two.value)});
+
+        // The merged resistor runs from one end to the other; the members of
+        // a resistor that ran the other way have their shares negated
+        if(one.nodes[0] != from) {
+            for(auto &member : one.members)
+                member.second = -member.second;
+        }
+        for(const auto &member : two.members) {
+            const double sign = (two.nodes[0] == node) ? 1 : -1;
+            one.members.emplace_back(member.first, sign * member.second);
+        }
+
+        one.nodes[0] = from;
+        one.nodes[1] = to;
+        one.value += two.value;
+        one.component = nullptr;
+        two.removed = true;
+
+        for(auto &index : incident[to]) {
+            if(&branches[index] == &two)
+                index = incident[node][0];
+        }
+        incident[node].clear();
+        merged = true;
+    }
+    return merged;
+}
+
+// Condenses each region of nodes connected only by resistors into the
+// resistors between its ports, where that takes fewer of them. Returns true if
+// any were condensed
+bool Reduction::condense(std::vector<Branch> &branches,
+        const std::vector<bool> &pinned) {
+
+    const unsigned int node_count = pinned.size();
+    std::vector<std::vector<unsigned int>> incident(node_count);
+    for(unsigned int index = 0; index < branches.size(); index += 1) {
+        if(branches[index].removed)
+            continue;
+
+        incident[branches[index].nodes[0]].push_back(index);
+        incident[branches[index].nodes[1]].push_back(index);
+    }
+
+    // A node can be in a region's interior if nothing but resistors are
+    // connected to it
+    std::vector<bool> inside(node_count, false);
+    for(unsigned int node = 1; node < node_count; node += 1) {
+        if(pinned[node] || incident[node].empty())
+            continue;
+
+        inside[node] = true;
+        for(const auto &index : incident[node]) {
+            if(branches[index].type != Component::RESISTOR)
+                inside[node] = false;
+        }
+    }
+
+    // Position of each node in the region being gathered (interior nodes and
+    // ports numbered separately)
+    std::vector<unsigned int> positions(node_count, none);
+    std::vector<bool> gathered(branches.size(), false);
+
+    bool condensed = false;
+    for(unsigned int start = 1; start < node_count; start += 1) {
+        if(inside[start] == false || positions[start] != none)
+            continue;
+
+        // Gather the region, breadth-first from the node
+        Region region;
+        std::vector<unsigned int> members;
+        positions[start] = 0;
+        region.interior.push_back(start);
+        for(unsigned int next = 0; next < region.interior.size(); next += 1) {
+            for(const auto &index : incident[region.interior[next]]) {
+                if(gathered[index])
+                    continue;
+
+                gathered[index] = true;
+                members.push_back(index);
+                for(const auto &node : branches[index].nodes) {
+                    if(positions[node] != none)
+                        continue;
+
+                    if(inside[node]) {
+                        positions[node] = region.interior.size();
+                        region.interior.push_back(node);
+                    }
+                    else {
+                        positions[node] = region.ports.size();
+                        region.ports.push_back(node);
+                    }
+                }
+            }
+        }
+
+        // The ports are released (so the next region can number them anew),
+        // but the interior stays claimed
+        const unsigned int size = region.interior.size();
+        const unsigned int port_count = region.ports.size();
+        for(const auto &node : region.ports)
+            positions[node] = none;
+
+        if(port_count == 0 || port_count * (port_count - 1) / 2 >=
+                members.size()) {
+            continue;
+        }
+
+        std::vector<double> interior(size * size, 0);
+        std::vector<double> coupling(size * port_count, 0);
+        std::vector<double> complement(port_count * port_count, 0);
+        for(const auto &index : members) {
+            const auto &branch = branches[index];
+            const double conductance = 1 / branch.value;
+
+            unsigned int ends[2];
+            bool insides[2];
+            for(unsigned int end = 0; end < 2; end += 1) {
+                insides[end] = inside[branch.nodes[end]];
+                ends[end] = insides[end] ? positions[branch.nodes[end]] :
+                        std::find(region.ports.begin(), region.ports.end(),
+                        branch.nodes[end]) - region.ports.begin();
+            }
+
+            for(unsigned int end = 0; end < 2; end += 1) {
+                const auto &one = ends[end];
+                const auto &two = ends[1 - end];
+                if(insides[end] == false) {
+                    complement[one * port_count + one] += conductance;
+                    continue;
+                }
+
+                interior[one * size + one] += conductance;
+                if(insides[1 - end])
+                    interior[one * size + two] -= conductance;
+                else
+                    coupling[one * port_count + two] -= conductance;
+            }
+        }
+
+        Factorization factorization;
+        if(factorization.factorize(interior, size) == false)
+            continue;
+
+        // Replace each column of G_IP with that of G_II^-1 G_IP, and take
+        // G_PI times it from the ports' conductances
+        std::vector<double> column(size);
+        for(unsigned int port = 0; port < port_count; port += 1) {
+            for(unsigned int row = 0; row < size; row += 1)
+                column[row] = coupling[row * port_count + port];
+
+            factorization.solve(column.data());
+            for(unsigned int row = 0; row < size; row += 1)
+                coupling[row * port_count + port] = column[row];
+        }
+
+        for(const auto &index : members) {
+            const auto &branch = branches[index];
+            for(unsigned int end = 0; end < 2; end += 1) {
+                const auto &port = branch.nodes[end];
+                const auto &node = branch.nodes[1 - end];
+                if(inside[port] || inside[node] == false)
+                    continue;
+
+                const unsigned int row = std::find(region.ports.begin(),
+                        region.ports.end(), port) - region.ports.begin();
+                for(unsigned int column = 0; column < port_count;
+                        column += 1) {
+
+                    complement[row * port_count + column] += (1 /
+                            branch.value) * coupling[positions[node] *
+                            port_count + column];
+                }
+            }
+        }
+
+        // The region's branches are replaced by a resistor between each pair
+        // of ports coupled through it
+        Component *prototype = branches[members[0]].prototype;
+        for(const auto &index : members) {
+            auto &branch = branches[index];
+            for(const auto &member : branch.members) {
+                drops.push_back({member.first, {branch.nodes[0],
+                        branch.nodes[1]}, member.second / branch.value});
+            }
+            branch.removed = true;
+        }
+
+        for(unsigned int row = 0; row < port_count; row += 1) {
+            for(unsigned int column = row + 1; column < port_count;
+                    column += 1) {
+
+                const double conductance = -complement[row * port_count +
+                        column];
+                if(conductance <= 0)
+                    continue;
+
+                Branch branch;
+                branch.type = Component::RESISTOR;
+                branch.nodes[0] = region.ports[row];
+                branch.nodes[1] = region.ports[column];
+                branch.value = 1 / conductance;
+                branch.component = nullptr;
+                branch.prototype = prototype;
+                branch.removed = false;
+                branches.push_back(branch);
+            }
+        }
+
+        region.coupling = coupling;
+        regions.push_back(region);
+        condensed = true;
+    }
+    return condensed;
+}
+
+// Replaces each region of nodes connected only by resistors, capacitors, and
+// inductors with a macromodel, where one can be built to the tolerance given
+// with fewer states than the region has unknowns. The links are the
+// capacitors, to which the live branches are added; those modelled have their
+// branches removed, and are themselves emptied of members
+void Reduction::model(std::vector<Branch> &branches, std::vector<Link> &links,
+        const std::vector<bool> &anchored, const double &tolerance,
+        const double &time_step, const double &duration) {
+
+    for(unsigned int index = 0; index < branches.size(); index += 1) {
+        const auto &branch = branches[index];
+        if(branch.removed)
+            continue;
+
+        links.push_back({branch.type, {branch.nodes[0], branch.nodes[1]},
+                branch.value, branch.members, index});
+    }
+
+    const unsigned int node_count = anchored.size();
+    std::vector<std::vector<unsigned int>> incident(node_count);
+    for(unsigned int index = 0; index < links.size(); index += 1) {
+        incident[links[index].nodes[0]].push_back(index);
+        incident[links[index].nodes[1]].push_back(index);
+    }
+
+    std::vector<unsigned int> positions(node_count, none);
+    std::vector<bool> gathered(links.size(), false);
+    for(unsigned int start = 1; start < node_count; start += 1) {
+        if(anchored[start] || incident[start].empty() ||
+                positions[start] != none) {
+            continue;
+        }
+
+        // Gather the region, breadth-first from the node, as its interior
+        // nodes, its ports, and the links between them
+        std::vector<unsigned int> interior;
+        std::vector<unsigned int> ports;
+        std::vector<unsigned int> members;
+        positions[start] = 0;
+        interior.push_back(start);
+        for(unsigned int next = 0; next < interior.size(); next += 1) {
+            for(const auto &index : incident[interior[next]]) {
+                if(gathered[index])
+                    continue;
+
+                gathered[index] = true;
+                members.push_back(index);
+                for(const auto &node : links[index].nodes) {
+                    if(node == 0 || positions[node] != none)
+                        continue;
+
+                    if(anchored[node]) {
+                        positions[node] = ports.size();
+                        ports.push_back(node);
+                    }
+                    else {
+                        positions[node] = interior.size();
+                        interior.push_back(node);
+                    }
+                }
+            }
+        }
+
+        // Number the unknowns: the interior's voltages, the ports', then the
+        // inductors' currents. The ports' positions are copied, so they can
+        // be released for the next region
+        const unsigned int interior_size = interior.size();
+        const unsigned int port_count = ports.size();
+        std::vector<unsigned int> unknowns(members.size(), none);
+        unsigned int size = interior_size + port_count;
+        for(unsigned int index = 0; index < members.size(); index += 1) {
+            if(links[members[index]].type == Component::INDUCTOR) {
+                unknowns[index] = size;
+                size += 1;
+            }
+        }
+
+        std::vector<unsigned int> rows;
+        for(const auto &node : ports) {
+            rows.push_back(interior_size + positions[node]);
+            positions[node] = none;
+        }
+
+        const auto row = [&](const unsigned int &node) {
+            if(node == 0)
+                return none;
+            if(anchored[node]) {
+                return rows[std::find(ports.begin(), ports.end(), node) -
+                        ports.begin()];
+            }
+            return positions[node];
+        };
+
+        // Stamp the network's G and C, sparsely: the first pass gathers the
+        // entries each row has, and the second adds up their values
+        SparseMatrix conductances;
+        SparseMatrix capacitances;
+        std::vector<std::vector<unsigned int>> conductance_pattern(size);
+        std::vector<std::vector<unsigned int>> capacitance_pattern(size);
+        for(unsigned int pass = 0; pass < 2; pass += 1) {
+            const auto stamp = [&](const bool &capacitive,
+                    const unsigned int &one, const unsigned int &two,
+                    const double &value) {
+
+                if(pass == 0) {
+                    (capacitive ? capacitance_pattern :
+                            conductance_pattern)[one].push_back(two);
+                }
+                else {
+                    (capacitive ? capacitances : conductances)(one, two) +=
+                            value;
+                }
+            };
+
+            for(unsigned int index = 0; index < members.size();
+                    index += 1) {
+
+                const auto &link = links[members[index]];
+                const unsigned int one = row(link.nodes[0]);
+                const unsigned int two = row(link.nodes[1]);
+
+                if(link.type == Component::INDUCTOR) {
+                    const auto &current = unknowns[index];
+                    if(one != none) {
+                        stamp(false, one, current, 1);
+                        stamp(false, current, one, -1);
+                    }
+                    if(two != none) {
+                        stamp(false, two, current, -1);
+                        stamp(false, current, two, 1);
+                    }
+                    stamp(true, current, current, link.value);
+                    continue;
+                }
+
+                const bool capacitive = link.type == Component::CAPACITOR;
+                const double value = capacitive ? link.value :
+                        1 / link.value;
+                if(one != none)
+                    stamp(capacitive, one, one, value);
+                if(two != none)
+                    stamp(capacitive, two, two, value);
+                if(one != none && two != none) {
+                    stamp(capacitive, one, two, -value);
+                    stamp(capacitive, two, one, -value);
+                }
+            }
+
+            if(pass == 0) {
+                conductances.set_pattern(conductance_pattern);
+                capacitances.set_pattern(capacitance_pattern);
+            }
+        }
+
+        // A model needs at least two blocks of the basis to be checked, and
+        // has to be smaller than the network to be worth it
+        const unsigned int maximum_order = size * 2 / 3;
+        if(port_count == 0 || maximum_order < port_count * 2)
+            continue;
+
+        // Build the model about the geometric mean of the lowest and highest
+        // frequencies the simulation resolves (1 / duration and 1 / time_step),
+        // and check it across them
+        std::unique_ptr<Macromodel> macromodel(new Macromodel());
+        const double change = macromodel->build(conductances, capacitances,
+                rows, ports, 1 / std::sqrt(duration * time_step),
+                1 / duration, 1 / time_step, tolerance, maximum_order);
+        if(change < 0 || macromodel->discretize(time_step) == false) {
+            std::cerr << "Couldn't reduce a linear network of " << size <<
+                    " unknowns to within a tolerance of " << tolerance <<
+                    "; leaving it whole" << std::endl;
+            continue;
+        }
+
+        std::cerr << "Reduced a linear network of " << size << " unknowns, "
+                "between " << port_count << " ports, to order " <<
+                macromodel->get_order() << " (estimated error " << change <<
+                ")" << std::endl;
+
+        // Keep the basis' rows for the interior's voltages, and combine them
+        // into estimates of the currents of the components absorbed
+        Model model;
+        const unsigned int order = macromodel->get_order();
+        const auto &basis = macromodel->basis;
+        model.interior = interior;
+        model.voltages.assign(basis.begin(), basis.begin() + interior_size *
+                order);
+
+        for(unsigned int index = 0; index < members.size(); index += 1) {
+            auto &link = links[members[index]];
+            std::vector<double> weights(order, 0);
+            if(link.type == Component::INDUCTOR) {
+                for(unsigned int column = 0; column < order; column += 1)
+                    weights[column] = basis[unknowns[index] * order + column];
+            }
+            else {
+                const unsigned int one = row(link.nodes[0]);
+                const unsigned int two = row(link.nodes[1]);
+                const double scale = (link.type == Component::RESISTOR) ?
+                        1 / link.value : link.value;
+                for(unsigned int column = 0; column < order; column += 1) {
+                    if(one != none)
+                        weights[column] += basis[one * order + column] * scale;
+                    if(two != none)
+                        weights[column] -= basis[two * order + column] * scale;
+                }
+            }
+
+            for(const auto &member : link.members) {
+                Estimate estimate;
+                estimate.component = member.first;
+                estimate.model = models.size();
+                estimate.rate = link.type == Component::CAPACITOR;
+                for(const auto &weight : weights)
+                    estimate.weights.push_back(weight * member.second);
+                estimates.push_back(estimate);
+            }
+
+            if(link.branch != none)
+                branches[link.branch].removed = true;
+            link.members.clear();
+        }
+
+        model.macromodel = std::move(macromodel);
+        models.push_back(std::move(model));
+    }
+}
+
+// Creates the component simulated in place of a merged branch, as a copy of
+// its prototype with the branch's value and nodes
+Component *Reduction::create(const Branch &branch,
+        const Schematic &schematic) {
+
+    auto merged = branch.prototype->clone(arena);
+    dynamic_cast<Passive *>(merged)->value = branch.value;
+    merged->id = component_count;
+    for(unsigned int index = 0; index < 2; index += 1) {
+        merged->node_ids[index] = branch.nodes[index];
+        merged->node_names[index] = schematic.get_node_name(
+                branch.nodes[index]).string();
+    }
+    component_count += 1;
+
+    for(const auto &member : branch.members)
+        shares.push_back({member.first, merged->id, member.second});
+    return merged;
+}
+
+// Reduces a schematic, replacing any previous reduction; with linear networks
+// replaced by macromodels if a tolerance is given, for a simulation with the
+// time step and duration given. Returns the number of components removed from
+// the system
+unsigned int Reduction::reduce(const Schematic &schematic,
+        const double &tolerance, const double &time_step,
+        const double &duration) {
+
+    const auto originals = schematic.get_components();
+    components.clear();
+    component_count = schematic.get_component_count();
+    taps.clear();
+    shares.clear();
+    regions.clear();
+    drops.clear();
+    models.clear();
+    estimates.clear();
+
+    // Every resistor and inductor starts as a branch of its own. Nodes that
+    // anything else is connected to can't be eliminated; and nodes that
+    // anything besides resistors, capacitors, and inductors is connected to
+    // can't be modelled
+    std::vector<Branch> branches;
+    std::vector<unsigned int> branch_indices(originals.size(), 0);
+    std::vector<bool> pinned(schematic.get_node_count(), false);
+    std::vector<bool> anchored(schematic.get_node_count(), false);
+    std::vector<Link> links;
+    pinned[0] = true;
+    anchored[0] = true;
+    for(const auto &component : originals) {
+        const auto &ids = component->node_ids;
+        const bool passive = component->type == Component::RESISTOR ||
+                component->type == Component::INDUCTOR;
+        if(passive == false || ids[0] == ids[1]) {
+            pinned[ids[0]] = true;
+            pinned[ids[1]] = true;
+            if(component->type == Component::CAPACITOR && ids[0] != ids[1]) {
+                links.push_back({Component::CAPACITOR, {ids[0], ids[1]},
+                        dynamic_cast<Passive *>(component)->value,
+                        {{component->id, 1}}, none});
+            }
+            else {
+                anchored[ids[0]] = true;
+                anchored[ids[1]] = true;
+            }
+            continue;
+        }
+
+        Branch branch;
+        branch.type = component->type;
+        branch.nodes[0] = ids[0];
+        branch.nodes[1] = ids[1];
+        branch.value = dynamic_cast<Passive *>(component)->value;
+        branch.members.emplace_back(component->id, 1);
+        branch.component = component;
+        branch.prototype = component;
+        branch.removed = false;
+
+        branch_indices[component->id] = branches.size();
+        branches.push_back(branch);
+    }
+
+    while(true) {
+        const bool parallel = merge_parallel(branches);
+        const bool series = merge_series(branches, pinned);
+        if(parallel == false && series == false)
+            break;
+    }
+
+    // The resistors a region's condensed into may be in parallel with others
+    const unsigned int original_count = branches.size();
+    if(condense(branches, pinned))
+        merge_parallel(branches);
+
+    // The capacitors modelled are left out of the components simulated
+    std::vector<bool> absorbed(originals.size(), false);
+    if(tolerance > 0) {
+        model(branches, links, anchored, tolerance, time_step, duration);
+        for(const auto &estimate : estimates) {
+            if(estimate.rate)
+                absorbed[estimate.component] = true;
+        }
+    }
+
+    // List the components to be simulated in the schematic's order, each
+    // merged branch in the place of its first member
+    for(const auto &component : originals) {
+        const auto &ids = component->node_ids;
+        const bool passive = component->type == Component::RESISTOR ||
+                component->type == Component::INDUCTOR;
+        if(passive == false || ids[0] == ids[1]) {
+            if(absorbed[component->id] == false)
+                components.push_back(component);
+            continue;
+        }
+
+        const auto &branch = branches[branch_indices[component->id]];
+        if(branch.removed)
+            continue;
+        if(branch.component) {
+            components.push_back(branch.component);
+            continue;
+        }
+
+        components.push_back(create(branch, schematic));
+    }
+
+    // Followed by the resistors condensed regions left (that weren't merged
+    // into others)
+    for(unsigned int index = original_count; index < branches.size();
+            index += 1) {
+
+        if(branches[index].removed == false)
+            components.push_back(create(branches[index], schematic));
+    }
+
+    return originals.size() - components.size();
+}
+
+// Returns a view of the components to be simulated
+Range<Component *> Reduction::get_components() const {
+    return Range<Component *>(components);
+}
+
+// Returns the number of component IDs in use, counting those of the merged
+// branches after the schematic's
+unsigned int Reduction::get_component_count() const {
+    return component_count;
+}
+
+// Returns the macromodels the simulation has to step alongside its components
+std::vector<Macromodel *> Reduction::get_macromodels() const {
+    std::vector<Macromodel *> macromodels;
+    for(const auto &model : models)
+        macromodels.push_back(model.macromodel.get());
+    return macromodels;
+}
+
+// Fills in the present voltages of the eliminated nodes, and the present
+// currents of the absorbed components, from the simulated values
+void Reduction::restore(std::vector<std::array<double, 4>> &node_voltages,
+        std::vector<std::array<double, 4>> &component_currents) const {
+
+    // A node's neighbours may have been eliminated after it, so they're
+    // restored first (and regions were condensed after every series merge,
+    // and networks modelled after that)
+    for(const auto &model : models) {
+        const unsigned int order = model.macromodel->get_order();
+        for(unsigned int row = 0; row < model.interior.size(); row += 1) {
+            node_voltages[model.interior[row]][2] = model.macromodel->estimate(
+                    model.voltages.data() + row * order);
+        }
+    }
+
+    for(auto region = regions.rbegin(); region != regions.rend(); ++region) {
+        const unsigned int port_count = region->ports.size();
+        for(unsigned int row = 0; row < region->interior.size(); row += 1) {
+            double voltage = 0;
+            for(unsigned int port = 0; port < port_count; port += 1) {
+                voltage -= region->coupling[row * port_count + port] *
+                        node_voltages[region->ports[port]][2];
+            }
+            node_voltages[region->interior[row]][2] = voltage;
+        }
+    }
+
+    for(auto tap = taps.rbegin(); tap != taps.rend(); ++tap) {
+        const double from = node_voltages[tap->from][2];
+        const double to = node_voltages[tap->to][2];
+        node_voltages[tap->node][2] = from + (to - from) * tap->fraction;
+    }
+
+    for(const auto &share : shares) {
+        component_currents[share.component][2] = share.share *
+                component_currents[share.branch][2];
+    }
+
+    for(const auto &drop : drops) {
+        component_currents[drop.component][2] = drop.conductance *
+                (node_voltages[drop.nodes[0]][2] -
+                node_voltages[drop.nodes[1]][2]);
+    }
+
+    for(const auto &estimate : estimates) {
+        const auto &macromodel = *models[estimate.model].macromodel;
+        component_currents[estimate.component][2] = estimate.rate ?
+                macromodel.estimate_rate(estimate.weights.data()) :
+                macromodel.estimate(estimate.weights.data());
+    }
+}
@@ -1,97 +1,148 @@
 #pragma once
 
-#include <algorithm>
-#include <iterator>
-#include <map>
-#include <memory>
+#include <array>
+#include <iostream>
+#include <string>
 #include <vector>
 
 #include "components/templates/component.hpp"
-#include "utilities/hash.hpp"
+#include "utilities/range.hpp"
+#include "utilities/symbol_table.hpp"
 
 class Schematic {
 
 private:
 
-    std::vector<std::pair<std::string, Hash>> nodes;
+    // Node names, interned to dense IDs as components are added. Ground ("0")
+    // is always interned first, so its ID is zero
+    SymbolTable node_table;
 
-    std::vector<std::shared_ptr<Component>> components;
-    std::vector<std::pair<Component::Type, Hash>> component_hashes;
-    std::vector<std::string> node_names;
-    std::vector<Hash> node_hashes;
+    // Component names, interned to dense IDs in the order they're added (so a
+    // component's ID is also its index in 'components')
+    SymbolTable component_table;
 
-    std::map<Component::Type, std::vector<std::shared_ptr<Component>>>
-            component_types;
+    // The components themselves are owned by the simulation's arena; the
+    // schematic only refers to them
+    std::vector<Component *> components;
 
-    unsigned int node_count;
+    // Components filtered by each combination of types, indexed by the mask of
+    // types. Each list is only built when it's first asked for, and is then
+    // brought up to date (by scanning just the components added since) each
+    // time it's asked for again
+    static const unsigned int type_masks = 32;
+
+    mutable std::array<std::vector<Component *>, type_masks> type_index;
+    mutable std::array<unsigned int, type_masks> indexed_counts;
 
 public:
 
-    void add_component(const std::shared_ptr<Component> &component);
+    Schematic();
 
-    std::vector<std::pair<std::string, Hash>> get_nodes() {
-        return nodes;
-    }
+    unsigned int add_node(const char *data, const std::size_t &length);
+    unsigned int add_node(const std::string &name);
+    bool add_component(Component *component);
+    bool add_connected_component(Component *component);
 
-    std::vector<std::string> get_node_names();
-    std::vector<Hash> get_node_hashes();
-    std::vector<std::shared_ptr<Component>> get_components(const int types);
-    std::vector<std::pair<Component::Type, Hash>> get_component_hashes();
+    const Symbol &get_node_name(const unsigned int &id) const;
+    Range<Symbol> get_node_names() const;
+    unsigned int get_node_count() const;
+    Range<Component *> get_components(const int types) const;
+    unsigned int get_component_count() const;
 
     bool empty() const;
 
 };
 
-std::vector<std::pair<Component::Type, Hash>>
-        Schematic::get_component_hashes() {
+const unsigned int Schematic::type_masks;
 
-    return component_hashes;
+Schematic::Schematic() {
+    node_table.intern("0");
+    indexed_counts.fill(0);
 }
 
-// Adds a component to the schematic
-void Schematic::add_component(const std::shared_ptr<Component> &component) {
+// Returns the ID of the node with the name of the length given at 'data',
+// assigning it the next ID if it hasn't been seen before
+unsigned int Schematic::add_node(const char *data, const std::size_t &length) {
+    return node_table.intern(data, length);
+}
+
+// Returns the ID of the node with a given name, assigning it the next ID if it
+// hasn't been seen before
+unsigned int Schematic::add_node(const std::string &name) {
+    return node_table.intern(name);
+}
+
+// Adds a component to the schematic, assigning its ID and the IDs of the nodes
+// it's connected to. Returns false if a component of the same name has already
+// been added
+bool Schematic::add_component(Component *component) {
     if(component == nullptr)
-        return;
+        return false;
 
-    components.push_back(component);
-    for(unsigned int index = 0; index < component->node_names.size(); index += 1) {
-        const std::string name = component->node_names[index];
-        Hash hash = component->node_hashes[index];
-        if(name == "0")
-            hash = 0;
-
-        const std::pair<std::string, Hash> node_signature = {name, hash};
-        if(std::find(nodes.begin(), nodes.end(), node_signature) == nodes.end())
-            nodes.push_back(node_signature);
-    }
+    for(unsigned int index = 0; index < component->node_names.size();
+            index += 1) {
 
-    component_hashes.push_back({component->type, component->hash});
-    component_types[component->type].push_back(component);
+        component->node_ids[index] = node_table.intern(
+                component->node_names[index]);
+    }
+    return add_connected_component(component);
 }
 
-// Return the components
-std::vector<std::shared_ptr<Component>> Schematic::get_components(
-        const int types = 0) {
+// Adds a component whose node IDs have already been assigned (by add_node),
+// assigning its ID. Returns false if a component of the same name has already
+// been added
+bool Schematic::add_connected_component(Component *component) {
+    if(component == nullptr)
+        return false;
+
+    const unsigned int id = component_table.intern(component->name);
+    if(id != components.size()) {
+        std::cerr << "Component '" << component->name << "' defined more "
+                "than once" << std::endl;
+        return false;
+    }
 
-    if(types == 0)
-        return components;
+    component->id = id;
+    components.push_back(component);
+    return true;
+}
 
-    std::vector<std::shared_ptr<Component>> result;
-    for(const auto &pair : component_types) {
-        if(types & pair.first) {
-            result.insert(result.end(), pair.second.begin(),
-                    pair.second.end());
-        }
+// Returns a view of the components of the types given (a combination of
+// Component::Type values), in the order they were added; or of every
+// component, if no types are given. The view is invalidated by adding another
+// component
+Range<Component *> Schematic::get_components(const int types = 0) const {
+    const unsigned int mask = types & (type_masks - 1);
+    if(mask == 0)
+        return Range<Component *>(components);
+
+    auto &index = type_index[mask];
+    auto &count = indexed_counts[mask];
+    for(; count < components.size(); count += 1) {
+        if(components[count]->type & mask)
+            index.push_back(components[count]);
     }
-    return result;
+    return Range<Component *>(index);
+}
+
+// Returns the name of the node with a given ID
+const Symbol &Schematic::get_node_name(const unsigned int &id) const {
+    return node_table.name(id);
+}
+
+// Returns a view of the node names, by ID (so ground's is first)
+Range<Symbol> Schematic::get_node_names() const {
+    return node_table.names();
 }
 
-std::vector<std::string> Schematic::get_node_names() {
-    return node_names;
+// Returns the number of nodes, including ground
+unsigned int Schematic::get_node_count() const {
+    return node_table.size();
 }
 
-std::vector<Hash> Schematic::get_node_hashes() {
-    return node_hashes;
+// Returns the number of components
+unsigned int Schematic::get_component_count() const {
+    return components.size();
 }
 
 // Returns true if there are no components in the schematic
@@ -10,8 +10,13 @@
 #include "operations/operation.hpp"
 
 #include "schematic.hpp"
+#include "subcircuit.hpp"
+#include "topology.hpp"
+
+#include "utilities/profiler.hpp"
 
 #include "operations/transient.hpp"
+#include "operations/relaxation.hpp"
 
 #include "components/resistor.hpp"
 #include "components/capacitor.hpp"
@@ -26,12 +31,19 @@ public:
 
     std::shared_ptr<Operation> operation;
 
+    // Every component and source function is created in this arena, so it
+    // has to outlive the schematic (which only refers to them)
+    Arena arena;
+
     Schematic schematic;
 
+    std::map<std::string, std::shared_ptr<Subcircuit>> subcircuits;
+
     static std::shared_ptr<Simulation> parse(const std::string &specification);
 
-    static std::shared_ptr<Component> parse_component(
-            TextBuffer &buffer);
+    static Component *parse_component(TextBuffer &buffer, Arena &arena);
+    static std::shared_ptr<Subcircuit> parse_subcircuit(TextBuffer &buffer,
+            Arena &arena);
 
     bool run(std::shared_ptr<std::ostream> stream);
 
@@ -44,7 +56,12 @@ std::shared_ptr<Simulation> Simulation::parse(
     // Create a new simulation pointer
     auto simulation = std::shared_ptr<Simulation>(new Simulation());
 
+    // Instances are flattened once the whole file's been parsed, since they
+    // can precede their definitions
+    std::vector<Subcircuit::Instance> instances;
+
     TextBuffer buffer(specification);
+    Profiler::Scope parse_scope("parse");
     while(true) {
 
         // Stop if the end of the text's been reached
@@ -61,8 +78,10 @@ std::shared_ptr<Simulation> Simulation::parse(
         // Handle commands
         else if(character == '.') {
 
+            const auto command = buffer.get_string();
+
             // Parse transient operation specifications
-            if(buffer.get_string() == ".tran") {
+            if(command == ".tran") {
                 const auto transient = Transient::parse(buffer);
                 if(transient == nullptr) {
                     std::cerr << "Couldn't parse transient operation, line " <<
@@ -73,22 +92,57 @@ std::shared_ptr<Simulation> Simulation::parse(
                 simulation->operation = transient;
             }
 
+            // Parse subcircuit definitions
+            else if(command == ".subckt") {
+                const auto subcircuit = parse_subcircuit(buffer,
+                        simulation->arena);
+                if(subcircuit == nullptr) {
+                    std::cerr << "Couldn't parse subcircuit definition, "
+                            "line " << buffer.get_line_number() << std::endl;
+                    return nullptr;
+                }
+
+                auto &definition = simulation->subcircuits[subcircuit->name];
+                if(definition) {
+                    std::cerr << "Subcircuit '" << subcircuit->name <<
+                            "' defined more than once" << std::endl;
+                    return nullptr;
+                }
+                definition = subcircuit;
+            }
+
             // If it's not an operation, we can ignore it for the purposes of
             // this application
             else
                 buffer.skip_line();
         }
 
+        // Handle subcircuit instances
+        else if(character == 'X') {
+            Subcircuit::Instance instance;
+            if(Subcircuit::Instance::parse(buffer, instance) == false) {
+                std::cerr << "Error parsing subcircuit instance, line " <<
+                        buffer.get_line_number() << std::endl;
+                return nullptr;
+            }
+
+            instances.push_back(instance);
+        }
+
         // Handle component definitions
         else if(character >= 'A' && character <= 'Z') {
-            const auto component = parse_component(buffer);
+            const auto component = parse_component(buffer, simulation->arena);
             if(component == nullptr) {
                 std::cerr << "Error parsing component, line " <<
                         buffer.get_line_number() << std::endl;
                 return nullptr;
             }
 
-            simulation->schematic.add_component(component);
+            if(simulation->schematic.add_component(component) == false) {
+                std::cerr << "Error adding component, line " <<
+                        buffer.get_line_number() << std::endl;
+                return nullptr;
+            }
         }
 
         // Check that the current line/lines have been fully parsed
@@ -102,6 +156,26 @@ std::shared_ptr<Simulation> Simulation::parse(
         }
     }
 
+    // Flatten the subcircuit instances into the schematic
+    Profiler::Scope schematic_scope("schematic");
+    for(const auto &instance : instances) {
+        const auto definition = simulation->subcircuits.find(
+                instance.definition);
+        if(definition == simulation->subcircuits.end()) {
+            std::cerr << "No definition for subcircuit '" <<
+                    instance.definition << "' (instance '" << instance.name <<
+                    "')" << std::endl;
+            return nullptr;
+        }
+
+        if(definition->second->instantiate(instance, simulation->subcircuits,
+                simulation->schematic, simulation->arena) == false) {
+            std::cerr << "Couldn't instantiate subcircuit '" <<
+                    instance.name << "'" << std::endl;
+            return nullptr;
+        }
+    }
+
     // Check there were components found in the file
     bool failed = false;
     if(simulation->schematic.empty()) {
@@ -118,29 +192,108 @@ std::shared_ptr<Simulation> Simulation::parse(
     if(failed)
         return nullptr;
 
+    // Check the circuit can be solved, before anything's built to solve it
+    if(Topology::check(simulation->schematic) == false) {
+        std::cerr << "Circuit has no solution" << std::endl;
+        return nullptr;
+    }
+
     return simulation;
 
 }
 
 // Parses a component definition
-std::shared_ptr<Component>  Simulation::parse_component(TextBuffer &buffer) {
+Component *Simulation::parse_component(TextBuffer &buffer, Arena &arena) {
     switch(buffer.get_character()) {
         case 'C':
-            return Capacitor::parse(buffer);
+            return Capacitor::parse(buffer, arena);
         case 'L':
-            return Inductor::parse(buffer);
+            return Inductor::parse(buffer, arena);
         case 'R':
-            return Resistor::parse(buffer);
+            return Resistor::parse(buffer, arena);
         case 'I':
-            return CurrentSource::parse(buffer);
+            return CurrentSource::parse(buffer, arena);
         case 'V':
-            return VoltageSource::parse(buffer);
+            return VoltageSource::parse(buffer, arena);
         default:
             std::cerr << "Couldn't identify component type" << std::endl;
             return nullptr;
     }
 }
 
+// Parses a subcircuit definition, up to and including its '.ends' line
+std::shared_ptr<Subcircuit> Simulation::parse_subcircuit(TextBuffer &buffer,
+        Arena &arena) {
+    const auto subcircuit = Subcircuit::parse(buffer);
+    if(subcircuit == nullptr)
+        return nullptr;
+
+    while(true) {
+
+        // The definition has to be closed before the end of the text
+        buffer.skip_whitespace();
+        if(buffer.end_reached()) {
+            std::cerr << "Subcircuit '" << subcircuit->name << "' has no "
+                    "'.ends'" << std::endl;
+            return nullptr;
+        }
+
+        const auto character = buffer.get_character();
+
+        // Skip comments
+        if(character == '*')
+            buffer.skip_line();
+
+        // Handle commands; only the end of the definition is meaningful here
+        else if(character == '.') {
+            const auto command = buffer.get_string();
+            if(command == ".ends") {
+                buffer.skip_line();
+                break;
+            }
+            else if(command == ".subckt") {
+                std::cerr << "Subcircuit definitions can't be nested (in '" <<
+                        subcircuit->name << "')" << std::endl;
+                return nullptr;
+            }
+            else
+                buffer.skip_line();
+        }
+
+        // Handle nested instances
+        else if(character == 'X') {
+            Subcircuit::Instance instance;
+            if(Subcircuit::Instance::parse(buffer, instance) == false)
+                return nullptr;
+
+            subcircuit->add_instance(instance);
+        }
+
+        // Handle component definitions
+        else if(character >= 'A' && character <= 'Z') {
+            const auto component = parse_component(buffer, arena);
+            if(component == nullptr) {
+                std::cerr << "Error parsing component, line " <<
+                        buffer.get_line_number() << std::endl;
+                return nullptr;
+            }
+
+            subcircuit->add_component(component);
+        }
+
+        // Check that the current line/lines have been fully parsed
+        if(buffer.end_reached() == false && buffer.skip_character('\n') ==
+                false) {
+
+            std::cerr << "Syntax error, line " << buffer.get_line_number() <<
+                    std::endl;
+            return nullptr;
+        }
+    }
+
+    return subcircuit;
+}
+
 // Run the simulation provided
 bool Simulation::run(std::shared_ptr<std::ostream> stream) {
 
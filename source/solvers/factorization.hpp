@@ -0,0 +1,330 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "../utilities/aligned.hpp"
+#include "../utilities/kernels.hpp"
+#include "../utilities/matrix.hpp"
+
+/* ******************************************************************** Synopsis
+
+The LU factorization of a square matrix, found by Gaussian elimination with
+partial pivoting. Once factorized, the system it describes can be solved for
+any number of right-hand sides, at the cost of two triangular substitutions
+each (rather than another elimination).
+
+The factors are stored together in one row-major array: the unit lower
+triangle (whose diagonal isn't stored) below the diagonal, and the upper
+triangle on and above it. The row swaps are recorded as they're made, and
+replayed on each right-hand side before it's substituted.
+
+Larger matrices are factorized a panel of columns at a time: the panel's
+eliminated on its own, then the rest of the matrix is updated for all of its
+columns at once, by a cache-tiled product (see kernels.hpp), rather than being
+swept over once per column. Each value still has the same updates made to it,
+in the same order, so the factors are the same as column by column.
+
+*/
+
+class Factorization {
+
+private:
+
+    // The number of columns factorized at a time, before the rest of the
+    // matrix is updated for them all at once
+    static const unsigned int panel_width = 32;
+
+    unsigned int size;
+
+    std::vector<double, AlignedAllocator<double>> factors;
+    std::vector<unsigned int> pivots;
+
+    bool eliminate();
+
+public:
+
+    Factorization();
+
+    bool factorize(const Matrix &matrix);
+    bool factorize(const std::vector<double> &values,
+            const unsigned int &size);
+
+    void solve(double *values) const;
+    void solve(double *values, const unsigned int &count) const;
+    void solve_transposed(double *values) const;
+
+    double estimate_inverse_norm() const;
+
+    unsigned int get_size() const;
+    unsigned int get_nonzero_count() const;
+    double get_largest_factor() const;
+
+};
+
+const unsigned int Factorization::panel_width;
+
+Factorization::Factorization() {
+    size = 0;
+}
+
+// Factorizes a square matrix. Returns false if it's singular. The factors'
+// storage is kept between factorizations, so refactorizing a matrix of the
+// same size allocates nothing
+bool Factorization::factorize(const Matrix &matrix) {
+    const unsigned int size = matrix.rows();
+    if(matrix.columns() != size)
+        return false;
+
+    this->size = size;
+    factors.assign(matrix.data(), matrix.data() + size * size);
+    pivots.resize(size);
+    return eliminate();
+}
+
+// Factorizes a square matrix, given as a row-major array of its values.
+// Returns false if it's singular
+bool Factorization::factorize(const std::vector<double> &values,
+        const unsigned int &size) {
+
+    this->size = size;
+    factors.assign(values.begin(), values.end());
+    pivots.resize(size);
+    return eliminate();
+}
+
+// Factorizes the values in place of the factors, recording the row swaps.
+// Returns false if the matrix is singular
+bool Factorization::eliminate() {
+    double *values = factors.data();
+    for(unsigned int start = 0; start < size; start += panel_width) {
+        const unsigned int end = std::min(size, start + panel_width);
+
+        // Factorize the panel's columns, updating only the panel as each is
+        // eliminated from the rows below
+        for(unsigned int index = start; index < end; index += 1) {
+
+            // Choose the row with the largest value in this column as the
+            // pivot, to keep the multipliers below one
+            unsigned int pivot = index;
+            for(unsigned int row = index + 1; row < size; row += 1) {
+                if(std::fabs(values[row * size + index]) >
+                        std::fabs(values[pivot * size + index])) {
+                    pivot = row;
+                }
+            }
+
+            if(values[pivot * size + index] == 0)
+                return false;
+
+            pivots[index] = pivot;
+            if(pivot != index) {
+                std::swap_ranges(values + index * size, values + (index + 1) *
+                        size, values + pivot * size);
+            }
+
+            // Store the multipliers where the eliminated values were
+            const double diagonal = values[index * size + index];
+            for(unsigned int row = index + 1; row < size; row += 1) {
+                double &multiplier = values[row * size + index];
+                if(multiplier == 0)
+                    continue;
+
+                multiplier /= diagonal;
+                subtract_scaled_row(end - index - 1, multiplier,
+                        values + index * size + index + 1,
+                        values + row * size + index + 1);
+            }
+        }
+
+        if(end == size)
+            break;
+
+        // Find the panel's rows of U to its right, through its unit lower
+        // triangle, then update the rest of the matrix below them with the
+        // product of the panel's multipliers and those rows
+        const unsigned int width = size - end;
+        for(unsigned int row = start + 1; row < end; row += 1) {
+            for(unsigned int index = start; index < row; index += 1) {
+                const double multiplier = values[row * size + index];
+                if(multiplier != 0) {
+                    subtract_scaled_row(width, multiplier, values + index *
+                            size + end, values + row * size + end);
+                }
+            }
+        }
+
+        add_product(width, width, end - start, values + end * size + start,
+                size, values + start * size + end, size, values + end *
+                size + end, size, -1);
+    }
+
+    return true;
+}
+
+// Solves the factorized system in place, replacing the right-hand side given
+// (an array of 'size' values) with the solution
+void Factorization::solve(double *values) const {
+    for(unsigned int index = 0; index < size; index += 1) {
+        if(pivots[index] != index)
+            std::swap(values[index], values[pivots[index]]);
+    }
+
+    // Forward substitution, through the unit lower triangle
+    for(unsigned int row = 1; row < size; row += 1) {
+        double sum = values[row];
+        for(unsigned int column = 0; column < row; column += 1)
+            sum -= factors[row * size + column] * values[column];
+        values[row] = sum;
+    }
+
+    // Back substitution, through the upper triangle
+    for(unsigned int row = size; row-- > 0;) {
+        double sum = values[row];
+        for(unsigned int column = row + 1; column < size; column += 1)
+            sum -= factors[row * size + column] * values[column];
+        values[row] = sum / factors[row * size + row];
+    }
+}
+
+// Solves the factorized system in place for several right-hand sides at once,
+// given (and replaced by their solutions) as the columns of a row-major array
+// of 'size' rows and 'count' columns. The substitutions work a row at a time,
+// so each step runs along contiguous values
+void Factorization::solve(double *values, const unsigned int &count) const {
+    for(unsigned int index = 0; index < size; index += 1) {
+        if(pivots[index] != index) {
+            std::swap_ranges(values + index * count, values + (index + 1) *
+                    count, values + pivots[index] * count);
+        }
+    }
+
+    for(unsigned int row = 1; row < size; row += 1) {
+        for(unsigned int column = 0; column < row; column += 1) {
+            const double factor = factors[row * size + column];
+            if(factor != 0) {
+                subtract_scaled_row(count, factor, values + column * count,
+                        values + row * count);
+            }
+        }
+    }
+
+    for(unsigned int row = size; row-- > 0;) {
+        for(unsigned int column = row + 1; column < size; column += 1) {
+            const double factor = factors[row * size + column];
+            if(factor != 0) {
+                subtract_scaled_row(count, factor, values + column * count,
+                        values + row * count);
+            }
+        }
+
+        const double diagonal = factors[row * size + row];
+        for(unsigned int index = 0; index < count; index += 1)
+            values[row * count + index] /= diagonal;
+    }
+}
+
+// Solves the transposed system (A^T x = b) in place. With PA = LU, that's
+// U^T L^T P x = b: substitution through U^T then L^T, then the row swaps
+// undone in reverse
+void Factorization::solve_transposed(double *values) const {
+    for(unsigned int row = 0; row < size; row += 1) {
+        double sum = values[row];
+        for(unsigned int column = 0; column < row; column += 1)
+            sum -= factors[column * size + row] * values[column];
+        values[row] = sum / factors[row * size + row];
+    }
+
+    for(unsigned int row = size; row-- > 0;) {
+        double sum = values[row];
+        for(unsigned int column = row + 1; column < size; column += 1)
+            sum -= factors[column * size + row] * values[column];
+        values[row] = sum;
+    }
+
+    for(unsigned int index = size; index-- > 0;) {
+        if(pivots[index] != index)
+            std::swap(values[index], values[pivots[index]]);
+    }
+}
+
+// Estimates the 1-norm of the factorized matrix's inverse, by Hager's method
+// (as refined by Higham): a few solves with the factors, rather than the
+// inverse itself. The estimate's a lower bound, and rarely far below it
+double Factorization::estimate_inverse_norm() const {
+    if(size == 0)
+        return 0;
+
+    std::vector<double> values(size, 1.0 / size);
+    std::vector<double> signs(size);
+    double estimate = 0;
+    unsigned int previous = size;
+    for(unsigned int iteration = 0; iteration < 5; iteration += 1) {
+        solve(values.data());
+
+        double norm = 0;
+        for(unsigned int index = 0; index < size; index += 1) {
+            norm += std::fabs(values[index]);
+            signs[index] = values[index] >= 0 ? 1 : -1;
+        }
+        if(iteration > 0 && norm <= estimate)
+            break;
+        estimate = norm;
+
+        solve_transposed(signs.data());
+        unsigned int largest = 0;
+        for(unsigned int index = 1; index < size; index += 1) {
+            if(std::fabs(signs[index]) > std::fabs(signs[largest]))
+                largest = index;
+        }
+        if(largest == previous)
+            break;
+        previous = largest;
+
+        std::fill(values.begin(), values.end(), 0);
+        values[largest] = 1;
+    }
+
+    // Higham's alternating vector catches what the iteration can miss
+    for(unsigned int index = 0; index < size; index += 1) {
+        values[index] = (index % 2 ? -1.0 : 1.0) * (1 + index / (size - 1.0 +
+                (size == 1)));
+    }
+    solve(values.data());
+
+    double norm = 0;
+    for(const auto &value : values)
+        norm += std::fabs(value);
+    return std::max(estimate, 2 * norm / (3 * size));
+}
+
+// Returns the number of rows (and columns) in the factorized matrix
+unsigned int Factorization::get_size() const {
+    return size;
+}
+
+// Returns the number of non-zero entries in the factors (counting the unit
+// diagonal of L, which isn't stored, once with U's)
+unsigned int Factorization::get_nonzero_count() const {
+    unsigned int count = 0;
+    for(const auto &factor : factors) {
+        if(factor != 0)
+            count += 1;
+    }
+    return count;
+}
+
+// Returns the magnitude of the largest entry in the factors' upper triangle,
+// which partial pivoting keeps from growing too far past the matrix's own
+double Factorization::get_largest_factor() const {
+    double largest = 0;
+    for(unsigned int row = 0; row < size; row += 1) {
+        for(unsigned int column = row; column < size; column += 1) {
+            largest = std::max(largest, std::fabs(factors[row * size +
+                    column]));
+        }
+    }
+    return largest;
+}
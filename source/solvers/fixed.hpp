@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+/* ******************************************************************** Synopsis
+
+Solvers for small systems, whose size is fixed at compile time. Most circuits
+simulated in sweeps have only a handful of unknowns, and for those the general
+Factorization's runtime-sized arrays are mostly overhead: every loop's bounds
+are loaded and tested, and the factors live on the heap. A FixedMatrix keeps
+its values in a std::array, and every loop over it has a constant bound, so
+the compiler can unroll them and keep a small system's factors in registers
+and the L1 cache.
+
+The elimination and substitutions are those of Factorization (the same pivots,
+and the same operations, in the same order), so a system solved either way
+gets the same solution, to the bit.
+
+A system's solved by a FixedSolver, which hides the size behind a virtual
+interface; one's created for a size at runtime by FixedSolver::create, which
+picks between the instantiations for sizes of 1 to largest_size.
+
+*/
+
+// A square matrix of N rows, held in row-major order, without bounds checks
+template <unsigned int N>
+class FixedMatrix {
+
+private:
+
+    std::array<double, N * N> values;
+
+public:
+
+    double &operator()(const unsigned int &row, const unsigned int &column);
+    double operator()(const unsigned int &row, const unsigned int &column)
+            const;
+
+    double *data();
+
+};
+
+// Returns the value at a row and column
+template <unsigned int N>
+double &FixedMatrix<N>::operator()(const unsigned int &row,
+        const unsigned int &column) {
+
+    return values[row * N + column];
+}
+
+// Returns a copy of the value at a row and column
+template <unsigned int N>
+double FixedMatrix<N>::operator()(const unsigned int &row,
+        const unsigned int &column) const {
+
+    return values[row * N + column];
+}
+
+// Returns the matrix's values, in row-major order
+template <unsigned int N>
+double *FixedMatrix<N>::data() {
+    return values.data();
+}
+
+// ******************************************************************** Solvers
+
+class FixedSolver {
+
+public:
+
+    // Systems of up to this many unknowns are given a solver of their size
+    static const unsigned int largest_size = 16;
+
+    virtual ~FixedSolver() {}
+
+    // Factorizes a system, given as the row-major array of its values.
+    // Returns false if it's singular
+    virtual bool factorize(const double *values) = 0;
+
+    // Solves the factorized system in place, replacing the right-hand side
+    // given with the solution
+    virtual void solve(double *values) const = 0;
+
+    static std::shared_ptr<FixedSolver> create(const unsigned int &size);
+
+};
+
+const unsigned int FixedSolver::largest_size;
+
+// The LU factorization, with partial pivoting, of a system of N unknowns
+template <unsigned int N>
+class FixedFactorization : public FixedSolver {
+
+private:
+
+    FixedMatrix<N> factors;
+    std::array<unsigned int, N> pivots;
+
+public:
+
+    bool factorize(const double *values) override;
+    void solve(double *values) const override;
+
+};
+
+template <unsigned int N>
+bool FixedFactorization<N>::factorize(const double *values) {
+    std::copy(values, values + N * N, factors.data());
+
+    for(unsigned int index = 0; index < N; index += 1) {
+
+        // Choose the row with the largest value in this column as the pivot
+        unsigned int pivot = index;
+        for(unsigned int row = index + 1; row < N; row += 1) {
+            if(std::fabs(factors(row, index)) >
+                    std::fabs(factors(pivot, index))) {
+                pivot = row;
+            }
+        }
+
+        if(factors(pivot, index) == 0)
+            return false;
+
+        pivots[index] = pivot;
+        if(pivot != index) {
+            for(unsigned int column = 0; column < N; column += 1)
+                std::swap(factors(index, column), factors(pivot, column));
+        }
+
+        // Eliminate the column from the rows below, storing the multipliers
+        // where the eliminated values were
+        const double diagonal = factors(index, index);
+        for(unsigned int row = index + 1; row < N; row += 1) {
+            double &multiplier = factors(row, index);
+            if(multiplier == 0)
+                continue;
+
+            multiplier /= diagonal;
+            for(unsigned int column = index + 1; column < N; column += 1)
+                factors(row, column) -= multiplier * factors(index, column);
+        }
+    }
+
+    return true;
+}
+
+template <unsigned int N>
+void FixedFactorization<N>::solve(double *values) const {
+    for(unsigned int index = 0; index < N; index += 1) {
+        if(pivots[index] != index)
+            std::swap(values[index], values[pivots[index]]);
+    }
+
+    // Forward substitution, through the unit lower triangle
+    for(unsigned int row = 1; row < N; row += 1) {
+        double sum = values[row];
+        for(unsigned int column = 0; column < row; column += 1)
+            sum -= factors(row, column) * values[column];
+        values[row] = sum;
+    }
+
+    // Back substitution, through the upper triangle
+    for(unsigned int row = N; row-- > 0;) {
+        double sum = values[row];
+        for(unsigned int column = row + 1; column < N; column += 1)
+            sum -= factors(row, column) * values[column];
+        values[row] = sum / factors(row, row);
+    }
+}
+
+// Creates the solver for a size, from those of size N down
+template <unsigned int N>
+struct FixedSolverFactory {
+    static FixedSolver *create(const unsigned int &size) {
+        if(size == N)
+            return new FixedFactorization<N>();
+        return FixedSolverFactory<N - 1>::create(size);
+    }
+};
+
+template <>
+struct FixedSolverFactory<0> {
+    static FixedSolver *create(const unsigned int &) {
+        return nullptr;
+    }
+};
+
+// Creates a solver for systems of the size given, or returns null if there's
+// none that size
+std::shared_ptr<FixedSolver> FixedSolver::create(const unsigned int &size) {
+    return std::shared_ptr<FixedSolver>(
+            FixedSolverFactory<largest_size>::create(size));
+}
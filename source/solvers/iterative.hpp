@@ -0,0 +1,666 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../utilities/sparse.hpp"
+
+/* ******************************************************************** Synopsis
+
+Solves a large sparse system iteratively, by a preconditioned Krylov method,
+rather than by factorizing it. Factorizing the system of a large mesh (like a
+power grid's) fills in much of its factors, so their storage grows far faster
+than the system; the iterations only ever need the matrix, a preconditioner
+with the same pattern, and a fixed number of vectors, so the memory they take
+grows only with the number of non-zero entries.
+
+Before it's solved, the system's equilibrated: its rows and columns are scaled
+so that their largest entries are one (R A C y = R b, with x = C y), which
+evens out the spread of conductances between the parts of a circuit, and with
+it the convergence. A system that's symmetric with a positive diagonal (as a
+mesh of resistors, with its sources' nodes removed, is) is scaled by the
+square root of its diagonal on both sides instead, which keeps it symmetric.
+
+A symmetric system is then solved by the conjugate gradient method, which
+needs it positive definite too; if that proves not to be so (the method breaks
+down), the system's solved as a general one. General systems (those with the
+branch currents of floating sources among their unknowns) are solved by
+GMRES, restarted every restart_length iterations. BiCGSTAB takes less memory,
+but on these systems (which are indefinite) its residual can stall far above
+the tolerance, where GMRES's never grows.
+
+Either method is preconditioned by the incomplete LU factorization of the
+scaled matrix with no fill-in, ILU(0): the elimination's updates are only made
+to entries in the matrix's own pattern. A general MNA system has nothing on
+the diagonal of each source's row (its equation only relates its nodes'
+voltages), and the resistors around a node whose only tie to the rest is a
+floating source make a singular block, so ILU(0) of the system as it's built
+often meets a zero pivot. So before it's equilibrated, each row with nothing
+on its diagonal is swapped with the row of one of the nodes in its equation
+(one not swapped already): the source's equation moves to the node's row,
+where its coefficient for the node's voltage is on the diagonal, and the
+node's equation to the source's row, where its coefficient for the source's
+current is. Only the order of the equations changes, not the unknowns. Where
+a pivot's still zero, or so small next to the rest of its row (under 1e-12
+of its largest entry) that it's only what rounding left of a zero, the Jacobi
+preconditioner (the inverse of the diagonal, or one where that's zero) is
+used in place of ILU(0).
+
+The solve starts from the solution it's given, which for a transient is the
+last time step's; since a circuit's values change little between steps, a
+warm-started solve typically converges in few iterations. The matrix is
+kept, and the equilibration and preconditioner are only redone when it
+changes. After the first solve, the vectors the iterations work in are kept
+too, so further solves allocate nothing.
+
+*/
+
+class IterativeSolver {
+
+private:
+
+    enum Method {CONJUGATE_GRADIENT, GMRES};
+    enum Preconditioner {INCOMPLETE_LU, JACOBI};
+
+    // The residual a solution has to reach (relative to the constants'), the
+    // fewest iterations it's given to get there, and the iterations GMRES
+    // takes before it restarts (which it keeps a vector for each of)
+    double tolerance;
+    unsigned int minimum_iteration_limit;
+    unsigned int restart_length;
+
+    // The smallest pivot ILU(0) accepts, relative to the largest entry of
+    // its row in the scaled matrix (anything smaller is taken to be what's
+    // left of a zero by rounding)
+    double pivot_threshold;
+
+    Method method;
+    Preconditioner preconditioner;
+    bool prepared;
+
+    // The values of the matrix last prepared for, to tell whether the next
+    // has changed
+    std::vector<double> prepared_values;
+
+    // The row of the matrix each of the scaled matrix's rows is (the rows
+    // with nothing on their diagonals having been swapped with others), and
+    // the order the scaled matrix's pattern was last set for
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> pattern_order;
+
+    // The equilibrated matrix, its scales, and its incomplete factors (the
+    // unit lower triangle and the upper, on the matrix's pattern)
+    SparseMatrix scaled;
+    std::vector<double> row_scales;
+    std::vector<double> column_scales;
+    std::vector<double> factors;
+
+    // While the factors are found, the position among them of each column's
+    // entry in the row being eliminated, or 'none' where it has none
+    static const unsigned int none = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> positions;
+
+    // The vectors the iterations work in
+    std::vector<double> constants;
+    std::vector<double> solution;
+    std::vector<double> residual;
+    std::vector<double> direction;
+    std::vector<double> preconditioned;
+    std::vector<double> product;
+
+    // For GMRES, the orthonormal basis of the Krylov space (one vector after
+    // another), the Hessenberg matrix of its projection (row-major, turned
+    // upper triangular by Givens rotations as it's built), the rotations'
+    // cosines and sines, the rotated norm of the residual, and the solution's
+    // coefficients in the basis
+    std::vector<double> basis;
+    std::vector<double> hessenberg;
+    std::vector<double> cosines;
+    std::vector<double> sines;
+    std::vector<double> rotated;
+    std::vector<double> coefficients;
+
+    unsigned int iterations;
+    unsigned int preparations;
+
+    bool is_symmetric(const SparseMatrix &matrix) const;
+    void order_rows(const SparseMatrix &matrix);
+    bool equilibrate(const SparseMatrix &matrix);
+    bool factorize_incomplete();
+    void precondition(const std::vector<double> &values,
+            std::vector<double> &result) const;
+
+    bool solve_conjugate_gradient(const double &target);
+    void size_gmres();
+    bool solve_gmres(const double &target);
+
+public:
+
+    IterativeSolver();
+
+    bool prepare(const SparseMatrix &matrix);
+    bool solve(const double *constants, double *solution);
+
+    unsigned int get_iterations() const;
+    unsigned int get_preparations() const;
+
+};
+
+const unsigned int IterativeSolver::none;
+
+IterativeSolver::IterativeSolver() {
+    tolerance = 1e-10;
+    minimum_iteration_limit = 1000;
+    restart_length = 50;
+    pivot_threshold = 1e-12;
+    method = GMRES;
+    preconditioner = JACOBI;
+    prepared = false;
+    iterations = 0;
+    preparations = 0;
+}
+
+// The dot product of two vectors of the same size
+inline double dot(const std::vector<double> &one,
+        const std::vector<double> &two) {
+
+    double sum = 0;
+    for(unsigned int index = 0; index < one.size(); index += 1)
+        sum += one[index] * two[index];
+    return sum;
+}
+
+// Reorders, equilibrates, and preconditions a matrix, to solve systems of,
+// unless it's the matrix last prepared for. Returns false if it's singular (a
+// row or column of it is all zeros)
+bool IterativeSolver::prepare(const SparseMatrix &matrix) {
+    if(prepared && matrix.get_values() == prepared_values)
+        return true;
+
+    prepared_values = matrix.get_values();
+    preparations += 1;
+
+    // Size the vectors (which, for a matrix of the same size, allocates
+    // nothing)
+    const unsigned int size = matrix.rows();
+    for(auto vector : {&constants, &solution, &residual, &direction,
+            &preconditioned, &product}) {
+
+        vector->resize(size);
+    }
+
+    method = is_symmetric(matrix) ? CONJUGATE_GRADIENT : GMRES;
+    order_rows(matrix);
+    prepared = equilibrate(matrix);
+    if(prepared == false)
+        return false;
+    if(method == GMRES)
+        size_gmres();
+
+    preconditioner = factorize_incomplete() ? INCOMPLETE_LU : JACOBI;
+    return true;
+}
+
+// True if a matrix is symmetric, with a positive diagonal
+bool IterativeSolver::is_symmetric(const SparseMatrix &matrix) const {
+    const auto &starts = matrix.get_starts();
+    const auto &columns = matrix.get_columns();
+    const auto &values = matrix.get_values();
+    const auto &diagonals = matrix.get_diagonals();
+
+    for(unsigned int row = 0; row < matrix.rows(); row += 1) {
+        if(values[diagonals[row]] <= 0)
+            return false;
+
+        for(unsigned int index = starts[row]; index < starts[row + 1];
+                index += 1) {
+
+            if(matrix.value(columns[index], row) != values[index])
+                return false;
+        }
+    }
+    return true;
+}
+
+// Chooses the order of the scaled matrix's rows: each row with nothing on its
+// diagonal is swapped with the first row in its pattern that has something on
+// its diagonal, and a non-zero in the column of the first's (so both have
+// something on their diagonals once they're swapped), and isn't swapped
+// already. A symmetric system's left in order
+void IterativeSolver::order_rows(const SparseMatrix &matrix) {
+    const unsigned int size = matrix.rows();
+    const auto &starts = matrix.get_starts();
+    const auto &columns = matrix.get_columns();
+    const auto &values = matrix.get_values();
+    const auto &diagonals = matrix.get_diagonals();
+
+    order.resize(size);
+    for(unsigned int row = 0; row < size; row += 1)
+        order[row] = row;
+    if(method == CONJUGATE_GRADIENT)
+        return;
+
+    for(unsigned int row = 0; row < size; row += 1) {
+        if(values[diagonals[row]] != 0 || order[row] != row)
+            continue;
+
+        for(unsigned int index = starts[row]; index < starts[row + 1];
+                index += 1) {
+
+            const unsigned int other = columns[index];
+            if(values[index] != 0 && order[other] == other &&
+                    values[diagonals[other]] != 0 &&
+                    matrix.value(other, row) != 0) {
+
+                order[row] = other;
+                order[other] = row;
+                break;
+            }
+        }
+    }
+}
+
+// Scales the matrix's rows and columns into the scaled matrix (symmetrically,
+// for the conjugate gradient method). Returns false if a row or column has
+// no non-zero entries
+bool IterativeSolver::equilibrate(const SparseMatrix &matrix) {
+    const unsigned int size = matrix.rows();
+    const auto &starts = matrix.get_starts();
+    const auto &columns = matrix.get_columns();
+    const auto &values = matrix.get_values();
+    const auto &diagonals = matrix.get_diagonals();
+
+    // Each of the scaled matrix's rows has the same columns as the row of
+    // the matrix it is (which includes its own diagonal, as the rows are
+    // only swapped where each has an entry in the other's column)
+    if(scaled.rows() != size || order != pattern_order) {
+        std::vector<std::vector<unsigned int>> pattern(size);
+        for(unsigned int row = 0; row < size; row += 1) {
+            pattern[row].assign(columns.begin() + starts[order[row]],
+                    columns.begin() + starts[order[row] + 1]);
+        }
+        scaled.set_pattern(pattern);
+        pattern_order = order;
+    }
+
+    row_scales.assign(size, 0);
+    column_scales.assign(size, 0);
+    if(method == CONJUGATE_GRADIENT) {
+        for(unsigned int row = 0; row < size; row += 1) {
+            row_scales[row] = 1 / std::sqrt(values[diagonals[row]]);
+            column_scales[row] = row_scales[row];
+        }
+    }
+
+    // Otherwise, scale each row by its largest entry, then each column by its
+    // largest once the rows are scaled (the row scales being in the scaled
+    // matrix's order)
+    else {
+        for(unsigned int row = 0; row < size; row += 1) {
+            const unsigned int original = order[row];
+            for(unsigned int index = starts[original];
+                    index < starts[original + 1]; index += 1) {
+
+                row_scales[row] = std::max(row_scales[row],
+                        std::fabs(values[index]));
+            }
+            if(row_scales[row] == 0)
+                return false;
+            row_scales[row] = 1 / row_scales[row];
+        }
+
+        for(unsigned int row = 0; row < size; row += 1) {
+            const unsigned int original = order[row];
+            for(unsigned int index = starts[original];
+                    index < starts[original + 1]; index += 1) {
+
+                auto &scale = column_scales[columns[index]];
+                scale = std::max(scale, std::fabs(values[index]) *
+                        row_scales[row]);
+            }
+        }
+
+        for(auto &scale : column_scales) {
+            if(scale == 0)
+                return false;
+            scale = 1 / scale;
+        }
+    }
+
+    auto &scaled_values = scaled.get_values();
+    const auto &scaled_starts = scaled.get_starts();
+    for(unsigned int row = 0; row < size; row += 1) {
+        const unsigned int original = order[row];
+        const unsigned int offset = scaled_starts[row] - starts[original];
+        for(unsigned int index = starts[original];
+                index < starts[original + 1]; index += 1) {
+
+            scaled_values[index + offset] = row_scales[row] * values[index] *
+                    column_scales[columns[index]];
+        }
+    }
+    return true;
+}
+
+// Finds the ILU(0) factors of the scaled matrix. Returns false if a pivot's
+// negligible next to the rest of its row (or, for the conjugate gradient
+// method, not positive), or the factors aren't finite
+bool IterativeSolver::factorize_incomplete() {
+    const unsigned int size = scaled.rows();
+    const auto &starts = scaled.get_starts();
+    const auto &columns = scaled.get_columns();
+    const auto &diagonals = scaled.get_diagonals();
+    factors = scaled.get_values();
+    positions.assign(size, none);
+
+    for(unsigned int row = 0; row < size; row += 1) {
+        double largest = 0;
+        for(unsigned int index = starts[row]; index < starts[row + 1];
+                index += 1) {
+
+            positions[columns[index]] = index;
+            largest = std::max(largest, std::fabs(factors[index]));
+        }
+
+        // Eliminate each column left of the diagonal, in order, updating only
+        // the entries the row already has
+        for(unsigned int index = starts[row]; index < diagonals[row];
+                index += 1) {
+
+            const unsigned int column = columns[index];
+            factors[index] /= factors[diagonals[column]];
+            const double multiplier = factors[index];
+            if(multiplier == 0)
+                continue;
+
+            for(unsigned int other = diagonals[column] + 1;
+                    other < starts[column + 1]; other += 1) {
+
+                const unsigned int position = positions[columns[other]];
+                if(position != none)
+                    factors[position] -= multiplier * factors[other];
+            }
+        }
+
+        for(unsigned int index = starts[row]; index < starts[row + 1];
+                index += 1) {
+
+            positions[columns[index]] = none;
+        }
+
+        // A pivot that's only rounding error would make the preconditioner
+        // numerically singular, and GMRES's estimate of its residual
+        // meaningless
+        const double pivot = factors[diagonals[row]];
+        if(std::isfinite(pivot) == false ||
+                std::fabs(pivot) <= pivot_threshold * largest ||
+                (method == CONJUGATE_GRADIENT && pivot < 0)) {
+
+            return false;
+        }
+    }
+
+    for(const auto &factor : factors) {
+        if(std::isfinite(factor) == false)
+            return false;
+    }
+    return true;
+}
+
+// Applies the preconditioner's inverse to a vector
+void IterativeSolver::precondition(const std::vector<double> &values,
+        std::vector<double> &result) const {
+
+    const unsigned int size = scaled.rows();
+    const auto &starts = scaled.get_starts();
+    const auto &columns = scaled.get_columns();
+    const auto &diagonals = scaled.get_diagonals();
+
+    if(preconditioner == JACOBI) {
+        const auto &scaled_values = scaled.get_values();
+        for(unsigned int row = 0; row < size; row += 1) {
+            const double diagonal = scaled_values[diagonals[row]];
+            result[row] = diagonal != 0 ? values[row] / diagonal :
+                    values[row];
+        }
+        return;
+    }
+
+    // Forward substitution through the unit lower triangle, then back
+    // substitution through the upper
+    for(unsigned int row = 0; row < size; row += 1) {
+        double sum = values[row];
+        for(unsigned int index = starts[row]; index < diagonals[row];
+                index += 1) {
+
+            sum -= factors[index] * result[columns[index]];
+        }
+        result[row] = sum;
+    }
+
+    for(unsigned int row = size; row-- > 0;) {
+        double sum = result[row];
+        for(unsigned int index = diagonals[row] + 1; index < starts[row + 1];
+                index += 1) {
+
+            sum -= factors[index] * result[columns[index]];
+        }
+        result[row] = sum / factors[diagonals[row]];
+    }
+}
+
+// Solves the prepared system for a right-hand side, starting from (and
+// replacing) the solution given. Returns false if it didn't converge
+bool IterativeSolver::solve(const double *constants, double *solution) {
+    iterations = 0;
+    if(prepared == false)
+        return false;
+
+    // Move to the scaled system: the scaled constants are R b (in the scaled
+    // matrix's order), and the scaled solution's first guess C^-1 x
+    const unsigned int size = scaled.rows();
+    for(unsigned int index = 0; index < size; index += 1) {
+        this->constants[index] = row_scales[index] * constants[order[index]];
+        this->solution[index] = solution[index] / column_scales[index];
+    }
+
+    const double target = tolerance * std::sqrt(dot(this->constants,
+            this->constants));
+    bool converged;
+    if(target == 0) {
+        std::fill(this->solution.begin(), this->solution.end(), 0);
+        converged = true;
+    }
+
+    // A symmetric system that turns out not to be positive definite is
+    // solved as a general one, from then on
+    else if(method == CONJUGATE_GRADIENT) {
+        converged = solve_conjugate_gradient(target);
+        if(converged == false && method == GMRES) {
+            size_gmres();
+            converged = solve_gmres(target);
+        }
+    }
+    else
+        converged = solve_gmres(target);
+
+    for(unsigned int index = 0; index < size; index += 1)
+        solution[index] = this->solution[index] * column_scales[index];
+    return converged;
+}
+
+// Solves the scaled system by the preconditioned conjugate gradient method,
+// until the residual's norm is within the target. Returns false if it didn't
+// converge, switching the method to GMRES if the matrix proved not to be
+// positive definite
+bool IterativeSolver::solve_conjugate_gradient(const double &target) {
+    const unsigned int size = scaled.rows();
+    const unsigned int limit = std::max(minimum_iteration_limit, 2 * size);
+
+    scaled.multiply(solution.data(), product.data());
+    for(unsigned int index = 0; index < size; index += 1)
+        residual[index] = constants[index] - product[index];
+    if(std::sqrt(dot(residual, residual)) <= target)
+        return true;
+
+    precondition(residual, preconditioned);
+    direction = preconditioned;
+    double alignment = dot(residual, preconditioned);
+
+    while(iterations < limit) {
+        scaled.multiply(direction.data(), product.data());
+        const double curvature = dot(direction, product);
+        if(curvature <= 0 || std::isfinite(curvature) == false) {
+            method = GMRES;
+            return false;
+        }
+
+        const double step = alignment / curvature;
+        for(unsigned int index = 0; index < size; index += 1) {
+            solution[index] += step * direction[index];
+            residual[index] -= step * product[index];
+        }
+        iterations += 1;
+
+        if(std::sqrt(dot(residual, residual)) <= target)
+            return true;
+
+        precondition(residual, preconditioned);
+        const double next_alignment = dot(residual, preconditioned);
+        const double factor = next_alignment / alignment;
+        alignment = next_alignment;
+        for(unsigned int index = 0; index < size; index += 1) {
+            direction[index] = preconditioned[index] + factor *
+                    direction[index];
+        }
+    }
+
+    return false;
+}
+
+// Sizes GMRES's storage for the scaled system (which, for a system of the
+// same size, allocates nothing)
+void IterativeSolver::size_gmres() {
+    const unsigned int size = scaled.rows();
+    const unsigned int length = std::min(restart_length, size);
+    basis.resize((length + 1) * size);
+    hessenberg.resize((length + 1) * length);
+    cosines.resize(length);
+    sines.resize(length);
+    rotated.resize(length + 1);
+    coefficients.resize(length);
+}
+
+// Solves the scaled system by GMRES, preconditioned on the right, until the
+// residual's norm is within the target: each cycle builds an orthonormal basis
+// of the Krylov space of the residual (by the Arnoldi process), up to the
+// restart length, and moves the solution by the combination of it that
+// leaves the least residual. Returns false if it didn't converge
+bool IterativeSolver::solve_gmres(const double &target) {
+    const unsigned int size = scaled.rows();
+    const unsigned int limit = std::max(minimum_iteration_limit, 2 * size);
+    const unsigned int length = cosines.size();
+
+    while(true) {
+        scaled.multiply(solution.data(), product.data());
+        for(unsigned int index = 0; index < size; index += 1)
+            residual[index] = constants[index] - product[index];
+
+        const double norm = std::sqrt(dot(residual, residual));
+        if(norm <= target)
+            return true;
+        if(iterations >= limit || std::isfinite(norm) == false)
+            return false;
+
+        std::fill(rotated.begin(), rotated.end(), 0);
+        rotated[0] = norm;
+        for(unsigned int index = 0; index < size; index += 1)
+            basis[index] = residual[index] / norm;
+
+        unsigned int count = 0;
+        while(count < length && iterations < limit) {
+            double *vector = basis.data() + count * size;
+            std::copy(vector, vector + size, direction.begin());
+            precondition(direction, preconditioned);
+            scaled.multiply(preconditioned.data(), product.data());
+
+            // Orthogonalize the product against the basis so far (by modified
+            // Gram-Schmidt), giving the Hessenberg matrix's next column
+            for(unsigned int row = 0; row <= count; row += 1) {
+                const double *other = basis.data() + row * size;
+                double projection = 0;
+                for(unsigned int index = 0; index < size; index += 1)
+                    projection += product[index] * other[index];
+                for(unsigned int index = 0; index < size; index += 1)
+                    product[index] -= projection * other[index];
+                hessenberg[row * length + count] = projection;
+            }
+
+            const double remaining = std::sqrt(dot(product, product));
+            if(remaining != 0) {
+                double *next = basis.data() + (count + 1) * size;
+                for(unsigned int index = 0; index < size; index += 1)
+                    next[index] = product[index] / remaining;
+            }
+
+            // Apply the earlier rotations to the column, then find the one
+            // that clears the entry below its diagonal
+            for(unsigned int row = 0; row < count; row += 1) {
+                double &upper = hessenberg[row * length + count];
+                double &lower = hessenberg[(row + 1) * length + count];
+                const double value = upper;
+                upper = cosines[row] * value + sines[row] * lower;
+                lower = cosines[row] * lower - sines[row] * value;
+            }
+
+            double &diagonal = hessenberg[count * length + count];
+            const double hypotenuse = std::hypot(diagonal, remaining);
+            if(hypotenuse == 0 || std::isfinite(hypotenuse) == false)
+                return false;
+
+            cosines[count] = diagonal / hypotenuse;
+            sines[count] = remaining / hypotenuse;
+            diagonal = hypotenuse;
+            rotated[count + 1] = -sines[count] * rotated[count];
+            rotated[count] *= cosines[count];
+
+            count += 1;
+            iterations += 1;
+            if(std::fabs(rotated[count]) <= target || remaining == 0)
+                break;
+        }
+
+        // Back substitute for the coefficients, then move the solution by
+        // the preconditioned combination of the basis
+        for(unsigned int row = count; row-- > 0;) {
+            double sum = rotated[row];
+            for(unsigned int column = row + 1; column < count; column += 1) {
+                sum -= hessenberg[row * length + column] *
+                        coefficients[column];
+            }
+            coefficients[row] = sum / hessenberg[row * length + row];
+        }
+
+        std::fill(direction.begin(), direction.end(), 0);
+        for(unsigned int row = 0; row < count; row += 1) {
+            const double *vector = basis.data() + row * size;
+            for(unsigned int index = 0; index < size; index += 1)
+                direction[index] += coefficients[row] * vector[index];
+        }
+        precondition(direction, preconditioned);
+        for(unsigned int index = 0; index < size; index += 1)
+            solution[index] += preconditioned[index];
+    }
+}
+
+// Returns the number of iterations the last solve took
+unsigned int IterativeSolver::get_iterations() const {
+    return iterations;
+}
+
+// Returns the number of times a changed matrix has been prepared for
+unsigned int IterativeSolver::get_preparations() const {
+    return preparations;
+}
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "../utilities/graph.hpp"
+#include "../utilities/kernels.hpp"
+#include "../utilities/matrix.hpp"
+#include "../utilities/profiler.hpp"
+#include "factorization.hpp"
+
+/* ******************************************************************** Synopsis
+
+Solves a large system by splitting its unknowns into partitions, which can be
+worked on in parallel, and a separator, which couples them. With the unknowns
+ordered partition by partition, then separator, the system takes the form
+
+    [A_11            A_1S] [x_1]   [b_1]
+    [      ...       ... ] [...] = [...]
+    [           A_KK A_KS] [x_K]   [b_K]
+    [A_S1  ...  A_SK A_SS] [x_S]   [b_S]
+
+where no partition's interior is coupled to another's. Each interior A_kk is
+factorized on a thread of its own, and used to eliminate its partition from
+the separator's equations, leaving the (much smaller) Schur complement
+
+    S = A_SS - sum of A_Sk A_kk^-1 A_kS
+
+to be solved for x_S; after which each partition's unknowns are recovered
+(again in parallel) as x_k = A_kk^-1 (b_k - A_kS x_S).
+
+The partitions are found from the graph of the system's non-zero entries: the
+unknowns are ordered breadth-first (from an unknown at one 'end' of the graph,
+so the order sweeps across it), and the order is cut into K equal bands. Any
+unknown coupled to an unknown in an earlier band goes into the separator, so
+the bands' interiors are never coupled directly. Unknowns with nothing on
+their diagonals (like voltage sources' branch currents) are also moved into
+the separator when they're coupled to it, since their interior block would
+otherwise be singular.
+
+Since the conductances of a circuit rarely change between time steps, the
+factorizations are kept, and only redone when the system's matrix changes; a
+time step then costs only the substitutions. These work in buffers kept from
+one solve to the next, and are only spread over threads when the partitions
+are large enough to repay starting them, so a step with small partitions
+allocates nothing.
+
+*/
+
+class PartitionedSolver {
+
+private:
+
+    struct Partition {
+        std::vector<unsigned int> interior;
+        Factorization factorization;
+
+        // A_kk^-1 A_kS, with a row for each interior unknown and a column for
+        // each separator unknown
+        std::vector<double> coupling;
+
+        // A_Sk A_kk^-1 A_kS, the partition's share of the Schur complement
+        std::vector<double> reduction;
+
+        // The partition's share of the separator's right-hand side, and the
+        // values of its interior unknowns
+        std::vector<double> constants;
+        std::vector<double> values;
+
+        bool factorized;
+    };
+
+    // Partitions smaller than this aren't worth a thread of their own
+    static const unsigned int minimum_partition_size = 4;
+
+    // Substitutions with fewer multiplications than this (in the largest
+    // partition) are quicker done in turn than by starting threads for them
+    static const unsigned int minimum_parallel_work = 1 << 16;
+
+    unsigned int partition_count;
+    bool usable;
+
+    std::vector<Partition> partitions;
+    std::vector<unsigned int> separator;
+    std::vector<double> separator_values;
+
+    // Whether the substitutions are spread over threads
+    bool parallel_solves;
+
+    Matrix factorized;
+    Factorization complement;
+
+    bool partition(const Matrix &conductances);
+    bool factorize(const Matrix &conductances);
+
+    void factorize_partition(Partition &partition, const Matrix &conductances);
+
+    template <typename Function>
+    void for_each_partition(const Function &function, const bool &parallel);
+
+public:
+
+    PartitionedSolver(const unsigned int &partition_count);
+
+    bool solve(const Matrix &conductances, const Matrix &constants,
+            Matrix &result);
+
+};
+
+const unsigned int PartitionedSolver::minimum_partition_size;
+const unsigned int PartitionedSolver::minimum_parallel_work;
+
+PartitionedSolver::PartitionedSolver(const unsigned int &partition_count) {
+    this->partition_count = partition_count;
+    usable = partition_count > 1;
+    parallel_solves = false;
+}
+
+// Runs a function on each partition, each on its own thread (the first on
+// this one) if asked to, or else on this thread in turn
+template <typename Function>
+void PartitionedSolver::for_each_partition(const Function &function,
+        const bool &parallel) {
+
+    if(parallel == false) {
+        for(auto &partition : partitions)
+            function(partition);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for(unsigned int index = 1; index < partitions.size(); index += 1)
+        threads.emplace_back(function, std::ref(partitions[index]));
+
+    function(partitions[0]);
+    for(auto &thread : threads)
+        thread.join();
+}
+
+// Splits the system's unknowns into partitions and a separator. Returns false
+// if the system's too small, or too tightly coupled, to be worth it
+bool PartitionedSolver::partition(const Matrix &conductances) {
+    const unsigned int size = conductances.rows();
+    if(size < partition_count * minimum_partition_size)
+        return false;
+
+    std::vector<std::vector<unsigned int>> neighbours(size);
+    for(unsigned int row = 0; row < size; row += 1) {
+        for(unsigned int column = row + 1; column < size; column += 1) {
+            if(conductances(row, column) != 0 ||
+                    conductances(column, row) != 0) {
+
+                neighbours[row].push_back(column);
+                neighbours[column].push_back(row);
+            }
+        }
+    }
+
+    // Order the unknowns from the far end of the graph from the first, and
+    // cut the order into bands
+    const auto order = order_across(neighbours);
+
+    std::vector<unsigned int> bands(size);
+    for(unsigned int position = 0; position < size; position += 1)
+        bands[order[position]] = position * partition_count / size;
+
+    std::vector<bool> separated(size, false);
+    for(unsigned int unknown = 0; unknown < size; unknown += 1) {
+        for(const auto &neighbour : neighbours[unknown]) {
+            if(bands[neighbour] < bands[unknown])
+                separated[unknown] = true;
+        }
+    }
+
+    // Unknowns with empty diagonals follow their neighbours into the
+    // separator (which may pull others in after them)
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(unsigned int unknown = 0; unknown < size; unknown += 1) {
+            if(separated[unknown] || conductances(unknown, unknown) != 0)
+                continue;
+
+            for(const auto &neighbour : neighbours[unknown]) {
+                if(separated[neighbour]) {
+                    separated[unknown] = true;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    partitions.assign(partition_count, Partition());
+    separator.clear();
+    for(unsigned int unknown = 0; unknown < size; unknown += 1) {
+        if(separated[unknown])
+            separator.push_back(unknown);
+        else
+            partitions[bands[unknown]].interior.push_back(unknown);
+    }
+
+    // Size the substitutions' buffers, and judge whether they're worth
+    // threads
+    separator_values.resize(separator.size());
+    unsigned int work = 0;
+    for(auto &partition : partitions) {
+        const unsigned int interior_size = partition.interior.size();
+        partition.values.resize(interior_size);
+        partition.constants.resize(separator.size());
+        work = std::max(work, interior_size * (interior_size +
+                2 * (unsigned int)separator.size()));
+    }
+    parallel_solves = work >= minimum_parallel_work;
+
+    return separator.size() * 2 <= size;
+}
+
+// Factorizes a partition's interior, and eliminates it from the separator's
+// equations
+void PartitionedSolver::factorize_partition(Partition &partition,
+        const Matrix &conductances) {
+
+    const auto &interior = partition.interior;
+    const unsigned int size = interior.size();
+    const unsigned int separator_size = separator.size();
+
+    std::vector<double> values(size * size);
+    for(unsigned int row = 0; row < size; row += 1) {
+        for(unsigned int column = 0; column < size; column += 1) {
+            values[row * size + column] = conductances(interior[row],
+                    interior[column]);
+        }
+    }
+
+    partition.factorized = partition.factorization.factorize(values, size);
+    if(partition.factorized == false)
+        return;
+
+    // Solve for all of the separator's columns of A_kS at once
+    partition.coupling.resize(size * separator_size);
+    for(unsigned int row = 0; row < size; row += 1) {
+        for(unsigned int index = 0; index < separator_size; index += 1) {
+            partition.coupling[row * separator_size + index] = conductances(
+                    interior[row], separator[index]);
+        }
+    }
+    partition.factorization.solve(partition.coupling.data(), separator_size);
+
+    // Multiply A_Sk by the solutions
+    std::vector<double> separator_rows(separator_size * size);
+    for(unsigned int row = 0; row < separator_size; row += 1) {
+        for(unsigned int index = 0; index < size; index += 1) {
+            separator_rows[row * size + index] = conductances(separator[row],
+                    interior[index]);
+        }
+    }
+
+    partition.reduction.assign(separator_size * separator_size, 0);
+    add_product(separator_size, separator_size, size, separator_rows.data(),
+            size, partition.coupling.data(), separator_size,
+            partition.reduction.data(), separator_size, 1);
+}
+
+// Factorizes each partition's interior, and the Schur complement left once
+// they've been eliminated. Returns false if any of them are singular
+bool PartitionedSolver::factorize(const Matrix &conductances) {
+    for_each_partition([&](Partition &partition) {
+        factorize_partition(partition, conductances);
+    }, true);
+
+    const unsigned int separator_size = separator.size();
+    std::vector<double> values(separator_size * separator_size);
+    for(unsigned int row = 0; row < separator_size; row += 1) {
+        for(unsigned int column = 0; column < separator_size; column += 1) {
+            values[row * separator_size + column] = conductances(
+                    separator[row], separator[column]);
+        }
+    }
+
+    for(const auto &partition : partitions) {
+        if(partition.factorized == false)
+            return false;
+
+        for(unsigned int index = 0; index < values.size(); index += 1)
+            values[index] -= partition.reduction[index];
+    }
+
+    return complement.factorize(values, separator_size);
+}
+
+// Solves the system given, placing the solution into 'result'. Returns false
+// if the system can't be partitioned usefully (or its partitions turn out to
+// be singular), in which case it should be solved some other way
+bool PartitionedSolver::solve(const Matrix &conductances,
+        const Matrix &constants, Matrix &result) {
+
+    if(usable == false)
+        return false;
+
+    if(partitions.empty() && partition(conductances) == false) {
+        usable = false;
+        return false;
+    }
+
+    if(conductances != factorized) {
+        Profiler::Scope scope("factorize");
+        if(factorize(conductances) == false) {
+            usable = false;
+            return false;
+        }
+        factorized = conductances;
+    }
+
+    // Solve each interior for its own constants, and find its contribution to
+    // the separator's right-hand side
+    const unsigned int separator_size = separator.size();
+    for_each_partition([&](Partition &partition) {
+        const auto &interior = partition.interior;
+        for(unsigned int index = 0; index < interior.size(); index += 1)
+            partition.values[index] = constants(interior[index], 0);
+        partition.factorization.solve(partition.values.data());
+
+        std::fill(partition.constants.begin(), partition.constants.end(), 0);
+        for(unsigned int row = 0; row < separator_size; row += 1) {
+            for(unsigned int index = 0; index < interior.size(); index += 1) {
+                partition.constants[row] += conductances(separator[row],
+                        interior[index]) * partition.values[index];
+            }
+        }
+    }, parallel_solves);
+
+    // Solve the separator
+    for(unsigned int index = 0; index < separator_size; index += 1) {
+        separator_values[index] = constants(separator[index], 0);
+        for(const auto &partition : partitions)
+            separator_values[index] -= partition.constants[index];
+    }
+    complement.solve(separator_values.data());
+
+    // Substitute the separator's values back into each partition
+    for_each_partition([&](Partition &partition) {
+        for(unsigned int index = 0; index < partition.interior.size();
+                index += 1) {
+
+            const double *coupling = partition.coupling.data() + index *
+                    separator_size;
+            for(unsigned int column = 0; column < separator_size;
+                    column += 1) {
+
+                partition.values[index] -= coupling[column] *
+                        separator_values[column];
+            }
+        }
+    }, parallel_solves);
+
+    // The result's only created on the first solve (or if the system's size
+    // changes)
+    if(result.rows() != conductances.rows() || result.columns() != 1)
+        result = Matrix(1, conductances.rows());
+    for(const auto &partition : partitions) {
+        for(unsigned int index = 0; index < partition.interior.size();
+                index += 1) {
+
+            result(partition.interior[index], 0) = partition.values[index];
+        }
+    }
+    for(unsigned int index = 0; index < separator_size; index += 1)
+        result(separator[index], 0) = separator_values[index];
+
+    return true;
+}
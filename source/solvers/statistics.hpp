@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../utilities/matrix.hpp"
+#include "../utilities/sparse.hpp"
+#include "factorization.hpp"
+#include "iterative.hpp"
+
+/* ******************************************************************** Synopsis
+
+Statistics of the systems a transient run solves, for telling why a run's slow
+or wrong (or choosing the solver settings that suit a kind of circuit).
+
+Each block's system is analyzed whenever its matrix changes, which for most
+circuits is only on the first step: its size, its number of non-zero entries,
+and, from an LU factorization of it, the fill-in (the factors' non-zeros that
+the matrix didn't have), the pivot growth (the factors' largest entry over the
+matrix's), and an estimate of its 1-norm condition number. Steps whose matrix
+is unchanged are counted as reuses; a solver that keeps its factorization
+(like the partitioned solver) only refactorizes on the others.
+
+A system solved iteratively is never factorized, and only its size and
+non-zeros are recorded, with the number of times its preconditioner was found
+(as its factorizations) and the iterations its solves took in all.
+
+The run's totals are counted alongside: its time steps, and the steps where a
+block had no solution.
+
+*/
+
+class SolverStatistics {
+
+public:
+
+    // What's known of one block's system
+    struct Block {
+        unsigned int nodes;
+        unsigned int unknowns;
+        unsigned int solved_unknowns;
+        unsigned int nonzeros;
+        unsigned int factor_nonzeros;
+        double pivot_growth;
+        double condition;
+
+        unsigned int analyses;
+        unsigned int reuses;
+        unsigned int failures;
+        unsigned int iterations;
+
+        std::string solver;
+
+        // The matrix last analyzed, to tell whether the next has changed
+        Matrix matrix;
+    };
+
+    std::vector<Block> blocks;
+
+    unsigned int time_steps;
+    unsigned int rejected_steps;
+    unsigned int newton_iterations;
+
+    SolverStatistics();
+
+    void reset(const unsigned int &block_count);
+    void record(Block &block, const Matrix &conductances);
+    void record(Block &block, const SparseMatrix &conductances,
+            const IterativeSolver &solver);
+
+    void write(std::ostream &stream) const;
+
+};
+
+SolverStatistics::SolverStatistics() {
+    reset(0);
+}
+
+// Clears the statistics, for a run with the number of blocks given
+void SolverStatistics::reset(const unsigned int &block_count) {
+    blocks.assign(block_count, Block());
+    for(auto &block : blocks) {
+        block.nodes = 0;
+        block.unknowns = 0;
+        block.solved_unknowns = 0;
+        block.nonzeros = 0;
+        block.factor_nonzeros = 0;
+        block.pivot_growth = 0;
+        block.condition = 0;
+        block.analyses = 0;
+        block.reuses = 0;
+        block.failures = 0;
+        block.iterations = 0;
+    }
+
+    time_steps = 0;
+    rejected_steps = 0;
+    newton_iterations = 0;
+}
+
+// Records a step's solve of a block's system, analyzing the system if it's
+// changed since the last
+void SolverStatistics::record(Block &block, const Matrix &conductances) {
+    if(block.analyses > 0 && conductances == block.matrix) {
+        block.reuses += 1;
+        return;
+    }
+
+    block.matrix = conductances;
+    block.analyses += 1;
+
+    const unsigned int size = conductances.rows();
+    std::vector<double> values(size * size);
+    double largest = 0;
+    double norm = 0;
+    block.solved_unknowns = size;
+    block.nonzeros = 0;
+    for(unsigned int column = 0; column < size; column += 1) {
+        double column_sum = 0;
+        for(unsigned int row = 0; row < size; row += 1) {
+            const double value = conductances(row, column);
+            values[row * size + column] = value;
+            if(value != 0)
+                block.nonzeros += 1;
+
+            largest = std::max(largest, std::fabs(value));
+            column_sum += std::fabs(value);
+        }
+        norm = std::max(norm, column_sum);
+    }
+
+    // A singular system has no factors to measure, and an infinite condition
+    Factorization factorization;
+    if(factorization.factorize(values, size) == false) {
+        block.factor_nonzeros = 0;
+        block.pivot_growth = 0;
+        block.condition = INFINITY;
+        return;
+    }
+
+    block.factor_nonzeros = factorization.get_nonzero_count();
+    block.pivot_growth = std::max(block.pivot_growth, largest > 0 ?
+            factorization.get_largest_factor() / largest : 0);
+    block.condition = std::max(block.condition, norm *
+            factorization.estimate_inverse_norm());
+}
+
+// Records a step's iterative solve of a block's system
+void SolverStatistics::record(Block &block, const SparseMatrix &conductances,
+        const IterativeSolver &solver) {
+
+    block.iterations += solver.get_iterations();
+    if(solver.get_preparations() == block.analyses) {
+        block.reuses += 1;
+        return;
+    }
+
+    block.analyses = solver.get_preparations();
+    block.solved_unknowns = conductances.rows();
+    block.nonzeros = 0;
+    for(const auto &value : conductances.get_values()) {
+        if(value != 0)
+            block.nonzeros += 1;
+    }
+
+    // ILU(0) has no fill-in, and the condition isn't estimated
+    block.factor_nonzeros = block.nonzeros;
+    block.condition = NAN;
+}
+
+// Writes the statistics as a JSON object
+void SolverStatistics::write(std::ostream &stream) const {
+
+    // JSON has no infinity, so a singular system's condition is null
+    const auto number = [&](const double &value) -> std::ostream & {
+        if(std::isfinite(value))
+            stream << value;
+        else
+            stream << "null";
+        return stream;
+    };
+
+    stream << "{\n";
+    stream << "  \"time_steps\": " << time_steps << ",\n";
+    stream << "  \"rejected_steps\": " << rejected_steps << ",\n";
+    stream << "  \"newton_iterations\": " << newton_iterations << ",\n";
+    stream << "  \"blocks\": [";
+    for(unsigned int index = 0; index < blocks.size(); index += 1) {
+        const auto &block = blocks[index];
+        const unsigned int fill_in = block.factor_nonzeros > block.nonzeros ?
+                block.factor_nonzeros - block.nonzeros : 0;
+
+        stream << (index ? ",\n" : "\n") << "    {";
+        stream << "\"nodes\": " << block.nodes << ", ";
+        stream << "\"unknowns\": " << block.unknowns << ", ";
+        stream << "\"solved_unknowns\": " << block.solved_unknowns << ", ";
+        stream << "\"nonzeros\": " << block.nonzeros << ", ";
+        stream << "\"factor_nonzeros\": " << block.factor_nonzeros << ", ";
+        stream << "\"fill_in\": " << fill_in << ", ";
+        stream << "\"pivot_growth\": ";
+        number(block.pivot_growth) << ", ";
+        stream << "\"condition_estimate\": ";
+        number(block.condition) << ", ";
+        stream << "\"solver\": \"" << block.solver << "\", ";
+        stream << "\"factorizations\": " << block.analyses << ", ";
+        stream << "\"reuses\": " << block.reuses << ", ";
+        stream << "\"iterations\": " << block.iterations << ", ";
+        stream << "\"failures\": " << block.failures << "}";
+    }
+    stream << (blocks.empty() ? "" : "\n  ") << "]\n";
+    stream << "}\n";
+}
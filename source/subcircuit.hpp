@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "components/templates/component.hpp"
+#include "schematic.hpp"
+#include "utilities/text_buffer.hpp"
+
+/* ******************************************************************** Synopsis
+
+A subcircuit is a template, parsed once from its .subckt/.ends block. Rather
+than the text of its body, it holds the components it contains (already
+parsed), with each of their terminals resolved to a 'slot' in the
+subcircuit's table of local nodes (found through a map from name to slot
+while it's parsed). The first slots are its ports, in the order they were
+declared; the rest are its internal nodes.
+
+Instantiating a subcircuit is then a matter of building a table mapping each
+slot to a node ID in the schematic: ports map to the IDs of the nodes the
+instance was connected to, and each internal node is interned once, under a
+name prefixed by the instance's path (as in "X1.mid"). Each component is
+copied with its node IDs looked up in that table, and added without its node
+names being interned again. Nested instances are flattened the same way,
+recursively, their ports looked up in the enclosing instance's table. Each
+entry is filled when it's first used, so nodes are numbered in the order
+they're met, as they would be in a flat netlist.
+
+*/
+
+class Subcircuit {
+
+public:
+
+    // A subcircuit instance, as declared on an 'X' line
+    struct Instance {
+        std::string name;
+        std::vector<std::string> node_names;
+        std::string definition;
+
+        static bool parse(TextBuffer &buffer, Instance &instance);
+    };
+
+    // Slot used for the ground node, which is never renamed
+    static const unsigned int ground = std::numeric_limits<unsigned int>::max();
+
+    // Nesting limit (beyond which a definition is assumed to instantiate
+    // itself)
+    static const unsigned int maximum_depth = 64;
+
+    std::string name;
+
+    unsigned int port_count;
+
+    static std::shared_ptr<Subcircuit> parse(TextBuffer &buffer);
+
+    Subcircuit();
+
+    void add_component(Component *component);
+    void add_instance(const Instance &instance);
+
+    bool instantiate(const Instance &instance,
+            const std::map<std::string, std::shared_ptr<Subcircuit>>
+                &definitions,
+            Schematic &schematic, Arena &arena, const unsigned int depth)
+            const;
+
+private:
+
+    // A nested instance, with its nodes resolved to slots
+    struct Nested {
+        std::string name;
+        std::string definition;
+        std::vector<unsigned int> slots;
+    };
+
+    std::vector<std::string> node_names;
+    std::unordered_map<std::string, unsigned int> slots;
+
+    // Template components, owned by the simulation's arena
+    std::vector<Component *> components;
+    std::vector<std::array<unsigned int, 2>> component_slots;
+
+    std::vector<Nested> instances;
+
+    // The node IDs of an instance's slots, each found when it's first used:
+    // a port's through the scope the instance is in (or interned from the
+    // names on its 'X' line, at the top level), and an internal node's by
+    // interning its name under the instance's path
+    struct Scope {
+        const Subcircuit *definition;
+        std::string path;
+        std::vector<unsigned int> ids;
+
+        Scope *parent;
+        const std::vector<unsigned int> *port_slots;
+        const std::vector<std::string> *port_names;
+
+        unsigned int get_id(const unsigned int &slot, Schematic &schematic);
+    };
+
+    unsigned int get_slot(const std::string &node);
+
+    bool instantiate(Scope &scope,
+            const std::map<std::string, std::shared_ptr<Subcircuit>>
+                &definitions,
+            Schematic &schematic, Arena &arena, const unsigned int depth)
+            const;
+
+};
+
+// Parses an instance definition of the form 'Xname node node ... definition'
+bool Subcircuit::Instance::parse(TextBuffer &buffer, Instance &instance) {
+    if(buffer.get_character() != 'X') {
+        std::cerr << "Parse logic error; expected a subcircuit instance, but "
+                "encountered the component symbol '" <<
+                buffer.get_character() << "'" << std::endl;
+        return false;
+    }
+
+    instance.name = buffer.get_string(true);
+
+    // Each field up until the end of the line is a node, besides the last,
+    // which names the definition
+    std::vector<std::string> fields;
+    while(true) {
+        buffer.skip_whitespace();
+        if(buffer.end_reached() || buffer.get_character() == '\n')
+            break;
+
+        fields.push_back(buffer.get_string(true));
+    }
+
+    if(fields.empty()) {
+        std::cerr << "Subcircuit instance '" << instance.name << "' doesn't "
+                "name a definition" << std::endl;
+        return false;
+    }
+
+    instance.definition = fields.back();
+    fields.pop_back();
+    instance.node_names = fields;
+    return true;
+}
+
+Subcircuit::Subcircuit() {
+    port_count = 0;
+}
+
+// Parses the header of a subcircuit definition, of the form '.subckt name
+// port port ...'. The components in its body are added by the caller
+std::shared_ptr<Subcircuit> Subcircuit::parse(TextBuffer &buffer) {
+    auto subcircuit = std::shared_ptr<Subcircuit>(new Subcircuit());
+
+    // Check the function hasn't been called in error
+    if(buffer.skip_string(".subckt") == false) {
+        std::cerr << "Subcircuit parse function called when definition is not "
+                "that of a subcircuit" << std::endl;
+        return nullptr;
+    }
+
+    buffer.skip_whitespace();
+    subcircuit->name = buffer.get_string(true);
+    if(subcircuit->name.empty()) {
+        std::cerr << "Subcircuit definition has no name" << std::endl;
+        return nullptr;
+    }
+
+    // The remaining fields on the line are the subcircuit's ports
+    while(true) {
+        buffer.skip_whitespace();
+        if(buffer.end_reached() || buffer.get_character() == '\n')
+            break;
+
+        const auto port = buffer.get_string(true);
+        if(port == "0") {
+            std::cerr << "Ground can't be a port of subcircuit '" <<
+                    subcircuit->name << "'" << std::endl;
+            return nullptr;
+        }
+
+        if(subcircuit->get_slot(port) != subcircuit->port_count) {
+            std::cerr << "Port '" << port << "' of subcircuit '" <<
+                    subcircuit->name << "' is declared twice" << std::endl;
+            return nullptr;
+        }
+        subcircuit->port_count += 1;
+    }
+
+    return subcircuit;
+}
+
+// Gets (or creates) the slot of a node local to this subcircuit
+unsigned int Subcircuit::get_slot(const std::string &node) {
+    if(node == "0")
+        return ground;
+
+    const auto match = slots.emplace(node, node_names.size());
+    if(match.second)
+        node_names.push_back(node);
+    return match.first->second;
+}
+
+// Adds a component to the subcircuit's template, resolving its terminals to
+// slots (its node names aren't needed after, so they're cleared, and aren't
+// copied with it)
+void Subcircuit::add_component(Component *component) {
+    if(component == nullptr)
+        return;
+
+    std::array<unsigned int, 2> terminals;
+    for(unsigned int terminal = 0; terminal < terminals.size();
+            terminal += 1) {
+
+        terminals[terminal] = get_slot(component->node_names[terminal]);
+        component->node_names[terminal].clear();
+    }
+
+    components.push_back(component);
+    component_slots.push_back(terminals);
+}
+
+// Adds a nested instance to the subcircuit's template
+void Subcircuit::add_instance(const Instance &instance) {
+    Nested nested;
+    nested.name = instance.name;
+    nested.definition = instance.definition;
+    for(const auto &node : instance.node_names)
+        nested.slots.push_back(get_slot(node));
+
+    instances.push_back(nested);
+}
+
+// Returns the node ID of a slot, interning its node if it's the first use
+unsigned int Subcircuit::Scope::get_id(const unsigned int &slot,
+        Schematic &schematic) {
+
+    if(slot == ground)
+        return 0;
+
+    auto &id = ids[slot];
+    if(id != SymbolTable::none)
+        return id;
+
+    if(slot >= definition->port_count)
+        id = schematic.add_node(path + "." + definition->node_names[slot]);
+    else if(parent)
+        id = parent->get_id((*port_slots)[slot], schematic);
+    else
+        id = schematic.add_node((*port_names)[slot]);
+    return id;
+}
+
+// Adds a copy of each of the subcircuit's components to a schematic (creating
+// them in the arena given), connected to the nodes the instance specifies
+bool Subcircuit::instantiate(const Instance &instance,
+        const std::map<std::string, std::shared_ptr<Subcircuit>> &definitions,
+        Schematic &schematic, Arena &arena, const unsigned int depth = 0)
+        const {
+
+    if(instance.node_names.size() != port_count) {
+        std::cerr << "Subcircuit instance '" << instance.name << "' has " <<
+                instance.node_names.size() << " nodes, but definition '" <<
+                name << "' has " << port_count << " ports" << std::endl;
+        return false;
+    }
+
+    Scope scope;
+    scope.definition = this;
+    scope.path = instance.name;
+    scope.ids.assign(node_names.size(), SymbolTable::none);
+    scope.parent = nullptr;
+    scope.port_slots = nullptr;
+    scope.port_names = &instance.node_names;
+    return instantiate(scope, definitions, schematic, arena, depth);
+}
+
+// Adds a copy of each of the subcircuit's components to a schematic, as the
+// instance the scope given describes. Nodes are interned as they're first
+// used, so they're numbered in the order they're met, as they would be in a
+// flat netlist
+bool Subcircuit::instantiate(Scope &scope,
+        const std::map<std::string, std::shared_ptr<Subcircuit>> &definitions,
+        Schematic &schematic, Arena &arena, const unsigned int depth) const {
+
+    if(depth >= maximum_depth) {
+        std::cerr << "Subcircuits nested too deeply (is '" << name << "' "
+                "instantiated within itself?)" << std::endl;
+        return false;
+    }
+
+    // Copy each of the template's components, connecting their terminals
+    for(unsigned int index = 0; index < components.size(); index += 1) {
+        auto component = components[index]->clone(arena);
+        component->name = scope.path + "." + component->name;
+
+        const auto &terminals = component_slots[index];
+        for(unsigned int terminal = 0; terminal < terminals.size();
+                terminal += 1) {
+
+            component->node_ids[terminal] = scope.get_id(terminals[terminal],
+                    schematic);
+        }
+
+        if(schematic.add_connected_component(component) == false)
+            return false;
+    }
+
+    // Flatten any nested instances, their ports resolved through this scope
+    for(const auto &nested : instances) {
+        const auto definition = definitions.find(nested.definition);
+        if(definition == definitions.end()) {
+            std::cerr << "No definition for subcircuit '" <<
+                    nested.definition << "' (instance '" << nested.name <<
+                    "' in '" << name << "')" << std::endl;
+            return false;
+        }
+
+        const auto &subcircuit = *definition->second;
+        if(nested.slots.size() != subcircuit.port_count) {
+            std::cerr << "Subcircuit instance '" << nested.name << "' (in '" <<
+                    name << "') has " << nested.slots.size() << " nodes, " <<
+                    "but definition '" << subcircuit.name << "' has " <<
+                    subcircuit.port_count << " ports" << std::endl;
+            return false;
+        }
+
+        Scope inner;
+        inner.definition = &subcircuit;
+        inner.path = scope.path + "." + nested.name;
+        inner.ids.assign(subcircuit.node_names.size(), SymbolTable::none);
+        inner.parent = &scope;
+        inner.port_slots = &nested.slots;
+        inner.port_names = nullptr;
+        if(subcircuit.instantiate(inner, definitions, schematic, arena,
+                depth + 1) == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "components/templates/component.hpp"
+#include "schematic.hpp"
+#include "utilities/disjoint_set.hpp"
+
+/* ******************************************************************** Synopsis
+
+Checks a schematic for the structural problems that would leave its system of
+equations singular, before any matrix is built. In the system the transient
+analysis solves, capacitors are stamped as voltage sources, and inductors as
+current sources, so there are two:
+
+A loop made up only of voltage sources and capacitors, whose voltages are then
+over-determined. Found by merging the nodes either side of each such element;
+an element whose nodes are already connected closes a loop.
+
+A group of nodes connected to the rest of the circuit (ground included) only
+through current sources and inductors, or not at all, whose voltages are then
+undetermined. Found by merging the nodes either side of every other element;
+any node that doesn't end up connected to ground is in such a group.
+
+Every problem found is reported, along with the elements responsible.
+
+*/
+
+class Topology {
+
+private:
+
+    static const unsigned int none = std::numeric_limits<unsigned int>::max();
+
+    static bool check_loops(const Schematic &schematic);
+    static bool check_cutsets(const Schematic &schematic);
+
+public:
+
+    static bool check(const Schematic &schematic);
+
+};
+
+const unsigned int Topology::none;
+
+// Returns true if the schematic's system of equations would be structurally
+// sound, reporting each problem found otherwise
+bool Topology::check(const Schematic &schematic) {
+    const bool loops = check_loops(schematic);
+    const bool cutsets = check_cutsets(schematic);
+    return loops && cutsets;
+}
+
+// Checks for loops made up only of voltage sources and capacitors
+bool Topology::check_loops(const Schematic &schematic) {
+    DisjointSet nodes(schematic.get_node_count());
+
+    bool passed = true;
+    for(const auto &component : schematic.get_components(
+            Component::VOLTAGE_SOURCE | Component::CAPACITOR)) {
+
+        const auto &ids = component->node_ids;
+        if(nodes.merge(ids[0], ids[1]))
+            continue;
+
+        std::cerr << "'" << component->name << "' completes a loop of voltage "
+                "sources and capacitors between nodes '" <<
+                schematic.get_node_name(ids[0]) << "' and '" <<
+                schematic.get_node_name(ids[1]) << "'" << std::endl;
+        passed = false;
+    }
+    return passed;
+}
+
+// Checks for groups of nodes with no path to ground except through current
+// sources and inductors
+bool Topology::check_cutsets(const Schematic &schematic) {
+    const unsigned int node_count = schematic.get_node_count();
+    DisjointSet nodes(node_count);
+
+    for(const auto &component : schematic.get_components(
+            Component::RESISTOR | Component::VOLTAGE_SOURCE |
+            Component::CAPACITOR)) {
+
+        nodes.merge(component->node_ids[0], component->node_ids[1]);
+    }
+
+    // Gather the nodes that aren't connected to ground into their groups
+    const unsigned int ground = nodes.find(0);
+    std::vector<unsigned int> group_indices(node_count, none);
+    std::vector<std::vector<unsigned int>> groups;
+    for(unsigned int node = 1; node < node_count; node += 1) {
+        const auto root = nodes.find(node);
+        if(root == ground)
+            continue;
+
+        if(group_indices[root] == none) {
+            group_indices[root] = groups.size();
+            groups.emplace_back();
+        }
+        groups[group_indices[root]].push_back(node);
+    }
+
+    if(groups.empty())
+        return true;
+
+    // Find the elements crossing into each group (those with one node inside
+    // it, and the other outside)
+    std::vector<std::vector<const Component *>> crossings(groups.size());
+    for(const auto &component : schematic.get_components(
+            Component::CURRENT_SOURCE | Component::INDUCTOR)) {
+
+        const auto one = nodes.find(component->node_ids[0]);
+        const auto two = nodes.find(component->node_ids[1]);
+        if(one == two)
+            continue;
+
+        if(group_indices[one] != none)
+            crossings[group_indices[one]].push_back(component);
+        if(group_indices[two] != none)
+            crossings[group_indices[two]].push_back(component);
+    }
+
+    for(unsigned int index = 0; index < groups.size(); index += 1) {
+        const bool plural = groups[index].size() > 1;
+        std::cerr << (plural ? "Nodes " : "Node ");
+        for(unsigned int node = 0; node < groups[index].size(); node += 1) {
+            std::cerr << (node ? ", '" : "'") <<
+                    schematic.get_node_name(groups[index][node]) << "'";
+        }
+
+        if(crossings[index].empty()) {
+            std::cerr << (plural ? " aren't" : " isn't") << " connected to "
+                    "ground" << std::endl;
+            continue;
+        }
+
+        std::cerr << (plural ? " only connect" : " only connects") << " to "
+                "ground through current sources and inductors (";
+        for(unsigned int element = 0; element < crossings[index].size();
+                element += 1) {
+
+            std::cerr << (element ? ", '" : "'") <<
+                    crossings[index][element]->name << "'";
+        }
+        std::cerr << ")" << std::endl;
+    }
+    return false;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/* ******************************************************************** Synopsis
+
+An allocator whose blocks start on a boundary of the given alignment (by
+default, a 64-byte cache line), for the values of dense matrices: a row that
+starts on a line boundary is loaded in as few lines as possible, and vector
+loads from its start never split across two.
+
+Each block's over-allocated through the global operator new by the alignment,
+and the pointer it returned is kept just before the aligned block, for it to
+be freed by.
+
+*/
+
+template <typename Type, std::size_t Alignment = 64>
+class AlignedAllocator {
+
+public:
+
+    typedef Type value_type;
+
+    template <typename Other>
+    struct rebind {
+        typedef AlignedAllocator<Other, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename Other>
+    AlignedAllocator(const AlignedAllocator<Other, Alignment> &) {}
+
+    Type *allocate(const std::size_t &count);
+    void deallocate(Type *pointer, const std::size_t &count);
+
+};
+
+// Allocates space for a number of values, aligned
+template <typename Type, std::size_t Alignment>
+Type *AlignedAllocator<Type, Alignment>::allocate(const std::size_t &count) {
+    static_assert(Alignment >= sizeof(void *) &&
+            (Alignment & (Alignment - 1)) == 0,
+            "Alignment must be a power of two, and fit a pointer");
+
+    char *block = static_cast<char *>(::operator new(count * sizeof(Type) +
+            Alignment));
+
+    // There's always at least a pointer's space before the aligned address
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block) +
+            Alignment;
+    char *aligned = reinterpret_cast<char *>(address & ~(std::uintptr_t)(
+            Alignment - 1));
+    reinterpret_cast<void **>(aligned)[-1] = block;
+    return reinterpret_cast<Type *>(aligned);
+}
+
+// Frees values allocated by 'allocate'
+template <typename Type, std::size_t Alignment>
+void AlignedAllocator<Type, Alignment>::deallocate(Type *pointer,
+        const std::size_t &) {
+
+    if(pointer)
+        ::operator delete(reinterpret_cast<void **>(pointer)[-1]);
+}
+
+// Every instance can free what every other allocated
+template <typename One, typename Two, std::size_t Alignment>
+bool operator==(const AlignedAllocator<One, Alignment> &,
+        const AlignedAllocator<Two, Alignment> &) {
+
+    return true;
+}
+
+template <typename One, typename Two, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<One, Alignment> &,
+        const AlignedAllocator<Two, Alignment> &) {
+
+    return false;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+/* ******************************************************************** Synopsis
+
+Counts the heap allocations made on each thread, for checking that the code
+meant not to allocate (like a transient's time steps, once it's set up) really
+doesn't. Counting replaces the global operator new, so it's only compiled in
+when COUNT_ALLOCATIONS is defined (before this header's first included); in
+any other build the count stays at zero, and reading it costs nothing.
+
+Each thread counts its own allocations, so the workers stepping blocks don't
+see each other's (or the printing thread's).
+
+*/
+
+class Allocations {
+
+private:
+
+    static thread_local unsigned long count;
+
+public:
+
+    static bool is_counting();
+    static unsigned long get_count();
+
+    static void add();
+
+};
+
+thread_local unsigned long Allocations::count = 0;
+
+// Returns whether this build counts allocations
+bool Allocations::is_counting() {
+#ifdef COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Returns the number of allocations made on the calling thread so far
+unsigned long Allocations::get_count() {
+    return count;
+}
+
+// Counts an allocation on the calling thread
+void Allocations::add() {
+    count += 1;
+}
+
+#ifdef COUNT_ALLOCATIONS
+
+// Every form of new is replaced, and paired with the forms of delete that
+// free what it allocates (the sized forms and the aligned ones only where the
+// language has them), so that each allocation's counted and freed the same
+// way it was made
+
+// Counts and makes an allocation, returning null if there's no memory
+inline void *counted_allocate(std::size_t size) noexcept {
+    Allocations::add();
+    return std::malloc(size ? size : 1);
+}
+
+// Frees an allocation counted_allocate made. It's kept out of line, as otherwise
+// it's inlined into each delete, and GCC (seeing the pointers came from new)
+// warns that free doesn't match
+__attribute__((noinline)) void counted_free(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void *operator new(std::size_t size) {
+    void *pointer = counted_allocate(size);
+    if(pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](std::size_t size) {
+    void *pointer = counted_allocate(size);
+    if(pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return counted_allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return counted_allocate(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    counted_free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    counted_free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+    counted_free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+    counted_free(pointer);
+}
+
+#ifdef __cpp_sized_deallocation
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    counted_free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    counted_free(pointer);
+}
+
+#endif
+
+#ifdef __cpp_aligned_new
+
+// Counts and makes an allocation aligned to a boundary (a power of two, at
+// least that of a pointer), returning null if there's no memory
+inline void *counted_allocate(std::size_t size, std::align_val_t alignment)
+        noexcept {
+
+    Allocations::add();
+    void *pointer = nullptr;
+    const std::size_t boundary = std::max(sizeof(void *),
+            static_cast<std::size_t>(alignment));
+    if(posix_memalign(&pointer, boundary, size ? size : 1) != 0)
+        return nullptr;
+    return pointer;
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    void *pointer = counted_allocate(size, alignment);
+    if(pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    void *pointer = counted_allocate(size, alignment);
+    if(pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+        const std::nothrow_t &) noexcept {
+
+    return counted_allocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+        const std::nothrow_t &) noexcept {
+
+    return counted_allocate(size, alignment);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+    counted_free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+    counted_free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t,
+        const std::nothrow_t &) noexcept {
+
+    counted_free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t,
+        const std::nothrow_t &) noexcept {
+
+    counted_free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+    counted_free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t)
+        noexcept {
+
+    counted_free(pointer);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* ******************************************************************** Synopsis
+
+A bump allocator, for objects which all live as long as one another (like the
+components of a simulation). Memory is handed out from large blocks, by
+advancing a cursor; nothing is freed individually, and everything is freed at
+once when the arena's destroyed.
+
+Objects are created with 'create', which constructs them in place. Those whose
+types have non-trivial destructors have them registered, and they're called
+(in the reverse order of creation) when the arena's destroyed.
+
+*/
+
+class Arena {
+
+private:
+
+    struct Destructor {
+        void *object;
+        void (*destroy)(void *object);
+    };
+
+    static const std::size_t block_size = 1 << 16;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *cursor;
+    std::size_t remaining;
+
+    std::vector<Destructor> destructors;
+
+    template <typename Type>
+    static void destroy(void *object);
+
+public:
+
+    Arena();
+    Arena(const Arena &arena) = delete;
+    Arena &operator=(const Arena &arena) = delete;
+    ~Arena();
+
+    void *allocate(const std::size_t &size, const std::size_t &alignment);
+
+    template <typename Type, typename... Arguments>
+    Type *create(Arguments &&...arguments);
+
+};
+
+const std::size_t Arena::block_size;
+
+Arena::Arena() {
+    cursor = nullptr;
+    remaining = 0;
+}
+
+// Destroys every object created in the arena, most recent first
+Arena::~Arena() {
+    for(auto destructor = destructors.rbegin();
+            destructor != destructors.rend(); destructor++) {
+
+        destructor->destroy(destructor->object);
+    }
+}
+
+template <typename Type>
+void Arena::destroy(void *object) {
+    static_cast<Type *>(object)->~Type();
+}
+
+// Returns a block of memory with the size and alignment given, starting a new
+// block if the current one's too full (allocations larger than a block get one
+// to themselves)
+void *Arena::allocate(const std::size_t &size, const std::size_t &alignment) {
+    std::size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(
+            cursor) % alignment) % alignment;
+
+    if(size + padding > remaining) {
+        const std::size_t length = std::max(block_size, size + alignment);
+        blocks.emplace_back(new char[length]);
+        cursor = blocks.back().get();
+        remaining = length;
+
+        padding = (alignment - reinterpret_cast<std::uintptr_t>(cursor) %
+                alignment) % alignment;
+    }
+
+    char *result = cursor + padding;
+    cursor += size + padding;
+    remaining -= size + padding;
+    return result;
+}
+
+// Constructs an object in the arena
+template <typename Type, typename... Arguments>
+Type *Arena::create(Arguments &&...arguments) {
+    void *memory = allocate(sizeof(Type), alignof(Type));
+    Type *object = new(memory) Type(std::forward<Arguments>(arguments)...);
+
+    if(std::is_trivially_destructible<Type>::value == false)
+        destructors.push_back({object, &destroy<Type>});
+    return object;
+}
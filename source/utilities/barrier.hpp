@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+/* ******************************************************************** Synopsis
+
+A reusable barrier, at which a fixed number of threads wait until all of them
+have arrived. Each time the last one arrives the barrier's generation advances,
+releasing the others, so the same barrier can be waited on again straight away
+(as it is once per time step).
+
+*/
+
+class Barrier {
+
+private:
+
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    unsigned int count;
+    unsigned int waiting;
+    unsigned int generation;
+
+public:
+
+    Barrier(const unsigned int &count);
+    Barrier(const Barrier &barrier) = delete;
+    Barrier &operator=(const Barrier &barrier) = delete;
+
+    void wait();
+
+};
+
+Barrier::Barrier(const unsigned int &count) {
+    this->count = count;
+    waiting = 0;
+    generation = 0;
+}
+
+// Blocks until every thread has reached the barrier
+void Barrier::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    const unsigned int arrival = generation;
+    waiting += 1;
+    if(waiting == count) {
+        waiting = 0;
+        generation += 1;
+        condition.notify_all();
+        return;
+    }
+
+    condition.wait(lock, [&]() { return generation != arrival; });
+}
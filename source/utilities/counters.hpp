@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* ******************************************************************** Synopsis
+
+A group of hardware performance counters for the calling thread, opened with
+perf_event_open: CPU cycles, instructions retired, last-level cache misses, and
+branch misses. The counters are opened as one group, so they're read together
+(with a single system call), and count over the same span.
+
+Counters aren't always available: outside Linux, in containers and virtual
+machines that don't expose them, or where perf_event_paranoid forbids them.
+Opening then fails, and the group reads as zeros; any one counter that can't be
+opened is left out of the group, and reads as zero on its own.
+
+*/
+
+class Counters {
+
+public:
+
+    enum Kind {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        KIND_COUNT
+    };
+
+    typedef std::array<std::uint64_t, KIND_COUNT> Values;
+
+private:
+
+    // The file descriptor of each counter (-1 where it couldn't be opened),
+    // the first one opened leading the group
+    std::array<int, KIND_COUNT> descriptors;
+    int leader;
+
+    // The position of each counter's value in the group's reading
+    std::array<int, KIND_COUNT> positions;
+    unsigned int count;
+
+public:
+
+    Counters();
+    Counters(const Counters &counters) = delete;
+    Counters &operator=(const Counters &counters) = delete;
+    ~Counters();
+
+    bool open();
+    void release();
+    bool is_open() const;
+    bool has(const Kind &kind) const;
+
+    Values read() const;
+
+    static const char *get_name(const Kind &kind);
+
+};
+
+Counters::Counters() {
+    descriptors.fill(-1);
+    positions.fill(-1);
+    leader = -1;
+    count = 0;
+}
+
+Counters::~Counters() {
+    release();
+}
+
+// Opens the counters, for the calling thread only, and starts them. Returns
+// false if none of them could be opened
+bool Counters::open() {
+#ifdef __linux__
+    const std::uint64_t configurations[KIND_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for(unsigned int kind = 0; kind < KIND_COUNT; kind += 1) {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = configurations[kind];
+        attributes.disabled = leader < 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP;
+
+        const int descriptor = syscall(SYS_perf_event_open, &attributes, 0, -1,
+                leader, 0);
+        if(descriptor < 0)
+            continue;
+
+        descriptors[kind] = descriptor;
+        positions[kind] = count;
+        count += 1;
+        if(leader < 0)
+            leader = descriptor;
+    }
+
+    if(leader < 0)
+        return false;
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Closes the counters, which can then be opened again (by another thread)
+void Counters::release() {
+#ifdef __linux__
+    for(const auto &descriptor : descriptors) {
+        if(descriptor >= 0)
+            ::close(descriptor);
+    }
+#endif
+    descriptors.fill(-1);
+    positions.fill(-1);
+    leader = -1;
+    count = 0;
+}
+
+// Returns whether any of the counters are counting
+bool Counters::is_open() const {
+    return leader >= 0;
+}
+
+// Returns whether a particular counter's counting
+bool Counters::has(const Kind &kind) const {
+    return descriptors[kind] >= 0;
+}
+
+// Reads the counts so far (zero for any counter that isn't counting)
+Counters::Values Counters::read() const {
+    Values values;
+    values.fill(0);
+
+#ifdef __linux__
+    if(leader < 0)
+        return values;
+
+    // A group's read as its number of counters, then their values in the
+    // order they were opened
+    std::uint64_t buffer[KIND_COUNT + 1];
+    if(::read(leader, buffer, sizeof(std::uint64_t) * (count + 1)) <= 0)
+        return values;
+
+    for(unsigned int kind = 0; kind < KIND_COUNT; kind += 1) {
+        if(positions[kind] >= 0)
+            values[kind] = buffer[positions[kind] + 1];
+    }
+#endif
+
+    return values;
+}
+
+// Returns the name a counter's reported under
+const char *Counters::get_name(const Kind &kind) {
+    switch(kind) {
+        case CYCLES:
+            return "cycles";
+        case INSTRUCTIONS:
+            return "instructions";
+        case CACHE_MISSES:
+            return "cache_misses";
+        case BRANCH_MISSES:
+            return "branch_misses";
+        default:
+            return "";
+    }
+}
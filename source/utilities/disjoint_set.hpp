@@ -0,0 +1,60 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+/* ******************************************************************** Synopsis
+
+A union-find structure over the integers 0 to size - 1, which starts with each
+in a set of its own. Sets are merged by size, and paths are halved as they're
+followed, so any sequence of operations runs in near-linear time.
+
+*/
+
+class DisjointSet {
+
+private:
+
+    std::vector<unsigned int> parents;
+    std::vector<unsigned int> sizes;
+
+public:
+
+    DisjointSet(const unsigned int &size);
+
+    unsigned int find(unsigned int element);
+    bool merge(const unsigned int &one, const unsigned int &two);
+
+};
+
+DisjointSet::DisjointSet(const unsigned int &size) {
+    parents.resize(size);
+    sizes.assign(size, 1);
+    for(unsigned int index = 0; index < size; index += 1)
+        parents[index] = index;
+}
+
+// Returns the representative of the set containing an element
+unsigned int DisjointSet::find(unsigned int element) {
+    while(parents[element] != element) {
+        parents[element] = parents[parents[element]];
+        element = parents[element];
+    }
+    return element;
+}
+
+// Merges the sets containing two elements. Returns false if they were already
+// in the same set
+bool DisjointSet::merge(const unsigned int &one, const unsigned int &two) {
+    auto root_one = find(one);
+    auto root_two = find(two);
+    if(root_one == root_two)
+        return false;
+
+    if(sizes[root_one] < sizes[root_two])
+        std::swap(root_one, root_two);
+
+    parents[root_two] = root_one;
+    sizes[root_one] += sizes[root_two];
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+/* ******************************************************************** Synopsis
+
+Orderings of graphs given as adjacency lists (a list of the neighbours of each
+vertex), used to split circuits into bands that can be worked on separately.
+
+*/
+
+// Returns every vertex, in breadth-first order from the one given (starting
+// again from the first unvisited vertex whenever the graph's exhausted)
+std::vector<unsigned int> order_breadth_first(
+        const std::vector<std::vector<unsigned int>> &neighbours,
+        const unsigned int &start) {
+
+    const unsigned int size = neighbours.size();
+    std::vector<bool> visited(size, false);
+    std::vector<unsigned int> order;
+    order.reserve(size);
+    if(size == 0)
+        return order;
+
+    unsigned int next = start;
+    while(true) {
+        visited[next] = true;
+        order.push_back(next);
+
+        for(unsigned int index = order.size() - 1; index < order.size();
+                index += 1) {
+
+            for(const auto &neighbour : neighbours[order[index]]) {
+                if(visited[neighbour] == false) {
+                    visited[neighbour] = true;
+                    order.push_back(neighbour);
+                }
+            }
+        }
+
+        if(order.size() == size)
+            break;
+
+        next = 0;
+        while(visited[next])
+            next += 1;
+    }
+
+    return order;
+}
+
+// Returns every vertex, in breadth-first order from the vertex found last by a
+// first search (which lies at one 'end' of the graph, so the order sweeps
+// across it from there)
+std::vector<unsigned int> order_across(
+        const std::vector<std::vector<unsigned int>> &neighbours) {
+
+    if(neighbours.empty())
+        return std::vector<unsigned int>();
+
+    return order_breadth_first(neighbours, order_breadth_first(neighbours,
+            0).back());
+}
@@ -1,17 +1,16 @@
 #pragma once
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
 
-typedef unsigned int Hash;
+// 64-bit FNV-1a hash of a block of bytes. Unlike std::hash, its value is the
+// same across builds and platforms, so it's suitable for keying files on disk
+std::uint64_t hash_content(const char *data, const std::size_t &length,
+        std::uint64_t hash = 0xcbf29ce484222325) {
 
-Hash hash_value(const std::string &string) {
-    return std::hash<std::string>{}(string);
-}
-
-Hash hash_node(const std::string &node) {
-    return (node == "0") ? 0 : hash_value(node);
-}
-
-Hash hash_combine(Hash one, const Hash &two) {
-    return one ^= two + 0x9e3779b9 + (one << 6) + (one >> 2);
+    for(std::size_t index = 0; index < length; index += 1) {
+        hash ^= static_cast<unsigned char>(data[index]);
+        hash *= 0x100000001b3;
+    }
+    return hash;
 }
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+/* ******************************************************************** Synopsis
+
+Dense kernels for row-major matrices, each given by a pointer to its first
+value and its leading dimension (the distance between the starts of its rows),
+so they can work on blocks within larger matrices without copying them.
+
+The product kernel, C += f A B, is tiled for the cache: the columns of B and C
+are taken in bands, and the inner dimension in blocks, small enough that the
+block of B being worked on stays in cache while every row of A passes over it.
+Within a tile, C is updated four rows by eight columns at a time, with the
+sums held in registers until the whole block's been added. Each entry's sum is
+built in the same order (by the inner index) as a plain triple loop would, so
+the tiling doesn't change its rounding.
+
+Where the compiler's targeting AVX2 and FMA (as with -mavx2 -mfma, or
+-march=native on any machine since 2013), the registers are four-wide vectors
+and each step's a fused multiply-add (which rounds once, rather than twice, so
+the results differ from the scalar kernel's in their last bits). Otherwise the
+same tiles are worked through with scalars.
+
+Steps where all four rows of A are zero are skipped, since the systems of
+circuits are sparse, and their LU factors mostly so.
+
+*/
+
+// The sizes of the cache tiles: the inner dimension, and the columns of B
+const unsigned int kernel_inner_block = 128;
+const unsigned int kernel_column_block = 256;
+
+// Adds f times the product of an m by k matrix A and a k by n matrix B to an
+// m by n matrix C, for four rows of C and eight of its columns
+inline void add_product_tile(const unsigned int &k, const double *a,
+        const unsigned int &lda, const double *b, const unsigned int &ldb,
+        double *c, const unsigned int &ldc, const double &factor) {
+
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256d sums[4][2];
+    for(unsigned int row = 0; row < 4; row += 1) {
+        sums[row][0] = _mm256_loadu_pd(c + row * ldc);
+        sums[row][1] = _mm256_loadu_pd(c + row * ldc + 4);
+    }
+
+    // Subtracting's done by negating the sums either side of the loop, so
+    // it needn't scale each value of A
+    if(factor < 0) {
+        const __m256d negative = _mm256_set1_pd(-0.0);
+        for(unsigned int row = 0; row < 4; row += 1) {
+            sums[row][0] = _mm256_xor_pd(sums[row][0], negative);
+            sums[row][1] = _mm256_xor_pd(sums[row][1], negative);
+        }
+    }
+
+    for(unsigned int index = 0; index < k; index += 1) {
+        if(a[index] == 0 && a[lda + index] == 0 && a[2 * lda + index] == 0 &&
+                a[3 * lda + index] == 0) {
+            continue;
+        }
+
+        const __m256d left = _mm256_loadu_pd(b + index * ldb);
+        const __m256d right = _mm256_loadu_pd(b + index * ldb + 4);
+        for(unsigned int row = 0; row < 4; row += 1) {
+            const __m256d value = _mm256_broadcast_sd(a + row * lda + index);
+            sums[row][0] = _mm256_fmadd_pd(value, left, sums[row][0]);
+            sums[row][1] = _mm256_fmadd_pd(value, right, sums[row][1]);
+        }
+    }
+
+    if(factor < 0) {
+        const __m256d negative = _mm256_set1_pd(-0.0);
+        for(unsigned int row = 0; row < 4; row += 1) {
+            sums[row][0] = _mm256_xor_pd(sums[row][0], negative);
+            sums[row][1] = _mm256_xor_pd(sums[row][1], negative);
+        }
+    }
+
+    for(unsigned int row = 0; row < 4; row += 1) {
+        _mm256_storeu_pd(c + row * ldc, sums[row][0]);
+        _mm256_storeu_pd(c + row * ldc + 4, sums[row][1]);
+    }
+#else
+    double sums[4][8];
+    for(unsigned int row = 0; row < 4; row += 1) {
+        for(unsigned int column = 0; column < 8; column += 1)
+            sums[row][column] = c[row * ldc + column];
+    }
+
+    for(unsigned int index = 0; index < k; index += 1) {
+        const double values[4] = {
+            a[index], a[lda + index], a[2 * lda + index], a[3 * lda + index]
+        };
+        if(values[0] == 0 && values[1] == 0 && values[2] == 0 &&
+                values[3] == 0) {
+            continue;
+        }
+
+        const double *row_b = b + index * ldb;
+        for(unsigned int row = 0; row < 4; row += 1) {
+            const double value = factor * values[row];
+            for(unsigned int column = 0; column < 8; column += 1)
+                sums[row][column] += value * row_b[column];
+        }
+    }
+
+    for(unsigned int row = 0; row < 4; row += 1) {
+        for(unsigned int column = 0; column < 8; column += 1)
+            c[row * ldc + column] = sums[row][column];
+    }
+#endif
+}
+
+// Adds f times the product of A and B to C, for entries of C outside the
+// whole tiles, one at a time
+inline void add_product_entry(const unsigned int &k, const double *a,
+        const double *b, const unsigned int &ldb, double *c,
+        const double &factor) {
+
+    double sum = *c;
+    for(unsigned int index = 0; index < k; index += 1) {
+        if(a[index] != 0)
+            sum += factor * a[index] * b[index * ldb];
+    }
+    *c = sum;
+}
+
+// Adds f times the product of an m by k matrix A and a k by n matrix B to an
+// m by n matrix C (f being 1 or -1, so that scaling A by it is exact)
+void add_product(const unsigned int &m, const unsigned int &n,
+        const unsigned int &k, const double *a, const unsigned int &lda,
+        const double *b, const unsigned int &ldb, double *c,
+        const unsigned int &ldc, const double &factor) {
+
+    for(unsigned int band = 0; band < n; band += kernel_column_block) {
+        const unsigned int band_end = std::min(n, band + kernel_column_block);
+        const unsigned int tiled_end = band + (band_end - band) / 8 * 8;
+
+        for(unsigned int block = 0; block < k; block += kernel_inner_block) {
+            const unsigned int depth = std::min(kernel_inner_block,
+                    k - block);
+            const double *block_a = a + block;
+            const double *block_b = b + block * ldb;
+
+            unsigned int row = 0;
+            for(; row + 4 <= m; row += 4) {
+                for(unsigned int column = band; column < tiled_end;
+                        column += 8) {
+
+                    add_product_tile(depth, block_a + row * lda, lda,
+                            block_b + column, ldb, c + row * ldc + column,
+                            ldc, factor);
+                }
+                for(unsigned int offset = 0; offset < 4; offset += 1) {
+                    for(unsigned int column = tiled_end; column < band_end;
+                            column += 1) {
+
+                        add_product_entry(depth, block_a + (row + offset) *
+                                lda, block_b + column, ldb, c + (row +
+                                offset) * ldc + column, factor);
+                    }
+                }
+            }
+
+            for(; row < m; row += 1) {
+                for(unsigned int column = band; column < band_end;
+                        column += 1) {
+
+                    add_product_entry(depth, block_a + row * lda,
+                            block_b + column, ldb, c + row * ldc + column,
+                            factor);
+                }
+            }
+        }
+    }
+}
+
+// Subtracts a multiple of one row from another, over n values
+inline void subtract_scaled_row(const unsigned int &n, const double &factor,
+        const double *source, double *target) {
+
+    for(unsigned int index = 0; index < n; index += 1)
+        target[index] -= factor * source[index];
+}
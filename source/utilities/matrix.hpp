@@ -5,19 +5,66 @@
 #include <iostream>
 #include <ostream>
 #include <limits>
+#include <utility>
 #include <vector>
 
 #include <cmath>
 
+#include "aligned.hpp"
+#include "kernels.hpp"
+
 /* ******************************************************************** Synopsis
 
-TODO: Write
+A dense matrix of doubles, held in row-major order.
+
+Arithmetic between matrices (+, -, *, and scaling by a factor) is lazy: each
+operator returns a small expression object, holding references to the
+matrices it's made from, rather than a matrix of its result. Nothing's
+calculated until the expression's assigned to a matrix, which then evaluates
+the whole of it in a single loop over its own values, so that
+
+    result = conductances * voltages + constants * step;
+
+makes no temporaries, and (if result's already the right size) allocates
+nothing. A product's entries are each the sum along a row and a column,
+accumulated in the same order as the tiled product kernel (see kernels.hpp)
+does; a product assigned or added to a matrix on its own is handed to that
+kernel. If a matrix appears in a product on the right of its own assignment,
+the product's found into a temporary first, since its entries would otherwise
+be overwritten while they're still needed.
+
+Because expressions hold references, they should be assigned to a Matrix (not
+kept with auto) before the matrices in them go out of scope.
 
 */
 
+// ***************************************************************** Expressions
+
+class Matrix;
+
+template <typename Left, typename Right>
+class MatrixProduct;
+
+// The base of each matrix expression type, which it passes as Expression so
+// that the operators can take any expression, and reach its type statically
+template <typename Expression>
+class MatrixExpression {
+
+public:
+
+    const Expression &self() const;
+
+};
+
+// Returns the expression as its own type
+template <typename Expression>
+const Expression &MatrixExpression<Expression>::self() const {
+    return static_cast<const Expression &>(*this);
+}
+
 // ****************************************************************** Definition
 
-class Matrix {
+class Matrix : public MatrixExpression<Matrix> {
 
 public:
 
@@ -44,19 +91,25 @@ public:
             const unsigned int &row_one, const unsigned int &column_two,
             const unsigned int &row_two) const;
 
-    Matrix &operator-=(const Matrix &matrix);
+    template <typename Expression>
+    Matrix &operator=(const MatrixExpression<Expression> &expression);
+
+    template <typename Expression>
+    Matrix &operator-=(const MatrixExpression<Expression> &expression);
     Matrix &operator*=(const double &factor);
     Matrix &operator*=(const Matrix &matrix);
     Matrix &operator/=(const double &factor);
-    Matrix &operator+=(const Matrix &matrix);
+    template <typename Expression>
+    Matrix &operator+=(const MatrixExpression<Expression> &expression);
 
     friend bool operator==(const Matrix &one, const Matrix &two);
-    friend bool operator-=(const Matrix &one, const Matrix &two);
 
     Matrix();
     Matrix(const double &value);
     Matrix(const std::initializer_list<std::vector<double>> &values);
     Matrix(const unsigned int &rows, const unsigned int &columns);
+    template <typename Expression>
+    Matrix(const MatrixExpression<Expression> &expression);
 
     Matrix &remove_column(const unsigned int &column);
     Matrix &remove_row(const unsigned int &row);
@@ -74,9 +127,18 @@ public:
     unsigned int rows() const;
     unsigned int volume() const;
 
+    double *data();
+    const double *data() const;
+
+    // The interface of a matrix expression, for a matrix on its own
+    double value(const unsigned int &row, const unsigned int &column) const;
+    bool refers_to(const Matrix &matrix) const;
+    bool reads_across(const Matrix &matrix) const;
+
 private:
 
-    std::vector<double> _values;
+    // Aligned to cache lines, for the dense kernels
+    std::vector<double, AlignedAllocator<double>> _values;
 
     unsigned int _columns;
     unsigned int _rows;
@@ -88,6 +150,17 @@ private:
 
     inline int choose_pivot_index(const unsigned int &initial_row);
 
+    template <typename Expression>
+    void evaluate(const Expression &expression);
+    template <typename Left, typename Right>
+    void evaluate(const MatrixProduct<Left, Right> &product);
+
+    template <typename Expression>
+    void accumulate(const Expression &expression, const double &sign);
+    template <typename Left, typename Right>
+    void accumulate(const MatrixProduct<Left, Right> &product,
+            const double &sign);
+
 };
 
 std::ostream &operator<<(std::ostream &stream, const Matrix &matrix);
@@ -99,11 +172,232 @@ std::ostream &operator<<(std::ostream &stream,
 bool operator!=(const Matrix &one, const Matrix &two);
 bool operator==(const Matrix &one, const Matrix &two);
 
-Matrix operator-(const Matrix &one, const Matrix &two);
-Matrix operator*(const Matrix &one, const double &factor);
-Matrix operator*(const Matrix &one, const Matrix &two);
-Matrix operator/(const Matrix &one, const double &factor);
-Matrix operator+(const Matrix &one, const Matrix &two);
+/* ***************************************************** Expression definitions
+
+Each expression type gives its size, and the value of each of its entries,
+calculated from its operands when asked for. Operands that are expressions
+are held by value (they're only a few references and factors), and matrices
+by reference, as chosen by MatrixOperand.
+
+Each can also tell whether it refers to a given matrix, and whether finding
+one of its entries reads other entries of that matrix (as only a product
+does), in which case it can't be evaluated into that matrix in place.
+
+*/
+
+// How an expression holds an operand: by value, unless it's a matrix
+template <typename Expression>
+struct MatrixOperand {
+    typedef const Expression type;
+};
+
+template <>
+struct MatrixOperand<Matrix> {
+    typedef const Matrix &type;
+};
+
+// The sum of two expressions of the same size
+template <typename Left, typename Right>
+class MatrixSum : public MatrixExpression<MatrixSum<Left, Right>> {
+
+private:
+
+    typename MatrixOperand<Left>::type one;
+    typename MatrixOperand<Right>::type two;
+
+public:
+
+    MatrixSum(const Left &one, const Right &two) : one(one), two(two) {}
+
+    unsigned int rows() const { return one.rows(); }
+    unsigned int columns() const { return one.columns(); }
+
+    double value(const unsigned int &row, const unsigned int &column) const {
+        return one.value(row, column) + two.value(row, column);
+    }
+
+    bool refers_to(const Matrix &matrix) const {
+        return one.refers_to(matrix) || two.refers_to(matrix);
+    }
+
+    bool reads_across(const Matrix &matrix) const {
+        return one.reads_across(matrix) || two.reads_across(matrix);
+    }
+
+};
+
+// The difference of two expressions of the same size
+template <typename Left, typename Right>
+class MatrixDifference :
+        public MatrixExpression<MatrixDifference<Left, Right>> {
+
+private:
+
+    typename MatrixOperand<Left>::type one;
+    typename MatrixOperand<Right>::type two;
+
+public:
+
+    MatrixDifference(const Left &one, const Right &two) :
+            one(one), two(two) {}
+
+    unsigned int rows() const { return one.rows(); }
+    unsigned int columns() const { return one.columns(); }
+
+    double value(const unsigned int &row, const unsigned int &column) const {
+        return one.value(row, column) - two.value(row, column);
+    }
+
+    bool refers_to(const Matrix &matrix) const {
+        return one.refers_to(matrix) || two.refers_to(matrix);
+    }
+
+    bool reads_across(const Matrix &matrix) const {
+        return one.reads_across(matrix) || two.reads_across(matrix);
+    }
+
+};
+
+// An expression with each value multiplied by a factor
+template <typename Operand>
+class MatrixScaled : public MatrixExpression<MatrixScaled<Operand>> {
+
+private:
+
+    typename MatrixOperand<Operand>::type operand;
+    double factor;
+
+public:
+
+    MatrixScaled(const Operand &operand, const double &factor) :
+            operand(operand), factor(factor) {}
+
+    unsigned int rows() const { return operand.rows(); }
+    unsigned int columns() const { return operand.columns(); }
+
+    double value(const unsigned int &row, const unsigned int &column) const {
+        return operand.value(row, column) * factor;
+    }
+
+    bool refers_to(const Matrix &matrix) const {
+        return operand.refers_to(matrix);
+    }
+
+    bool reads_across(const Matrix &matrix) const {
+        return operand.reads_across(matrix);
+    }
+
+};
+
+// An expression with each value divided by a factor (rather than multiplied
+// by its reciprocal, which would round differently)
+template <typename Operand>
+class MatrixQuotient : public MatrixExpression<MatrixQuotient<Operand>> {
+
+private:
+
+    typename MatrixOperand<Operand>::type operand;
+    double factor;
+
+public:
+
+    MatrixQuotient(const Operand &operand, const double &factor) :
+            operand(operand), factor(factor) {}
+
+    unsigned int rows() const { return operand.rows(); }
+    unsigned int columns() const { return operand.columns(); }
+
+    double value(const unsigned int &row, const unsigned int &column) const {
+        return operand.value(row, column) / factor;
+    }
+
+    bool refers_to(const Matrix &matrix) const {
+        return operand.refers_to(matrix);
+    }
+
+    bool reads_across(const Matrix &matrix) const {
+        return operand.reads_across(matrix);
+    }
+
+};
+
+// How a product holds an operand: as a matrix, so that its entries can be
+// read many times over without being recalculated (an operand that's an
+// expression is evaluated when the product's made)
+template <typename Expression>
+struct ProductOperand {
+    typedef const Matrix type;
+};
+
+template <>
+struct ProductOperand<Matrix> {
+    typedef const Matrix &type;
+};
+
+// The product of two expressions, the first with as many columns as the
+// second has rows
+template <typename Left, typename Right>
+class MatrixProduct : public MatrixExpression<MatrixProduct<Left, Right>> {
+
+private:
+
+    typename ProductOperand<Left>::type one;
+    typename ProductOperand<Right>::type two;
+
+public:
+
+    MatrixProduct(const Left &one, const Right &two) : one(one), two(two) {}
+
+    unsigned int rows() const { return one.rows(); }
+    unsigned int columns() const { return two.columns(); }
+
+    const Matrix &left() const { return one; }
+    const Matrix &right() const { return two; }
+
+    // Sums along the row and column in order, skipping zeros on the left, as
+    // the product kernel does
+    double value(const unsigned int &row, const unsigned int &column) const {
+        const unsigned int inner = one.columns();
+        const double *values_one = one.data() + row * inner;
+        const double *values_two = two.data() + column;
+        const unsigned int stride = two.columns();
+
+        double sum = 0;
+        for(unsigned int index = 0; index < inner; index += 1) {
+            if(values_one[index] != 0)
+                sum += values_one[index] * values_two[index * stride];
+        }
+        return sum;
+    }
+
+    bool refers_to(const Matrix &matrix) const {
+        return one.refers_to(matrix) || two.refers_to(matrix);
+    }
+
+    bool reads_across(const Matrix &matrix) const {
+        return refers_to(matrix);
+    }
+
+};
+
+template <typename Left, typename Right>
+MatrixDifference<Left, Right> operator-(const MatrixExpression<Left> &one,
+        const MatrixExpression<Right> &two);
+template <typename Operand>
+MatrixScaled<Operand> operator*(const MatrixExpression<Operand> &operand,
+        const double &factor);
+template <typename Operand>
+MatrixScaled<Operand> operator*(const double &factor,
+        const MatrixExpression<Operand> &operand);
+template <typename Left, typename Right>
+MatrixProduct<Left, Right> operator*(const MatrixExpression<Left> &one,
+        const MatrixExpression<Right> &two);
+template <typename Operand>
+MatrixQuotient<Operand> operator/(const MatrixExpression<Operand> &operand,
+        const double &factor);
+template <typename Left, typename Right>
+MatrixSum<Left, Right> operator+(const MatrixExpression<Left> &one,
+        const MatrixExpression<Right> &two);
 
 /* ******************************************************************* Operators
 
@@ -118,6 +412,8 @@ The operators are split into a few distinct functions:
         submatrices between two indices
 
     d) Arithmetic operators
+        Each builds an expression (see above), checking its operands' sizes
+        agree; the compound assignment operators evaluate one into a matrix
 
 */
 
@@ -170,8 +466,8 @@ bool operator==(const Matrix &one, const Matrix &two) {
     if(one.size() != two.size())
         return false;
 
-    const auto one_values = one._values;
-    const auto two_values = two._values;
+    const auto &one_values = one._values;
+    const auto &two_values = two._values;
     for(unsigned int index = 0; index < one.volume(); index += 1) {
         if(one_values[index] != two_values[index])
             return false;
@@ -231,40 +527,111 @@ Matrix Matrix::operator()(const unsigned int &row_one,
 }
 
 // Subtracts two matrices
-Matrix operator-(const Matrix &one, const Matrix &two) {
-    return Matrix(one) -= two;
+template <typename Left, typename Right>
+MatrixDifference<Left, Right> operator-(const MatrixExpression<Left> &one,
+        const MatrixExpression<Right> &two) {
+
+    const Left &left = one.self();
+    const Right &right = two.self();
+    if(left.rows() != right.rows() || left.columns() != right.columns()) {
+        std::cerr << "Can't subtract matrices of sizes " <<
+                Matrix::Size(left.columns(), left.rows()) << " and " <<
+                Matrix::Size(right.columns(), right.rows()) << std::endl;
+        throw -1;
+    }
+
+    return MatrixDifference<Left, Right>(left, right);
+}
+
+// Multiplies each value in a matrix by a factor
+template <typename Operand>
+MatrixScaled<Operand> operator*(const MatrixExpression<Operand> &operand,
+        const double &factor) {
+
+    return MatrixScaled<Operand>(operand.self(), factor);
 }
 
 // Multiplies each value in a matrix by a factor
-Matrix operator*(const Matrix &matrix, const double &factor) {
-    return Matrix(matrix) *= factor;
+template <typename Operand>
+MatrixScaled<Operand> operator*(const double &factor,
+        const MatrixExpression<Operand> &operand) {
+
+    return MatrixScaled<Operand>(operand.self(), factor);
 }
 
 // Multiplies two matrices by one another
-Matrix operator*(const Matrix &one, const Matrix &two) {
-    return Matrix(one) *= two;
+template <typename Left, typename Right>
+MatrixProduct<Left, Right> operator*(const MatrixExpression<Left> &one,
+        const MatrixExpression<Right> &two) {
+
+    const Left &left = one.self();
+    const Right &right = two.self();
+    if(left.columns() != right.rows()) {
+        std::cerr << "Can't multiply matrices of sizes " <<
+                Matrix::Size(left.columns(), left.rows()) << " and " <<
+                Matrix::Size(right.columns(), right.rows()) << std::endl;
+        throw -1;
+    }
+
+    return MatrixProduct<Left, Right>(left, right);
 }
 
 // Divides each value in a matrix by a scalar factor
-Matrix operator/(const Matrix &matrix, const double &factor) {
-    return Matrix(matrix) /= factor;
+template <typename Operand>
+MatrixQuotient<Operand> operator/(const MatrixExpression<Operand> &operand,
+        const double &factor) {
+
+    return MatrixQuotient<Operand>(operand.self(), factor);
 }
 
 // Adds two matrices together
-Matrix operator+(const Matrix &one, const Matrix &two) {
-    return Matrix(one) += two;
+template <typename Left, typename Right>
+MatrixSum<Left, Right> operator+(const MatrixExpression<Left> &one,
+        const MatrixExpression<Right> &two) {
+
+    const Left &left = one.self();
+    const Right &right = two.self();
+    if(left.rows() != right.rows() || left.columns() != right.columns()) {
+        std::cerr << "Can't add matrices of sizes " <<
+                Matrix::Size(left.columns(), left.rows()) << " and " <<
+                Matrix::Size(right.columns(), right.rows()) << std::endl;
+        throw -1;
+    }
+
+    return MatrixSum<Left, Right>(left, right);
+}
+
+// Evaluates an expression into this instance, in place if it's already the
+// expression's size (and the expression doesn't read across it), or else
+// into a new matrix, which this instance then takes the values of
+template <typename Expression>
+Matrix &Matrix::operator=(const MatrixExpression<Expression> &expression) {
+    const Expression &operand = expression.self();
+    if(operand.rows() != _rows || operand.columns() != _columns ||
+            operand.reads_across(*this)) {
+
+        return *this = Matrix(expression);
+    }
+
+    evaluate(operand);
+    return *this;
 }
 
 // Subtracts a matrix from this instance
-Matrix &Matrix::operator-=(const Matrix &matrix) {
-    if(this->size() != matrix.size()) {
-        std::cerr << "Can't add matrices of sizes " << size() << " and " <<
-                matrix.size() << std::endl;
+template <typename Expression>
+Matrix &Matrix::operator-=(const MatrixExpression<Expression> &expression) {
+    const Expression &operand = expression.self();
+    if(operand.rows() != _rows || operand.columns() != _columns) {
+        std::cerr << "Can't subtract matrices of sizes " << size() <<
+                " and " << Size(operand.columns(), operand.rows()) <<
+                std::endl;
         throw -1;
     }
 
-    for(unsigned int index = 0; index < volume(); index += 1)
-        _values[index] -= matrix._values[index];
+    if(operand.reads_across(*this))
+        return *this -= Matrix(expression);
+
+    accumulate(operand, -1);
     return *this;
 }
 
@@ -283,18 +650,9 @@ Matrix &Matrix::operator*=(const Matrix &matrix) {
         throw -1;
     }
 
-    Matrix result(matrix.columns(), _rows);
-    for(unsigned int row = 0; row < _rows; row += 1) {
-        for(unsigned int column = 0; column < matrix.columns(); column += 1) {
-            double sum = 0;
-            for(unsigned int index = 0; index < _columns; index += 1)
-                sum += (*this)(row, index) * matrix(index, column);
-            result(row, column) = sum;
-        }
-    }
-
-    *this = result;
-    return *this;
+    // The product reads across this instance, so it's found into a new
+    // matrix, whose values this instance then takes
+    return *this = *this * matrix;
 }
 
 // Divides each value in this instance by a scalar factor
@@ -305,18 +663,63 @@ Matrix &Matrix::operator/=(const double &factor) {
 }
 
 // Adds a matrix to this instance
-Matrix &Matrix::operator+=(const Matrix &matrix) {
-    if(this->size() != matrix.size()) {
+template <typename Expression>
+Matrix &Matrix::operator+=(const MatrixExpression<Expression> &expression) {
+    const Expression &operand = expression.self();
+    if(operand.rows() != _rows || operand.columns() != _columns) {
         std::cerr << "Can't add matrices of sizes " << size() << " and " <<
-                matrix.size() << std::endl;
+                Size(operand.columns(), operand.rows()) << std::endl;
         throw -1;
     }
 
-    for(unsigned int index = 0; index < volume(); index += 1)
-        _values[index] += matrix._values[index];
+    if(operand.reads_across(*this))
+        return *this += Matrix(expression);
+
+    accumulate(operand, 1);
     return *this;
 }
 
+// Sets each value of this instance (already the expression's size) to the
+// expression's, in a single loop
+template <typename Expression>
+void Matrix::evaluate(const Expression &expression) {
+    for(unsigned int row = 0; row < _rows; row += 1) {
+        double *values = _values.data() + row * _columns;
+        for(unsigned int column = 0; column < _columns; column += 1)
+            values[column] = expression.value(row, column);
+    }
+}
+
+// Sets this instance to a product on its own, by the cache-tiled kernel
+template <typename Left, typename Right>
+void Matrix::evaluate(const MatrixProduct<Left, Right> &product) {
+    clear();
+    accumulate(product, 1);
+}
+
+// Adds an expression (times a sign, of one or minus one) to this instance,
+// in a single loop
+template <typename Expression>
+void Matrix::accumulate(const Expression &expression, const double &sign) {
+    for(unsigned int row = 0; row < _rows; row += 1) {
+        double *values = _values.data() + row * _columns;
+        for(unsigned int column = 0; column < _columns; column += 1)
+            values[column] += sign * expression.value(row, column);
+    }
+}
+
+// Adds a product on its own (times a sign) to this instance, by the
+// cache-tiled kernel
+template <typename Left, typename Right>
+void Matrix::accumulate(const MatrixProduct<Left, Right> &product,
+        const double &sign) {
+
+    const Matrix &one = product.left();
+    const Matrix &two = product.right();
+    add_product(_rows, _columns, one.columns(), one.data(), one.columns(),
+            two.data(), two.columns(), data(), _columns, sign);
+}
+
 // **************************************************************** Constructors
 
 Matrix::Index::Index(const unsigned int &row,
@@ -403,6 +806,16 @@ Matrix::Matrix(const unsigned int &columns, const unsigned int &rows) {
     resize(columns, rows);
 }
 
+// Evaluates an expression into a new matrix of its size
+template <typename Expression>
+Matrix::Matrix(const MatrixExpression<Expression> &expression) {
+    const Expression &operand = expression.self();
+    _columns = operand.columns();
+    _rows = operand.rows();
+    _values.resize(_columns * _rows, 0);
+    evaluate(operand);
+}
+
 // ***************************************************** Size management helpers
 
 // Removes a single column from a matrix
@@ -433,8 +846,8 @@ Matrix &Matrix::remove_column(const unsigned int &column) {
         }
     }
 
-    // Re-assign this matrix, and return its reference
-    *this = result;
+    // Take the new matrix's values, and return this matrix's reference
+    *this = std::move(result);
     return *this;
 }
 
@@ -465,8 +878,8 @@ Matrix &Matrix::remove_row(const unsigned int &row) {
         }
     }
 
-    // Re-assign this matrix, and return its reference
-    *this = result;
+    // Take the new matrix's values, and return this matrix's reference
+    *this = std::move(result);
     return *this;
 }
 
@@ -490,15 +903,14 @@ void Matrix::resize(const unsigned int &columns, const unsigned int &rows) {
         return;
     }
 
-    // Create a new temporary matrix
-    Matrix temporary(*this);
+    // Move the old values into a temporary matrix
+    Matrix temporary(std::move(*this));
 
-    // Resize the matrix's member variables to reflect its new size, and clear
-    // the old values (these have been stored in the temporary matrix)
+    // Resize the matrix's member variables to reflect its new size, with
+    // every value cleared (the old values are in the temporary matrix)
     _rows = rows;
     _columns = columns;
-    _values.resize(rows * columns, 0);
-    _values.clear();
+    _values.assign(rows * columns, 0);
 
     // Copy over the values from the old temporary matrix, if they overlap with
     // the new matrix
@@ -529,7 +941,8 @@ double Matrix::determinant() const {
         if(pivot_index == -1)
             return 0;
 
-        if(pivot_index == 0)
+        // Each row swap negates the determinant
+        if(pivot_index > 0)
             result *= -1;
 
         const double diagonal = temporary(index, index);
@@ -646,6 +1059,34 @@ unsigned int Matrix::volume() const {
     return _columns * _rows;
 }
 
+// Returns the matrix's values, in row-major order
+double *Matrix::data() {
+    return _values.data();
+}
+
+// Returns the matrix's values, in row-major order
+const double *Matrix::data() const {
+    return _values.data();
+}
+
+// Returns the value at a row and column, without checking they're in bounds
+double Matrix::value(const unsigned int &row, const unsigned int &column)
+        const {
+
+    return _values[row * _columns + column];
+}
+
+// True if this is the matrix given
+bool Matrix::refers_to(const Matrix &matrix) const {
+    return this == &matrix;
+}
+
+// False, as each of a matrix's values is read only to find the one in the
+// same place
+bool Matrix::reads_across(const Matrix &) const {
+    return false;
+}
+
 // ******************************************************** Index/offset helpers
 
 // Returns the index representing a row-major order offset
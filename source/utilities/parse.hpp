@@ -1,96 +1,351 @@
 #pragma once
 
 #include <iostream>
-#include <locale>
-#include <map>
 #include <string>
 
-#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 
-// Parses a metric value
-// FIXME: Doesn't handle all weird decimal point placements
-double parse_metric_value(const std::string &value) {
+/* ******************************************************************** Synopsis
 
-    // Map containing the metric symbols and their corresponding factors
-    static std::map<char, int> metric_prefixes = {
-        {'f', -15},
-        {'p', -12},
-        {'n', -9},
-        {'u', -6},
-        {'m', -3},
-        {'k', 3},
-        {'g', 9},
-        {'t', 12}
-    };
+Metric values are parsed in a single pass, without allocating. The grammar
+accepted is that of SPICE:
+
+    [sign] digits [. digits] [(e|E) [sign] digits] [prefix] [digits] [unit]
+
+The prefix is matched case-insensitively against the table below; anything
+alphabetic following it (a unit, like 'F' in "10uF", or 's' in "5ms") is
+ignored. Digits directly after a prefix take the place of a decimal point, so
+"4k7" is read as 4.7k; what follows them can only be a unit, and one that
+starts with a prefix of its own (as in "1k7k") is rejected, as it's more
+likely a typo than a unit.
+
+    t   1e12        k   1e3         u, µ    1e-6
+    g   1e9         m   1e-3        n       1e-9
+    meg 1e6         mil 254e-7      p       1e-12
+                                    f       1e-15
+
+The significant digits are gathered into a 64-bit integer alongside a decimal
+exponent (which the prefix contributes to). When both are small enough to be
+represented exactly, the result is a single correctly-rounded multiplication
+or division by an exact power of ten; otherwise the digits are handed to
+std::strtod, which rounds correctly in every case. Either way, a value like
+"4.7k" comes out as exactly the double nearest to 4700. 'mil' isn't a power
+of ten, so its 254 multiplies the digits themselves (as a decimal integer)
+before either, and "1mil" is the double nearest to 2.54e-5 too.
+
+*/
+
+namespace metric {
+
+// Significant digits kept for the strtod fallback (more than enough for any
+// value that'd appear in a netlist)
+const unsigned int maximum_digits = 96;
+
+// Powers of ten which are exactly representable as doubles
+const double exact_powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool is_digit(const char &character) {
+    return character >= '0' && character <= '9';
+}
+
+inline bool is_letter(const char &character) {
+    return (character >= 'a' && character <= 'z') ||
+            (character >= 'A' && character <= 'Z');
+}
+
+inline char lower(const char &character) {
+    return (character >= 'A' && character <= 'Z') ?
+            character - 'A' + 'a' : character;
+}
+
+// Matches a SPICE scale factor at 'position', setting 'factor' to its power of
+// ten and returning the number of characters it spans (or 0 if there isn't
+// one). 'mil' is the odd one out, since it isn't a power of ten; the integer
+// its digits are multiplied by is returned through 'multiplier'
+inline unsigned int match_prefix(const char *position, const char *end,
+        int &factor, unsigned int &multiplier) {
+
+    const auto length = end - position;
+    const auto first = static_cast<unsigned char>(*position);
 
-    // Split the 'value' string into a 'result' string containing only a number,
-    // and a 'factor' variable containing any metric symbol's value
-    std::string result;
-    int factor = 0;
-    for(unsigned int index = 0; index < value.length(); index += 1) {
-        const auto character = value[index];
+    // The micro sign (U+00B5) and the Greek letter mu (U+03BC) both appear in
+    // netlists exported by schematic editors, as two-byte UTF-8 sequences
+    if(length >= 2 && ((first == 0xC2 &&
+            static_cast<unsigned char>(position[1]) == 0xB5) ||
+            (first == 0xCE &&
+            static_cast<unsigned char>(position[1]) == 0xBC))) {
+
+        factor = -6;
+        return 2;
+    }
+
+    switch(lower(*position)) {
+        case 't':
+            factor = 12;
+            return 1;
+        case 'g':
+            factor = 9;
+            return 1;
+        case 'k':
+            factor = 3;
+            return 1;
+        case 'u':
+            factor = -6;
+            return 1;
+        case 'n':
+            factor = -9;
+            return 1;
+        case 'p':
+            factor = -12;
+            return 1;
+        case 'f':
+            factor = -15;
+            return 1;
+
+        // 'm' is milli on its own, but also starts 'meg' and 'mil'
+        case 'm':
+            if(length >= 3 && lower(position[1]) == 'e' &&
+                    lower(position[2]) == 'g') {
+                factor = 6;
+                return 3;
+            }
+            else if(length >= 3 && lower(position[1]) == 'i' &&
+                    lower(position[2]) == 'l') {
+                factor = -7;
+                multiplier = 254;
+                return 3;
+            }
+            factor = -3;
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+// Multiplies the significant digits (read as a decimal integer) by a small
+// integer in place, returning how many digits there are after. The buffer
+// must have room for the digits the product adds
+inline unsigned int multiply_digits(char *digits, const unsigned int &count,
+        const unsigned int &multiplier) {
+
+    char reversed[maximum_digits + 16];
+    unsigned int length = 0;
+    unsigned int carry = 0;
+    for(unsigned int index = count; index-- > 0;) {
+        carry += (digits[index] - '0') * multiplier;
+        reversed[length] = '0' + carry % 10;
+        carry /= 10;
+        length += 1;
+    }
+    for(; carry; carry /= 10) {
+        reversed[length] = '0' + carry % 10;
+        length += 1;
+    }
+
+    for(unsigned int index = 0; index < length; index += 1)
+        digits[index] = reversed[length - 1 - index];
+    return length;
+}
+
+} // namespace metric
+
+// Reports a value which couldn't be parsed
+inline void metric_parse_error(const char *begin, const char *end) {
+    std::cerr << "Couldn't parse metric value '";
+    std::cerr.write(begin, end - begin);
+    std::cerr << "'" << std::endl;
+    throw -1;
+}
 
-        // Add numbers and formatting characters straight to the 'result'
-        // string
-        if((character >= '0' && character <= '9') || character == '-' ||
-                character == '.') {
+// Parses the metric value between two character pointers
+double parse_metric_value(const char *begin, const char *end) {
+    using namespace metric;
 
-            result += character;
+    const char *position = begin;
+
+    // Handle the sign
+    bool negative = false;
+    if(position < end && (*position == '-' || *position == '+')) {
+        negative = *position == '-';
+        position += 1;
+    }
+
+    // Gather the significant digits, both as an integer (for the fast path),
+    // and as characters (for the fallback). Leading zeroes are skipped, and the
+    // decimal exponent is adjusted for digits following the point
+    char digits[maximum_digits + 16];
+    unsigned int digit_count = 0;
+    std::uint64_t mantissa = 0;
+    int exponent = 0;
+    bool seen_digit = false;
+    bool seen_point = false;
+
+    const auto add_digit = [&](const char &character) {
+        seen_digit = true;
+        if(digit_count == 0 && character == '0')
+            return;
+
+        if(digit_count >= maximum_digits)
+            metric_parse_error(begin, end);
+
+        if(digit_count < 19)
+            mantissa = mantissa * 10 + (character - '0');
+        digits[digit_count] = character;
+        digit_count += 1;
+    };
+
+    for(; position < end; position += 1) {
+        const char character = *position;
+        if(is_digit(character)) {
+            add_digit(character);
+
+            // Every digit after the point shifts the exponent down, including
+            // leading zeroes (which aren't counted as significant)
+            if(seen_point)
+                exponent -= 1;
         }
+        else if(character == '.' && seen_point == false)
+            seen_point = true;
+        else
+            break;
+    }
 
-        // If the character isn't a number, it must be part of a metric symbol,
-        // so try and find out which one, setting the 'factor' variable
-        else {
+    if(seen_digit == false)
+        metric_parse_error(begin, end);
+
+    // Parse an exponent, if there is one (an 'e' that isn't followed by a
+    // number is left to be treated as a unit)
+    bool seen_exponent = false;
+    if(position < end && lower(*position) == 'e') {
+        const char *cursor = position + 1;
+        bool exponent_negative = false;
+        if(cursor < end && (*cursor == '-' || *cursor == '+')) {
+            exponent_negative = *cursor == '-';
+            cursor += 1;
+        }
 
-            // Make sure we aren't overwriting anything
-            if(factor) {
-                std::cerr << "Encountered multiple metric factors in a single "
-                        "value: '" << value << "'" << std::endl;
-                throw -1;
+        if(cursor < end && is_digit(*cursor)) {
+            int value = 0;
+            for(; cursor < end && is_digit(*cursor); cursor += 1) {
+                if(value < 10000)
+                    value = value * 10 + (*cursor - '0');
             }
 
-            // The 'mega' and 'mu' prefixes are a string and a multi-character
-            // constant respectively, so they can't be placed in the map of
-            // symbols
-            else if(value.substr(index, 3) == "Meg") {
-                factor = 6;
-                index += 3;
+            exponent += exponent_negative ? -value : value;
+            position = cursor;
+            seen_exponent = true;
+        }
+    }
+
+    // Parse a metric prefix, and any digits which take the place of a decimal
+    // point after it (as in "4k7")
+    unsigned int multiplier = 1;
+    if(position < end) {
+        int factor = 0;
+        const auto span = match_prefix(position, end, factor, multiplier);
+        if(span) {
+            position += span;
+            exponent += factor;
+
+            bool seen_infix = false;
+            if(seen_point == false && seen_exponent == false) {
+                for(; position < end && is_digit(*position); position += 1) {
+                    add_digit(*position);
+                    exponent -= 1;
+                    seen_infix = true;
+                }
             }
-            else if(value.substr(index, 2) == std::string({-62, -75})) {
-                factor = -6;
-                index += 2;
+
+            // A second prefix after those digits isn't taken for a unit
+            int other_factor = 0;
+            unsigned int other_multiplier = 1;
+            if(seen_infix && position < end && match_prefix(position, end,
+                    other_factor, other_multiplier)) {
+
+                metric_parse_error(begin, end);
             }
+        }
+    }
+
+    // Anything left over has to be a unit
+    for(; position < end; position += 1) {
+        if(is_letter(*position) == false)
+            metric_parse_error(begin, end);
+    }
+
+    // Scale the digits by the prefix's multiplier, if it has one, so the
+    // result's still rounded only once
+    if(multiplier != 1 && digit_count) {
+        digit_count = multiply_digits(digits, digit_count, multiplier);
+        mantissa = 0;
+        for(unsigned int index = 0; index < digit_count && index < 19;
+                index += 1) {
+
+            mantissa = mantissa * 10 + (digits[index] - '0');
+        }
+    }
 
-            // Find the right factor from the symbol map
-            else if(metric_prefixes.find(std::tolower(character)) !=
-                    metric_prefixes.end()) {
+    // Leading zeroes were dropped, so a value of zero has no digits at all
+    double result = 0;
+    if(digit_count) {
 
-                factor = metric_prefixes[character];
+        // Fast path: the mantissa and the power of ten are both exact, so a
+        // single operation gives a correctly-rounded result
+        if(digit_count <= 19 && mantissa <= (std::uint64_t(1) << 53) &&
+                exponent >= -22 && exponent <= 22) {
+
+            result = static_cast<double>(mantissa);
+            if(exponent < 0)
+                result /= exact_powers[-exponent];
+            else
+                result *= exact_powers[exponent];
+        }
+
+        // Fallback: write the digits out in scientific notation for strtod
+        else {
+            unsigned int length = digit_count;
+            digits[length] = 'e';
+            length += 1;
+
+            int value = exponent;
+            if(value < 0) {
+                digits[length] = '-';
+                length += 1;
+                value = -value;
             }
 
-            // If none of the above have been the case, then the character
-            // encountered wasn't part of a metric symbol
-            else {
-                std::cerr << "Couldn't parse metric value '" << value << "'" <<
-                        std::endl;
-                throw -1;
+            char reversed[12];
+            unsigned int count = 0;
+            do {
+                reversed[count] = '0' + (value % 10);
+                value /= 10;
+                count += 1;
+            } while(value && count < 12);
+            while(count) {
+                count -= 1;
+                digits[length] = reversed[count];
+                length += 1;
             }
+            digits[length] = 0;
 
-            // If the metric symbol was encountered part-way through the string,
-            // as with, for instance, "4k7", then it should be replaced by a
-            // decimal point
-            if(index < value.length())
-                result += '.';
+            result = std::strtod(digits, nullptr);
         }
     }
 
-    return std::stof(result) * std::pow(10, factor);
+    return negative ? -result : result;
+}
+
+// Parses a metric value
+double parse_metric_value(const std::string &value) {
+    return parse_metric_value(value.data(), value.data() + value.length());
 }
 
-// Parse a time stamp
+// Parse a time stamp (the trailing 's', if there is one, is read as a unit)
 double parse_time_value(const std::string &value) {
-    std::string result = value;
-    if(result.back() == 's')
-        result.pop_back();
-    return parse_metric_value(result);
+    return parse_metric_value(value);
 }
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "counters.hpp"
+
+/* ******************************************************************** Synopsis
+
+A hierarchical profiler of the simulation's phases. Each phase is timed by a
+Scope, which measures the (monotonic) time from its construction to its
+destruction, and adds it to the phase's entry in a tree of the scopes it was
+opened within. A phase is named by a string literal, and identified by its
+address, so opening a scope costs a clock read and a short search of its
+parent's children, rather than any string handling.
+
+Each thread keeps a tree of its own, so timing needs no locks; the trees are
+only merged (by the phases' names) once the work's done, when they're printed
+with each phase's total time, number of calls, and share of its parent's time.
+If a trace's asked for, each scope closed is also kept as an event, to be
+written out as a Chrome trace (a JSON file which chrome://tracing, or
+Perfetto, shows as a timeline of each thread's phases). The events go in a
+ring buffer, allocated when a thread first opens a scope, which keeps the
+latest maximum_events of them; past a phase's first scope, timing it
+allocates nothing.
+
+A thread's tree is leased to it, and given back when the thread exits (with
+its counters closed), for the next thread started to carry on in; so threads
+started and stopped over and over take no more trees than run at once.
+
+If asked to, each thread also opens a group of hardware performance counters,
+which every scope reads as it opens and closes, so each phase is credited with
+the cycles, instructions, cache misses, and branch misses spent in it. Where
+the counters can't be opened, the phases are only timed, and the report says
+why there are no counts.
+
+While the profiler's disabled (as it is by default), a scope does nothing but
+check that it is.
+
+*/
+
+class Profiler {
+
+private:
+
+    // A phase, and the time spent in it (in nanoseconds), and the hardware
+    // events counted in it, within its parent
+    struct Node {
+        const char *name;
+        double time;
+        unsigned long count;
+        Counters::Values counts;
+
+        Node *parent;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    // A scope closed, for the trace (in nanoseconds since the profiler began)
+    struct Event {
+        const char *name;
+        double start;
+        double duration;
+        Counters::Values counts;
+    };
+
+    // The phases timed on one thread, and where it is among them, with its
+    // traced events (the number recorded, of which the buffer keeps the
+    // latest), and whether a running thread holds it
+    struct Thread {
+        unsigned int id;
+        Node root;
+        Node *current;
+        std::vector<Event> events;
+        unsigned long event_count;
+        Counters counters;
+        bool active;
+    };
+
+    // Holds a thread's tree while it runs, giving it back when it exits
+    struct Lease {
+        Thread *thread = nullptr;
+        ~Lease();
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    // The most events each thread keeps for the trace (the earliest being
+    // overwritten by later ones)
+    static const unsigned int maximum_events = 1 << 16;
+
+    static bool enabled;
+    static bool counting;
+    static bool tracing;
+    static bool counted;
+    static Clock::time_point origin;
+
+    static std::mutex mutex;
+    static std::vector<std::unique_ptr<Thread>> threads;
+
+    static Thread &get_thread();
+    static Node *create_node(const char *name, Node *parent);
+
+    template <typename Function>
+    static void visit_events(const Thread &thread, Function function);
+
+    static void merge(Node &into, const Node &from);
+    static void print(std::ostream &stream, const Node &node,
+            const double &parent_time, const unsigned int &depth);
+
+public:
+
+    // Times the phase it's given from its construction to its destruction (or
+    // until it's ended, if that's sooner)
+    class Scope {
+
+    private:
+
+        Thread *thread;
+        Clock::time_point start;
+        Counters::Values counts;
+
+    public:
+
+        Scope(const char *name);
+        Scope(const Scope &scope) = delete;
+        Scope &operator=(const Scope &scope) = delete;
+        ~Scope();
+
+        void end();
+
+    };
+
+    static void enable(const bool &counters, const bool &trace);
+    static bool is_enabled();
+
+    static void clear();
+
+    static void report(std::ostream &stream);
+    static bool write_trace(const std::string &file_name);
+
+    static std::map<std::string, std::vector<double>> get_durations();
+
+};
+
+const unsigned int Profiler::maximum_events;
+bool Profiler::enabled = false;
+bool Profiler::counting = false;
+bool Profiler::tracing = false;
+bool Profiler::counted = false;
+Profiler::Clock::time_point Profiler::origin;
+std::mutex Profiler::mutex;
+std::vector<std::unique_ptr<Profiler::Thread>> Profiler::threads;
+
+// Starts profiling, with hardware events counted if asked (and able), and
+// each scope kept for a trace (or the durations of each call) if asked, with
+// its times measured from now
+void Profiler::enable(const bool &counters, const bool &trace) {
+    origin = Clock::now();
+    counting = counters;
+    tracing = trace;
+    enabled = true;
+}
+
+// Returns whether the profiler's timing scopes
+bool Profiler::is_enabled() {
+    return enabled;
+}
+
+// Returns this thread's tree, leasing it one the first time it's asked for:
+// one an exited thread gave back, or else a new one
+Profiler::Thread &Profiler::get_thread() {
+    thread_local Lease lease;
+    if(lease.thread == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(const auto &thread : threads) {
+            if(thread->active == false) {
+                lease.thread = thread.get();
+                break;
+            }
+        }
+
+        if(lease.thread == nullptr) {
+            threads.emplace_back(new Thread());
+            lease.thread = threads.back().get();
+            lease.thread->id = threads.size();
+            lease.thread->root = {"total", 0, 0, {}, nullptr, {}};
+            lease.thread->current = &lease.thread->root;
+            lease.thread->event_count = 0;
+        }
+
+        Thread &thread = *lease.thread;
+        thread.active = true;
+        if(tracing && thread.events.empty())
+            thread.events.resize(maximum_events);
+        if(counting && thread.counters.open())
+            counted = true;
+    }
+    return *lease.thread;
+}
+
+// Gives the thread's tree back, for another thread to lease, closing its
+// counters (which only count the thread that opened them)
+Profiler::Lease::~Lease() {
+    if(thread == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    thread->counters.release();
+    thread->current = &thread->root;
+    thread->active = false;
+}
+
+// Adds a phase beneath another, with nothing spent in it yet
+Profiler::Node *Profiler::create_node(const char *name, Node *parent) {
+    parent->children.emplace_back(new Node());
+    Node *node = parent->children.back().get();
+    node->name = name;
+    node->time = 0;
+    node->count = 0;
+    node->counts.fill(0);
+    node->parent = parent;
+    return node;
+}
+
+Profiler::Scope::Scope(const char *name) {
+    if(enabled == false) {
+        thread = nullptr;
+        return;
+    }
+
+    // Open the phase's node beneath the current one, adding it if it's new
+    thread = &get_thread();
+    Node *parent = thread->current;
+    Node *node = nullptr;
+    for(const auto &child : parent->children) {
+        if(child->name == name) {
+            node = child.get();
+            break;
+        }
+    }
+
+    if(node == nullptr)
+        node = create_node(name, parent);
+
+    thread->current = node;
+    if(thread->counters.is_open())
+        counts = thread->counters.read();
+    start = Clock::now();
+}
+
+Profiler::Scope::~Scope() {
+    end();
+}
+
+// Stops timing the scope's phase, before the scope itself is destroyed
+void Profiler::Scope::end() {
+    if(thread == nullptr)
+        return;
+
+    const auto end = Clock::now();
+    const double duration = std::chrono::duration<double, std::nano>(end -
+            start).count();
+
+    // The counts spent in the phase (zero, without counters)
+    if(thread->counters.is_open()) {
+        const auto now = thread->counters.read();
+        for(unsigned int kind = 0; kind < counts.size(); kind += 1)
+            counts[kind] = now[kind] - counts[kind];
+    }
+    else
+        counts.fill(0);
+
+    Node *node = thread->current;
+    node->time += duration;
+    node->count += 1;
+    for(unsigned int kind = 0; kind < counts.size(); kind += 1)
+        node->counts[kind] += counts[kind];
+    thread->current = node->parent;
+
+    if(thread->events.empty() == false) {
+        const double offset = std::chrono::duration<double, std::nano>(start -
+                origin).count();
+        thread->events[thread->event_count % thread->events.size()] =
+                {node->name, offset, duration, counts};
+        thread->event_count += 1;
+    }
+    thread = nullptr;
+}
+
+// Forgets everything timed so far, for the next run to be profiled on its own.
+// No scope may be open on any thread
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for(const auto &thread : threads) {
+        thread->root.children.clear();
+        thread->current = &thread->root;
+        thread->event_count = 0;
+    }
+    origin = Clock::now();
+}
+
+// Calls a function on each of a thread's traced events still kept, earliest
+// first
+template <typename Function>
+void Profiler::visit_events(const Thread &thread, Function function) {
+    const unsigned long kept = std::min<unsigned long>(thread.event_count,
+            thread.events.size());
+    for(unsigned long index = thread.event_count - kept;
+            index < thread.event_count; index += 1) {
+
+        function(thread.events[index % thread.events.size()]);
+    }
+}
+
+// Adds the times of one tree's phases into another's, matching them by name
+void Profiler::merge(Node &into, const Node &from) {
+    into.time += from.time;
+    into.count += from.count;
+    for(unsigned int kind = 0; kind < into.counts.size(); kind += 1)
+        into.counts[kind] += from.counts[kind];
+    for(const auto &child : from.children) {
+        Node *match = nullptr;
+        for(const auto &existing : into.children) {
+            if(std::string(existing->name) == child->name) {
+                match = existing.get();
+                break;
+            }
+        }
+
+        if(match == nullptr)
+            match = create_node(child->name, &into);
+        merge(*match, *child);
+    }
+}
+
+// Prints a phase, and those within it, indented by their depth
+void Profiler::print(std::ostream &stream, const Node &node,
+        const double &parent_time, const unsigned int &depth) {
+
+    stream << std::string(depth * 2, ' ') << std::left << std::setw(32 -
+            depth * 2) << node.name << std::right << std::setw(12) <<
+            std::fixed << std::setprecision(3) << node.time / 1e6 << " ms" <<
+            std::setw(10) << node.count << " calls";
+    stream << std::setprecision(1);
+    if(parent_time > 0)
+        stream << std::setw(8) << 100 * node.time / parent_time << "%";
+    else if(counted)
+        stream << std::setw(9) << "";
+
+    // The counts, in millions, with the instructions per cycle and the
+    // misses per thousand instructions
+    if(counted) {
+        const auto &counts = node.counts;
+        const double instructions = counts[Counters::INSTRUCTIONS];
+        stream << std::setw(10) << counts[Counters::CYCLES] / 1e6 <<
+                std::setw(10) << instructions / 1e6;
+
+        stream << std::setprecision(2);
+        if(counts[Counters::CYCLES] > 0) {
+            stream << std::setw(7) << instructions /
+                    counts[Counters::CYCLES];
+        }
+        else
+            stream << std::setw(7) << "-";
+
+        for(const auto &kind : {Counters::CACHE_MISSES,
+                Counters::BRANCH_MISSES}) {
+            if(instructions > 0)
+                stream << std::setw(9) << 1000 * counts[kind] / instructions;
+            else
+                stream << std::setw(9) << "-";
+        }
+    }
+    stream << std::defaultfloat << '\n';
+
+    for(const auto &child : node.children)
+        print(stream, *child, node.time, depth + 1);
+}
+
+// Prints the phases timed on every thread, merged into one tree. The time of
+// phases on several threads at once is the sum of their threads' times, and
+// phases opened at the top of a worker thread are at the top of the tree
+void Profiler::report(std::ostream &stream) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Node total = {"total", 0, 0, {}, nullptr, {}};
+    for(const auto &thread : threads)
+        merge(total, thread->root);
+
+    stream << "Profile (time per phase, summed over threads):\n";
+    if(counted) {
+        stream << std::string(72, ' ') << std::setw(10) << "Mcycles" <<
+                std::setw(10) << "Minstr" << std::setw(7) << "IPC" <<
+                std::setw(9) << "LLC/ki" << std::setw(9) << "br/ki" << '\n';
+    }
+    else if(counting) {
+        stream << "(Hardware counters unavailable: perf_event_open failed, "
+                "so only times are shown)\n";
+    }
+
+    for(const auto &child : total.children)
+        print(stream, *child, 0, 0);
+}
+
+// Writes every thread's traced scopes as Chrome trace events. Returns false if
+// the file couldn't be written
+bool Profiler::write_trace(const std::string &file_name) {
+    std::ofstream file(file_name);
+    if(file.is_open() == false)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    file << std::fixed << std::setprecision(3);
+    for(const auto &thread : threads) {
+        visit_events(*thread, [&](const Event &event) {
+            if(first == false)
+                file << ",\n";
+            first = false;
+
+            file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\","
+                    "\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" <<
+                    event.start / 1e3 << ",\"dur\":" << event.duration / 1e3;
+
+            // The counts go in the event's arguments, which the viewer shows
+            // when it's selected
+            if(thread->counters.is_open()) {
+                file << ",\"args\":{";
+                for(unsigned int kind = 0; kind < Counters::KIND_COUNT;
+                        kind += 1) {
+
+                    file << (kind ? "," : "") << "\"" << Counters::get_name(
+                            Counters::Kind(kind)) << "\":" <<
+                            event.counts[kind];
+                }
+                file << "}";
+            }
+            file << "}";
+        });
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return file.good();
+}
+
+// Returns the duration (in nanoseconds) of every traced scope of each phase,
+// over all threads
+std::map<std::string, std::vector<double>> Profiler::get_durations() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, std::vector<double>> durations;
+    for(const auto &thread : threads) {
+        visit_events(*thread, [&](const Event &event) {
+            durations[event.name].push_back(event.duration);
+        });
+    }
+    return durations;
+}
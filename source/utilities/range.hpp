@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/* ******************************************************************** Synopsis
+
+A non-owning view of a contiguous run of elements (a pointer and a length),
+which can be iterated over or indexed like the vector it was taken from. It
+doesn't copy anything, so it's only valid for as long as the storage it views
+isn't reallocated (for a schematic's views, until another component's added).
+
+*/
+
+template <typename Type>
+class Range {
+
+private:
+
+    const Type *first;
+    std::size_t length;
+
+public:
+
+    Range();
+    Range(const Type *first, const std::size_t &length);
+    Range(const std::vector<Type> &elements);
+
+    const Type *begin() const;
+    const Type *end() const;
+
+    const Type &operator[](const std::size_t &index) const;
+
+    std::size_t size() const;
+    bool empty() const;
+
+};
+
+template <typename Type>
+Range<Type>::Range() {
+    first = nullptr;
+    length = 0;
+}
+
+template <typename Type>
+Range<Type>::Range(const Type *first, const std::size_t &length) {
+    this->first = first;
+    this->length = length;
+}
+
+// Views the whole of a vector
+template <typename Type>
+Range<Type>::Range(const std::vector<Type> &elements) {
+    first = elements.data();
+    length = elements.size();
+}
+
+template <typename Type>
+const Type *Range<Type>::begin() const {
+    return first;
+}
+
+template <typename Type>
+const Type *Range<Type>::end() const {
+    return first + length;
+}
+
+template <typename Type>
+const Type &Range<Type>::operator[](const std::size_t &index) const {
+    return first[index];
+}
+
+template <typename Type>
+std::size_t Range<Type>::size() const {
+    return length;
+}
+
+template <typename Type>
+bool Range<Type>::empty() const {
+    return length == 0;
+}
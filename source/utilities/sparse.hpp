@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+/* ******************************************************************** Synopsis
+
+A square sparse matrix, in compressed sparse row form: the columns and values
+of its non-zero entries, row by row (each row's in order of column), with the
+position at which each row starts. Its storage grows with the number of
+entries, rather than the square of the number of rows, so it can hold the
+systems of circuits far too large to factorize densely.
+
+The pattern (which entries may be non-zero) is set once, and always includes
+the diagonal; after that only the values change, and entries outside the
+pattern can't be written. The position of each row's diagonal entry is kept,
+for the preconditioners that need it.
+
+*/
+
+class SparseMatrix {
+
+private:
+
+    unsigned int size;
+
+    std::vector<unsigned int> starts;
+    std::vector<unsigned int> columns;
+    std::vector<unsigned int> diagonals;
+    std::vector<double> values;
+
+    unsigned int find(const unsigned int &row, const unsigned int &column)
+            const;
+
+public:
+
+    SparseMatrix();
+
+    void set_pattern(std::vector<std::vector<unsigned int>> rows);
+
+    double &operator()(const unsigned int &row, const unsigned int &column);
+    double value(const unsigned int &row, const unsigned int &column) const;
+
+    void clear();
+    void multiply(const double *vector, double *result) const;
+
+    unsigned int rows() const;
+    unsigned int nonzero_count() const;
+
+    const std::vector<unsigned int> &get_starts() const;
+    const std::vector<unsigned int> &get_columns() const;
+    const std::vector<unsigned int> &get_diagonals() const;
+    const std::vector<double> &get_values() const;
+    std::vector<double> &get_values();
+
+};
+
+SparseMatrix::SparseMatrix() {
+    size = 0;
+    starts.assign(1, 0);
+}
+
+// Sets the pattern of the matrix, from the columns of the entries in each of
+// its rows (in any order, and possibly repeated). Every value's cleared
+void SparseMatrix::set_pattern(std::vector<std::vector<unsigned int>> rows) {
+    size = rows.size();
+    starts.assign(1, 0);
+    columns.clear();
+    diagonals.resize(size);
+    for(unsigned int row = 0; row < size; row += 1) {
+        auto &entries = rows[row];
+        entries.push_back(row);
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()),
+                entries.end());
+
+        for(const auto &column : entries) {
+            if(column == row)
+                diagonals[row] = columns.size();
+            columns.push_back(column);
+        }
+        starts.push_back(columns.size());
+    }
+
+    values.assign(columns.size(), 0);
+}
+
+// Returns the position of an entry among the values, or the number of values
+// if it isn't in the pattern
+unsigned int SparseMatrix::find(const unsigned int &row,
+        const unsigned int &column) const {
+
+    if(row >= size)
+        return values.size();
+
+    const auto begin = columns.begin() + starts[row];
+    const auto end = columns.begin() + starts[row + 1];
+    const auto position = std::lower_bound(begin, end, column);
+    if(position == end || *position != column)
+        return values.size();
+    return position - columns.begin();
+}
+
+// Returns the value at a row and column, which must be in the pattern
+double &SparseMatrix::operator()(const unsigned int &row,
+        const unsigned int &column) {
+
+    const unsigned int position = find(row, column);
+    if(position == values.size()) {
+        std::cerr << "Can't access element at (" << row << ", " << column <<
+                ") outside the pattern of a sparse matrix" << std::endl;
+        throw -1;
+    }
+    return values[position];
+}
+
+// Returns a copy of the value at a row and column (zero if it's outside the
+// pattern)
+double SparseMatrix::value(const unsigned int &row,
+        const unsigned int &column) const {
+
+    const unsigned int position = find(row, column);
+    return position == values.size() ? 0 : values[position];
+}
+
+// Clears (sets to zero) each value in the pattern
+void SparseMatrix::clear() {
+    std::fill(values.begin(), values.end(), 0);
+}
+
+// Multiplies a vector (of as many values as the matrix has rows) by the
+// matrix, writing the product to another
+void SparseMatrix::multiply(const double *vector, double *result) const {
+    for(unsigned int row = 0; row < size; row += 1) {
+        double sum = 0;
+        for(unsigned int index = starts[row]; index < starts[row + 1];
+                index += 1) {
+
+            sum += values[index] * vector[columns[index]];
+        }
+        result[row] = sum;
+    }
+}
+
+// Returns the number of rows (and columns) in the matrix
+unsigned int SparseMatrix::rows() const {
+    return size;
+}
+
+// Returns the number of entries in the pattern
+unsigned int SparseMatrix::nonzero_count() const {
+    return values.size();
+}
+
+// Returns the position at which each row's entries start (with one more, past
+// the last row's)
+const std::vector<unsigned int> &SparseMatrix::get_starts() const {
+    return starts;
+}
+
+// Returns the column of each entry
+const std::vector<unsigned int> &SparseMatrix::get_columns() const {
+    return columns;
+}
+
+// Returns the position of each row's diagonal entry
+const std::vector<unsigned int> &SparseMatrix::get_diagonals() const {
+    return diagonals;
+}
+
+// Returns the value of each entry
+const std::vector<double> &SparseMatrix::get_values() const {
+    return values;
+}
+
+// Returns the value of each entry
+std::vector<double> &SparseMatrix::get_values() {
+    return values;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "hash.hpp"
+#include "range.hpp"
+
+/* ******************************************************************** Synopsis
+
+Maps names to dense 32-bit IDs, handed out in the order the names are first
+seen (so the first name interned gets ID 0, the next ID 1, and so on). Two
+names get the same ID if and only if they're the same string; unlike a hash,
+an ID can't collide.
+
+The characters of each name are copied into an arena of large blocks, which
+are never moved or freed until the table is, so the names can be referred to
+by pointer for as long as the table exists.
+
+The table itself is open-addressed, with linear probing. Each slot holds
+either nothing, or the ID of a name (plus one, so that zero can mean 'empty');
+the full 64-bit hash of each name is stored alongside it, so mismatching
+probes are almost always rejected without comparing characters, and growing
+the table doesn't need to rehash anything. The table doubles whenever it's
+half full.
+
+*/
+
+// A name held in a symbol table's arena
+struct Symbol {
+    const char *data;
+    unsigned int length;
+
+    std::string string() const;
+
+};
+
+class SymbolTable {
+
+private:
+
+    static const std::size_t block_size = 1 << 16;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *cursor;
+    std::size_t remaining;
+
+    std::vector<Symbol> symbols;
+    std::vector<std::uint64_t> hashes;
+
+    std::vector<unsigned int> slots;
+    std::size_t mask;
+
+    const char *store(const char *data, const std::size_t &length);
+
+    std::size_t locate(const char *data, const std::size_t &length,
+            const std::uint64_t &hash) const;
+    void grow();
+
+public:
+
+    static const unsigned int none = std::numeric_limits<unsigned int>::max();
+
+    SymbolTable();
+    SymbolTable(const SymbolTable &table) = delete;
+    SymbolTable &operator=(const SymbolTable &table) = delete;
+
+    unsigned int intern(const char *data, const std::size_t &length);
+    unsigned int intern(const std::string &name);
+    unsigned int find(const std::string &name) const;
+
+    const Symbol &name(const unsigned int &id) const;
+    Range<Symbol> names() const;
+
+    unsigned int size() const;
+    void clear();
+
+};
+
+std::ostream &operator<<(std::ostream &stream, const Symbol &symbol);
+
+const std::size_t SymbolTable::block_size;
+const unsigned int SymbolTable::none;
+
+// Serializes a symbol's characters to a stream
+std::ostream &operator<<(std::ostream &stream, const Symbol &symbol) {
+    return stream.write(symbol.data, symbol.length);
+}
+
+// Returns a copy of the symbol's characters
+std::string Symbol::string() const {
+    return std::string(data, length);
+}
+
+SymbolTable::SymbolTable() {
+    clear();
+}
+
+// Copies a name into the arena, starting a new block if the current one's too
+// full (names longer than a block get a block to themselves)
+const char *SymbolTable::store(const char *data, const std::size_t &length) {
+    if(length > remaining) {
+        const std::size_t size = std::max(block_size, length);
+        blocks.emplace_back(new char[size]);
+        cursor = blocks.back().get();
+        remaining = size;
+    }
+
+    char *result = cursor;
+    std::memcpy(result, data, length);
+    cursor += length;
+    remaining -= length;
+    return result;
+}
+
+// Returns the slot which either holds the name given, or is the empty slot it
+// would be placed into
+std::size_t SymbolTable::locate(const char *data, const std::size_t &length,
+        const std::uint64_t &hash) const {
+
+    std::size_t slot = hash & mask;
+    while(slots[slot]) {
+        const unsigned int id = slots[slot] - 1;
+        const auto &symbol = symbols[id];
+        if(hashes[id] == hash && symbol.length == length &&
+                std::memcmp(symbol.data, data, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Doubles the number of slots, re-placing each ID using its stored hash
+void SymbolTable::grow() {
+    std::vector<unsigned int> previous;
+    previous.swap(slots);
+
+    slots.resize(previous.size() * 2, 0);
+    mask = slots.size() - 1;
+    for(const auto &entry : previous) {
+        if(entry == 0)
+            continue;
+
+        std::size_t slot = hashes[entry - 1] & mask;
+        while(slots[slot])
+            slot = (slot + 1) & mask;
+        slots[slot] = entry;
+    }
+}
+
+// Returns the ID of the name of the length given at 'data', assigning it the
+// next ID if it hasn't been seen before
+unsigned int SymbolTable::intern(const char *data, const std::size_t &length) {
+    const auto hash = hash_content(data, length);
+    const std::size_t slot = locate(data, length, hash);
+    if(slots[slot])
+        return slots[slot] - 1;
+
+    const unsigned int id = symbols.size();
+    symbols.push_back({store(data, length), (unsigned int)length});
+    hashes.push_back(hash);
+    slots[slot] = id + 1;
+
+    if(symbols.size() * 2 > slots.size())
+        grow();
+    return id;
+}
+
+// Returns the ID of a name, assigning it the next ID if it hasn't been seen
+// before
+unsigned int SymbolTable::intern(const std::string &name) {
+    return intern(name.data(), name.length());
+}
+
+// Returns the ID of a name, or 'none' if it hasn't been interned
+unsigned int SymbolTable::find(const std::string &name) const {
+    const auto hash = hash_content(name.data(), name.length());
+    const std::size_t slot = locate(name.data(), name.length(), hash);
+    return slots[slot] ? slots[slot] - 1 : none;
+}
+
+// Returns the name with a given ID
+const Symbol &SymbolTable::name(const unsigned int &id) const {
+    return symbols[id];
+}
+
+// Returns a view of every name, by ID
+Range<Symbol> SymbolTable::names() const {
+    return Range<Symbol>(symbols);
+}
+
+// Returns the number of names interned
+unsigned int SymbolTable::size() const {
+    return symbols.size();
+}
+
+// Removes every name
+void SymbolTable::clear() {
+    blocks.clear();
+    cursor = nullptr;
+    remaining = 0;
+
+    symbols.clear();
+    hashes.clear();
+    slots.assign(16, 0);
+    mask = slots.size() - 1;
+}